@@ -0,0 +1,154 @@
+// snmp_stream/_snmp_stream/ber.hpp
+
+#ifndef BER_HPP
+#define BER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "types.hpp"
+
+namespace snmp_stream {
+
+#define BER_INTEGER 0x02
+#define BER_OCTET_STRING 0x04
+#define BER_NULL 0x05
+#define BER_OBJECT_ID 0x06
+#define BER_SEQUENCE 0x30
+#define BER_COUNTER32 0x41
+#define BER_GAUGE32 0x42
+#define BER_TIMETICKS 0x43
+#define BER_COUNTER64 0x46
+#define BER_UINTEGER32 0x47
+#define BER_NO_SUCH_OBJECT 0x80
+#define BER_NO_SUCH_INSTANCE 0x81
+#define BER_END_OF_MIB_VIEW 0x82
+
+/*!
+  Decoded variable binding.  The value has the same host representation
+  NET-SNMP gives a `variable_list` value so results do not depend on the
+  codec: integers are a `long`, 32-bit unsigned types an `u_long`, Counter64
+  a `counter64` and object identifiers an `oid_t` array.  Octet string like
+  values point into the datagram; everything else points into `BerScratch`.
+*/
+struct VarBind {
+  oid_t const *name;   //!< Object identifier.
+  size_t name_length;  //!< Number of sub-identifiers in `name`.
+  uint8_t type;        //!< Value type.
+  void const *value;   //!< Value or `nullptr` for an empty value.
+  size_t value_length; //!< Size of the value in bytes.
+  size_t index;        //!< 1-based position in the PDU.
+};
+
+/*!
+  Decoding storage reused across variable bindings so decoding does not
+  allocate once the vectors have grown to the largest OID seen.
+*/
+struct BerScratch {
+  std::vector<oid_t> name;      //!< Decoded object identifier.
+  std::vector<oid_t> oid_value; //!< Decoded object identifier value.
+  union {
+    long integer;       //!< Decoded INTEGER.
+    u_long uinteger;    //!< Decoded Counter32, Gauge32, TimeTicks, UInteger32.
+    counter64 counter;  //!< Decoded Counter64.
+  } scalar;             //!< Decoded scalar value.
+};
+
+/*!
+  Decoded SNMPv1/v2c message up to the variable bindings.
+*/
+struct BerPdu {
+  int64_t version;        //!< SNMP version.
+  uint8_t command;        //!< PDU type.
+  int64_t request_id;     //!< Request-id.
+  int64_t error_status;   //!< Error status.
+  int64_t error_index;    //!< Error index.
+  size_t var_binds_pos;   //!< Position of the first variable binding.
+  size_t var_binds_end;   //!< End of the variable bindings.
+};
+
+/*!
+  Read a BER tag and definite length.  On success `pos` is advanced to the
+  first content byte.
+
+  \return `std::optional<size_t>`: Content length or `std::nullopt` if the
+  header is malformed, truncated or has a different tag.
+*/
+[[nodiscard]] auto
+ber_read_header(uint8_t const *data, //!< Encoded message.
+                size_t size,         //!< Size of the encoded message.
+                size_t &pos,         //!< Read position.
+                uint8_t tag          //!< Expected tag.
+                ) -> std::optional<size_t>;
+
+/*!
+  Read a BER integer of any integer tag.  On success `pos` is advanced past the
+  integer.
+
+  \return `std::optional<int64_t>`: Value or `std::nullopt` if malformed.
+*/
+[[nodiscard]] auto
+ber_read_integer(uint8_t const *data, //!< Encoded message.
+                 size_t size,         //!< Size of the encoded message.
+                 size_t &pos,         //!< Read position.
+                 uint8_t tag          //!< Expected tag.
+                 ) -> std::optional<int64_t>;
+
+/*!
+  Extract the request-id from an SNMPv1/v2c message without decoding the rest
+  of the message.  Works for both request and response PDUs.
+
+  \return `std::optional<int64_t>`: Request-id or `std::nullopt` if the message
+  is not a community based SNMP message.
+*/
+[[nodiscard]] auto
+ber_peek_request_id(uint8_t const *data, //!< Encoded message.
+                    size_t size          //!< Size of the encoded message.
+                    ) -> std::optional<int64_t>;
+
+/*!
+  Encode an SNMPv1/v2c request into `buffer` with a NULL value for each OID.
+  The buffer is resized to the encoded message and keeps its capacity between
+  calls.  For GETBULK the error status and index fields carry
+  `non_repeaters` and `max_repetitions`.
+*/
+void ber_encode_request(
+    std::vector<uint8_t> &buffer,                  //!< Output buffer.
+    int64_t version,                               //!< SNMP version.
+    std::string const &community,                 //!< Community string.
+    uint8_t command,                               //!< PDU type.
+    int64_t request_id,                            //!< Request-id.
+    int64_t non_repeaters,                         //!< Error status field.
+    int64_t max_repetitions,                       //!< Error index field.
+    std::vector<ObjectIdentity const *> const &oids //!< Request OIDs.
+);
+
+/*!
+  Decode an SNMPv1/v2c message up to the variable bindings.
+
+  \return `std::optional<BerPdu>`: Message or `std::nullopt` if malformed.
+*/
+[[nodiscard]] auto ber_decode_pdu(uint8_t const *data, //!< Encoded message.
+                                  size_t size //!< Size of the encoded message.
+                                  ) -> std::optional<BerPdu>;
+
+/*!
+  Decode the next variable binding.  On success `pos` is advanced past the
+  variable binding.
+
+  \return `bool`: `false` if the variable binding is malformed.
+*/
+[[nodiscard]] auto
+ber_decode_var_bind(uint8_t const *data,  //!< Encoded message.
+                    size_t end,           //!< End of the variable bindings.
+                    size_t &pos,          //!< Read position.
+                    BerScratch &scratch,  //!< Decoding storage.
+                    VarBind &var_bind     //!< Decoded variable binding.
+                    ) -> bool;
+
+} // namespace snmp_stream
+
+#endif
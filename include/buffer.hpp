@@ -0,0 +1,201 @@
+// snmp_stream/_snmp_stream/buffer.hpp
+
+#ifndef BUFFER_HPP
+#define BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "shm.hpp"
+
+// default size of a pooled result segment
+#define DEFAULT_RESULT_SEGMENT_BYTES (1024 * 1024)
+
+namespace snmp_stream {
+
+/*!
+  Thread-safe pool of fixed-size, uninitialized result segments.  Released
+  segments are kept for reuse, so steady state collection does not allocate
+  and the pool holds at most the peak number of segments in use.
+*/
+class SegmentPool {
+private:
+  size_t segment_size; //!< Size of each segment in bytes.
+  std::mutex mutex;    //!< Guards `segments`.
+  std::vector<std::unique_ptr<uint8_t[]>> segments; //!< Free segments.
+
+public:
+  /*!
+    \exception std::invalid_argument `segment_size` is not greater than 0.
+  */
+  explicit SegmentPool(size_t segment_size //!< Size of each segment in bytes.
+  );
+
+  SegmentPool(SegmentPool const &) = delete;
+  auto operator=(SegmentPool const &) -> SegmentPool & = delete;
+
+  /*!
+    Take a free segment or allocate a new one.
+
+    \return `std::unique_ptr<uint8_t[]>`: Segment of `segment_size` bytes.
+  */
+  [[nodiscard]] auto acquire() -> std::unique_ptr<uint8_t[]>;
+
+  /*!
+    Return a segment taken with `acquire`.
+  */
+  void release(std::unique_ptr<uint8_t[]> segment //!< Segment.
+  );
+
+  /*!
+    Get the size of each segment in bytes.
+
+    \return `size_t`
+  */
+  [[nodiscard]] inline auto get_segment_size() const -> size_t {
+    return segment_size;
+  }
+};
+
+/*!
+  Append-only result buffer made of segments.  Every `append` is contiguous
+  and never straddles two segments, so the concatenation of the segments is
+  the complete wireline record stream and each segment on its own only holds
+  whole records.  Space is not zero-filled.  Segments are taken from a pool,
+  allocated on demand or, for results handed to another process, created in
+  shared memory.
+*/
+class ResultBuffer {
+private:
+  /*!
+    Buffer segment.
+  */
+  struct Segment {
+    std::unique_ptr<uint8_t[]> memory;     //!< Heap memory or `nullptr`.
+    std::unique_ptr<SharedSegment> shared; //!< Shared memory or `nullptr`.
+    uint8_t *data;                         //!< Segment memory.
+    size_t capacity;                       //!< Size of the segment memory.
+    size_t size;                           //!< Bytes used.
+    bool pooled;                           //!< Segment belongs to the pool.
+  };
+
+  std::shared_ptr<SegmentPool>
+      pool; //!< Segment pool or `nullptr` to allocate segments on demand.
+  bool shared; //!< Create new segments in shared memory.  The pool only
+               //!< sets their size.
+  std::vector<Segment> segments; //!< Segments in append order.
+  size_t size;                   //!< Total bytes used.
+
+public:
+  explicit ResultBuffer(
+      std::shared_ptr<SegmentPool> pool = nullptr, //!< Segment pool.
+      bool shared = false //!< Create the segments in shared memory.
+  );
+
+  /*!
+    Copy raw results into a single segment.
+  */
+  explicit ResultBuffer(std::vector<uint8_t> const &data //!< Raw results.
+  );
+
+  /*!
+    Map shared memory segments handed off by another process with
+    `hand_off`.
+
+    \exception std::runtime_error A segment could not be opened.
+  */
+  explicit ResultBuffer(
+      std::vector<std::pair<std::string, size_t>> const
+          &handles //!< Name and used size of each segment.
+  );
+
+  /*!
+    Return the pooled segments to the pool.
+  */
+  ~ResultBuffer();
+
+  ResultBuffer(ResultBuffer const &) = delete;
+  auto operator=(ResultBuffer const &) -> ResultBuffer & = delete;
+
+  /*!
+    Reserve contiguous, uninitialized space at the end of the buffer.  The
+    pointer is valid until the buffer is destroyed.
+
+    \return `uint8_t *`
+  */
+  [[nodiscard]] auto append(size_t size //!< Bytes to reserve.
+                            ) -> uint8_t *;
+
+  /*!
+    Check if the buffer has segments and every one is in shared memory
+    created by this process and not handed off yet, so the buffer can be
+    handed off.  A buffer is handed off once; later pickles copy it.
+
+    \return `bool`
+  */
+  [[nodiscard]] auto can_hand_off() const -> bool;
+
+  /*!
+    Keep the shared memory segments for another process to map.  Only valid
+    if `can_hand_off`.  The segments can be mapped once; memory of segments
+    that are never mapped is only freed when their names are unlinked.
+
+    \return `std::vector<std::pair<std::string, size_t>>`: Name and used size
+    of each segment.
+  */
+  [[nodiscard]] auto hand_off()
+      -> std::vector<std::pair<std::string, size_t>>;
+
+  /*!
+    Get the number of segments.
+
+    \return `size_t`
+  */
+  [[nodiscard]] inline auto get_segment_count() const -> size_t {
+    return segments.size();
+  }
+
+  /*!
+    Get the used portion of a segment.
+
+    \return `std::pair<uint8_t const *, size_t>`: Data and size.
+  */
+  [[nodiscard]] inline auto get_segment(size_t index //!< Segment index.
+                                        ) const
+      -> std::pair<uint8_t const *, size_t> {
+    return {segments[index].data, segments[index].size};
+  }
+
+  /*!
+    Copy the segments into one contiguous vector.
+
+    \return `std::vector<uint8_t>`
+  */
+  [[nodiscard]] auto to_vector() const -> std::vector<uint8_t>;
+
+  /*!
+    Get the total number of bytes used.
+
+    \return `size_t`
+  */
+  [[nodiscard]] inline auto get_size() const -> size_t { return size; }
+};
+
+/*!
+  Compare the contents of two `ResultBuffer`.
+
+  \return `bool`
+*/
+[[nodiscard]] auto
+operator==(ResultBuffer const &lhs, //!< Left-hand side object to compare.
+           ResultBuffer const &rhs  //!< Right-hand side object to compare.
+           ) -> bool;
+
+} // namespace snmp_stream
+
+#endif
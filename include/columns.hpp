@@ -0,0 +1,218 @@
+// snmp_stream/_snmp_stream/columns.hpp
+
+#ifndef COLUMNS_HPP
+#define COLUMNS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+}
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+// Arrow C data interface, ABI-stable and copied verbatim from the Arrow
+// specification so results can be handed to Arrow without linking it.
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray *);
+  // Opaque producer-specific data
+  void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+// entries left below the 32-bit Arrow offset limit of a variable length column
+// when a session hands off its columns in a partial response
+#define COLUMN_OFFSET_HEADROOM (1 << 24)
+
+namespace snmp_stream {
+
+/*!
+  Validity bitmap in Arrow's layout: one bit per row, least significant bit
+  first, set for rows holding a value.
+*/
+struct ValidityBitmap {
+  std::vector<uint8_t> bits; //!< Packed bits.
+  size_t valid = 0;          //!< Number of set bits.
+
+  /*!
+    Append the bit of the next row.
+  */
+  inline void append(size_t row,   //!< Row the bit belongs to.
+                     bool is_valid //!< Row holds a value.
+  ) {
+    if (row % 8 == 0) {
+      bits.push_back(0);
+    }
+    if (is_valid) {
+      bits.back() |= (uint8_t)(1U << (row % 8));
+      valid++;
+    }
+  }
+};
+
+/*!
+  Columns of the results of one root OID in Arrow's memory layout.  Every
+  row has a stamp, a type and an index; the value lands in the column
+  matching its type and is null in the others.  Integers are in `integer`,
+  unsigned types and Counter64 in `uinteger`, counter rates add `delta` and
+  `rate`, and everything else with a value, object identifiers included, is
+  kept as raw bytes in `octets`.
+*/
+struct ColumnTable {
+  size_t length;                       //!< Number of rows.
+  std::vector<uint64_t> stamps;        //!< Index of the row's `PduStamp`.
+  std::vector<uint8_t> types;          //!< Value type.
+  std::vector<int32_t> index_offsets;  //!< Offsets into `index`.
+  std::vector<uint64_t> index;         //!< Index sub-identifiers.
+  ValidityBitmap integer_validity;     //!< Rows with an `integer` value.
+  std::vector<int64_t> integer;        //!< Signed values.
+  ValidityBitmap uinteger_validity;    //!< Rows with an `uinteger` value.
+  std::vector<uint64_t> uinteger;      //!< Unsigned values.
+  ValidityBitmap rate_validity;        //!< Rows with a `delta` and `rate`.
+  std::vector<uint64_t> delta;         //!< Counter increase.
+  std::vector<double> rate;            //!< Counter increase per second.
+  ValidityBitmap octets_validity;      //!< Rows with an `octets` value.
+  std::vector<int32_t> octets_offsets; //!< Offsets into `octets`.
+  std::vector<uint8_t> octets;         //!< Raw values.
+
+  ColumnTable();
+};
+
+/*!
+  Results collected into one `ColumnTable` per root OID instead of wireline
+  records.  Columns only grow while a session collects into them and are
+  immutable once handed off in a response, so they can be shared without
+  copying.
+*/
+class ColumnarResults {
+private:
+  std::vector<ColumnTable> tables; //!< Columns by root OID index.
+
+public:
+  explicit ColumnarResults(size_t root_oids //!< Number of root OIDs.
+  );
+
+  /*!
+    Restore columns serialized with `to_vector`.
+
+    \exception std::invalid_argument `data` is not a serialized
+    `ColumnarResults`.
+  */
+  explicit ColumnarResults(std::vector<uint8_t> const &data //!< Serialized
+                                                           //!< columns.
+  );
+
+  /*!
+    Append a row to the table of a root OID.  Checked before any column
+    grows, so a row that does not fit leaves the table unchanged.
+
+    \exception std::runtime_error A variable length column would exceed the
+    entries addressable by 32-bit Arrow offsets.
+  */
+  void append(size_t root_oid_index, //!< Root OID index.
+              oid const *index,      //!< Index sub-identifiers.
+              size_t index_size,     //!< Number of index sub-identifiers.
+              uint8_t type,          //!< Value type.
+              void const *value,     //!< Value.
+              size_t value_length,   //!< Size of the value in bytes.
+              size_t stamp_index     //!< Index of the row's `PduStamp`.
+  );
+
+  /*!
+    Serialize the columns for pickling.
+
+    \return `std::vector<uint8_t>`
+  */
+  [[nodiscard]] auto to_vector() const -> std::vector<uint8_t>;
+
+  /*!
+    Get the tables by root OID index.
+
+    \return `std::vector<ColumnTable> const &`
+  */
+  [[nodiscard]] inline auto get_tables() const
+      -> std::vector<ColumnTable> const & {
+    return tables;
+  }
+
+  /*!
+    Get the number of bytes held by the columns.
+
+    \return `size_t`
+  */
+  [[nodiscard]] auto get_size() const -> size_t;
+
+  /*!
+    Check if a variable length column of a table is within
+    `COLUMN_OFFSET_HEADROOM` entries of the 32-bit Arrow offset limit.
+
+    \return `bool`
+  */
+  [[nodiscard]] auto is_near_offset_limit() const -> bool;
+};
+
+/*!
+  Compare the contents of two `ColumnarResults`.
+
+  \return `bool`
+*/
+[[nodiscard]] auto
+operator==(ColumnarResults const &lhs, //!< Left-hand side object to compare.
+           ColumnarResults const &rhs  //!< Right-hand side object to compare.
+           ) -> bool;
+
+/*!
+  Export the table of a root OID through the Arrow C data interface as a
+  struct array of the columns (a record batch).  The buffers are not copied;
+  the exported array keeps `columns` alive until it is released.
+
+  \exception std::out_of_range `root_oid_index` has no table.
+*/
+void export_arrow(
+    std::shared_ptr<ColumnarResults const> const &columns, //!< Columns.
+    size_t root_oid_index, //!< Root OID index of the table.
+    ArrowSchema *schema,   //!< Uninitialized schema to export into.
+    ArrowArray *array      //!< Uninitialized array to export into.
+);
+
+} // namespace snmp_stream
+
+#endif
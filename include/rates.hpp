@@ -0,0 +1,88 @@
+// snmp_stream/_snmp_stream/rates.hpp
+
+#ifndef RATES_HPP
+#define RATES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "ber.hpp"
+#include "types.hpp"
+
+// value type of the records holding a `CounterRate`
+#define COUNTER_RATE 0xF0
+// highest increase per second a Counter32 wrap is believed at, a 100 Gbit/s
+// interface in octets; a counter going further backwards was reset
+#define COUNTER32_MAX_WRAP_RATE 1.25e10
+
+namespace snmp_stream {
+
+/*!
+  Value of a `COUNTER_RATE` record.
+*/
+struct CounterRate {
+  uint64_t value; //!< Raw counter value.
+  uint64_t delta; //!< Increase since the previous sample, across a
+                  //!< Counter32 wrap.
+  double rate;    //!< Increase per second between the response PDU stamps.
+};
+
+/*!
+  Counter samples of a single host, kept across polls to turn Counter32 and
+  Counter64 values into deltas and rates.  Samples are keyed by OID and
+  dropped when the agent's sysUpTime.0 goes backwards.  A Counter32 going
+  backwards is a single wrap unless the increase it implies is beyond
+  `COUNTER32_MAX_WRAP_RATE`; a Counter64 going backwards, or a Counter32
+  beyond that rate, was reset and only re-seeds the sample.  Thread-safe so
+  sessions to the same host on different workers can share it.
+*/
+class CounterRates {
+private:
+  /*!
+    Previous sample of a counter.
+  */
+  struct Sample {
+    ObjectIdentity oid;   //!< Counter OID.
+    uint8_t type;         //!< Counter type.
+    uint64_t value;       //!< Counter value.
+    int64_t monotonic_ns; //!< Receive time of the response PDU.
+  };
+
+  std::mutex mutex; //!< Guards the samples.
+  std::unordered_map<uint64_t, Sample>
+      samples; //!< Samples by OID hash.  Collisions replace the sample.
+  std::optional<uint32_t> uptime; //!< Last sysUpTime.0 in hundredths.
+  int64_t uptime_monotonic_ns;    //!< Receive time of `uptime`.
+
+  /*!
+    Drop the samples when sysUpTime.0 shows the agent restarted.
+  */
+  void sample_uptime(uint32_t ticks,      //!< sysUpTime.0.
+                     int64_t monotonic_ns //!< Receive time.
+  );
+
+public:
+  CounterRates();
+
+  CounterRates(CounterRates const &) = delete;
+  auto operator=(CounterRates const &) -> CounterRates & = delete;
+
+  /*!
+    Sample a response variable binding.  sysUpTime.0 is checked for agent
+    restarts; counters are compared to their previous sample.
+
+    \return `std::optional<CounterRate>`: Rate or `std::nullopt` if the
+    variable binding is not a counter or has no usable previous sample.
+  */
+  [[nodiscard]] auto sample(VarBind const &var_bind, //!< Variable binding.
+                            int64_t monotonic_ns //!< Receive time of the
+                                                 //!< response PDU.
+                            ) -> std::optional<CounterRate>;
+};
+
+} // namespace snmp_stream
+
+#endif
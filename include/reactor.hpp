@@ -0,0 +1,107 @@
+// snmp_stream/_snmp_stream/reactor.hpp
+
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include <sys/epoll.h>
+
+namespace snmp_stream {
+
+/*!
+  Readiness loop over an arbitrary number of sockets.  Wraps a single epoll
+  instance so that waiting is independent of the number of registered file
+  descriptors and is not bound by `FD_SETSIZE`.
+*/
+class Reactor {
+private:
+  int epoll_fd;                    //!< epoll instance.
+  std::vector<epoll_event> events; //!< Ready events from the last wait.
+  size_t registered;               //!< Number of registered descriptors.
+
+public:
+  /*!
+    \exception std::runtime_error The epoll instance could not be created.
+  */
+  Reactor();
+
+  /*!
+    Close the epoll instance.
+  */
+  ~Reactor();
+
+  Reactor(Reactor const &) = delete;
+  auto operator=(Reactor const &) -> Reactor & = delete;
+
+  /*!
+    Watch a file descriptor for readability.
+
+    \exception std::runtime_error The descriptor could not be registered.
+  */
+  void add(int fd,    //!< File descriptor.
+           void *data //!< Opaque pointer returned by `get_ready`.
+  );
+
+  /*!
+    Also watch a file descriptor added with `add` for writability, or stop
+    doing so.
+
+    \exception std::runtime_error The descriptor could not be modified.
+  */
+  void watch_writable(int fd,        //!< File descriptor.
+                      void *data,    //!< Opaque pointer returned by
+                                     //!< `get_ready`.
+                      bool writable  //!< Watch for writability.
+  );
+
+  /*!
+    Stop watching a file descriptor.
+  */
+  void remove(int fd //!< File descriptor.
+  );
+
+  /*!
+    Wait until one or more descriptors are ready or the deadline passes.
+    Interrupted waits are reported as zero ready descriptors.
+
+    \return `size_t`: Number of ready descriptors.
+  */
+  [[nodiscard]] auto
+  wait(std::optional<std::chrono::steady_clock::time_point> const
+           &deadline //!< Wake-up deadline.  `std::nullopt` blocks.
+       ) -> size_t;
+
+  /*!
+    Get the opaque pointer of a ready descriptor from the last wait.
+
+    \return `void *`
+  */
+  [[nodiscard]] inline auto get_ready(size_t index //!< Ready index.
+  ) const -> void * {
+    return events[index].data.ptr;
+  }
+
+  /*!
+    Get the epoll events of a ready descriptor from the last wait.
+
+    \return `uint32_t`
+  */
+  [[nodiscard]] inline auto get_ready_events(size_t index //!< Ready index.
+  ) const -> uint32_t {
+    return events[index].events;
+  }
+
+  /*!
+    Get the epoll file descriptor.
+
+    \return `int`
+  */
+  [[nodiscard]] inline auto get_fd() const -> int { return epoll_fd; }
+};
+
+} // namespace snmp_stream
+
+#endif
@@ -0,0 +1,61 @@
+// snmp_stream/_snmp_stream/rtt.hpp
+
+#ifndef RTT_HPP
+#define RTT_HPP
+
+#include <chrono>
+#include <cstddef>
+
+// lower bound on the retransmission timeout in milliseconds
+#define MIN_RETRANSMIT_TIMEOUT_MS 200
+
+namespace snmp_stream {
+
+/*!
+  Round trip time estimator of a single host (Jacobson/Karels, RFC 6298).
+  Tracks the smoothed round trip time and its variation from the responses
+  to unretransmitted requests and derives the retransmission timeout from
+  them.
+*/
+class RttEstimator {
+private:
+  std::chrono::nanoseconds srtt;   //!< Smoothed round trip time.
+  std::chrono::nanoseconds rttvar; //!< Round trip time variation.
+  size_t samples;                  //!< Number of round trip time samples.
+
+public:
+  RttEstimator();
+
+  /*!
+    Add the round trip time of a response.  Per Karn's algorithm, only
+    responses to requests that were not retransmitted are sampled.
+  */
+  void sample(std::chrono::nanoseconds rtt //!< Round trip time.
+  );
+
+  /*!
+    Get the retransmission timeout `srtt + 4 * rttvar`, doubled for each
+    retransmission and clamped to [`MIN_RETRANSMIT_TIMEOUT_MS`,
+    `max_timeout`].  Without samples, this is `max_timeout`.
+
+    \return `std::chrono::nanoseconds`
+  */
+  [[nodiscard]] auto get_retransmit_timeout(
+      std::chrono::nanoseconds max_timeout, //!< Configured timeout.
+      size_t retransmits //!< Retransmissions of the outstanding request.
+  ) const -> std::chrono::nanoseconds;
+
+  [[nodiscard]] inline auto get_srtt() const -> std::chrono::nanoseconds {
+    return srtt;
+  }
+
+  [[nodiscard]] inline auto get_rttvar() const -> std::chrono::nanoseconds {
+    return rttvar;
+  }
+
+  [[nodiscard]] inline auto get_samples() const -> size_t { return samples; }
+};
+
+} // namespace snmp_stream
+
+#endif
@@ -0,0 +1,65 @@
+// snmp_stream/_snmp_stream/scheduler.hpp
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace snmp_stream {
+
+/*!
+  Get the key a host is limited under.  Literal IPv4 and IPv6 addresses are
+  masked to their subnet so the hosts of a subnet share their limits; names
+  are keyed as given.  The transport prefix and the port are ignored.
+
+  \return `std::string`
+*/
+[[nodiscard]] auto get_host_key(std::string const &host, //!< Host.
+                                size_t ipv4_prefix_length, //!< IPv4 subnet
+                                                           //!< prefix length.
+                                size_t ipv6_prefix_length  //!< IPv6 subnet
+                                                           //!< prefix length.
+                                ) -> std::string;
+
+/*!
+  Thread-safe token bucket pacing the request PDUs sent to a host.  Tokens
+  refill at `rate` per second up to `burst`, and the bucket starts full.
+*/
+class TokenBucket {
+private:
+  std::mutex mutex; //!< Guards `tokens` and `updated`.
+  double rate;      //!< Tokens added per second.
+  double burst;     //!< Maximum number of tokens.
+  double tokens;    //!< Available tokens.
+  std::chrono::steady_clock::time_point updated; //!< Last refill.
+
+public:
+  /*!
+    \exception std::invalid_argument `rate` is not greater than 0.
+  */
+  TokenBucket(double rate, //!< Tokens added per second.
+              double burst //!< Maximum number of tokens.  Raised to 1.
+  );
+
+  TokenBucket(TokenBucket const &) = delete;
+  auto operator=(TokenBucket const &) -> TokenBucket & = delete;
+
+  /*!
+    Take a token if one is available.
+
+    \return `std::optional<std::chrono::steady_clock::time_point>`:
+    `std::nullopt` if a token was taken, otherwise when the next token is
+    available.
+  */
+  [[nodiscard]] auto take(std::chrono::steady_clock::time_point now //!< Now.
+                          )
+      -> std::optional<std::chrono::steady_clock::time_point>;
+};
+
+} // namespace snmp_stream
+
+#endif
@@ -3,9 +3,26 @@
 #ifndef SESSION_HPP
 #define SESSION_HPP
 
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <list>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
+#include "ber.hpp"
+#include "rates.hpp"
+#include "reactor.hpp"
+#include "rtt.hpp"
+#include "scheduler.hpp"
+#include "sink.hpp"
+#include "timer.hpp"
+#include "transport.hpp"
 #include "types.hpp"
 
 #define NO_SUCH_OBJECT 128
@@ -29,15 +46,20 @@ private:
                      //!< as it is used to determine if this collection node is
                      //!< complete (req_oid.has_value() &&
                      //!< !last_resp_oid.has_value).
-  std::shared_ptr<std::vector<uint8_t>> results; //!< Collected results.
+  bool completed; //!< Collection node has no more results to collect.
+  size_t pdu_slot; //!< Pipeline slot of the request PDU the collection node
+                   //!< is in while `req_oid` is set.
+  std::optional<ssize_t>
+      retries_left; //!< Resends left to the next request after a timed out
+                    //!< request was made smaller, or `std::nullopt` for all
+                    //!< of them.
 
 public:
   CollectionHead(
       size_t root_oid_index,   //!< Root OID index.
       ObjectIdentity root_oid, //!< Root OID.
-      std::optional<ObjectIdentityRange> const
-          &range,                                   //!< Range to be collected.
-      std::shared_ptr<std::vector<uint8_t>> results //!< Collected results.
+      std::optional<ObjectIdentityRange> const &range //!< Range to be
+                                                      //!< collected.
   );
 
   /*!
@@ -45,12 +67,45 @@ public:
   */
   inline void reset_req_oid() { req_oid = std::nullopt; }
 
+  /*!
+    Deactivates collection head so the next request repeats the outstanding
+    one.
+  */
+  inline void retry_req_oid(
+      std::optional<ssize_t> retries_left = std::nullopt //!< Resends left to
+                                                         //!< the next request.
+  ) {
+    last_resp_oid = req_oid;
+    req_oid = std::nullopt;
+    this->retries_left = retries_left;
+  }
+
+  /*!
+    Take the resends left to the next request set by `retry_req_oid`.
+
+    \return `std::optional<ssize_t>`: `std::nullopt` for all of them.
+  */
+  [[nodiscard]] inline auto take_retries_left() -> std::optional<ssize_t> {
+    return std::exchange(retries_left, std::nullopt);
+  }
+
+  /*!
+    Permanently deactivates collection head.
+  */
+  inline void complete() {
+    req_oid = std::nullopt;
+    completed = true;
+  }
+
   /*!
     Collection head is considered active.
   */
-  [[nodiscard]] inline auto get_next_req_oid() -> ObjectIdentity const & {
+  [[nodiscard]] inline auto get_next_req_oid(
+      size_t pdu_slot = 0 //!< Pipeline slot of the request PDU.
+      ) -> ObjectIdentity const & {
     req_oid = last_resp_oid.value_or(root_oid);
     last_resp_oid = std::nullopt;
+    this->pdu_slot = pdu_slot;
     return *req_oid;
   }
 
@@ -59,14 +114,33 @@ public:
   INLINE_CONST_GETTER(CollectionHead, range);
   INLINE_CONST_GETTER(CollectionHead, req_oid);
   INLINE_CONST_GETTER(CollectionHead, last_resp_oid);
-  INLINE_CONST_GETTER(CollectionHead, results);
+  INLINE_CONST_GETTER(CollectionHead, completed);
+  INLINE_CONST_GETTER(CollectionHead, pdu_slot);
 
+  INLINE_SETTER(CollectionHead, range);
   INLINE_SETTER(CollectionHead, last_resp_oid);
 
   /*!
     Append a variable binding to this result.
   */
-  void append_result(variable_list const &resp_var_bind);
+  void append_result(ResultBuffer &results,        //!< Collected results.
+                     VarBind const &resp_var_bind, //!< Variable binding.
+                     size_t stamp_index, //!< Index of the receive stamp of
+                                         //!< the response PDU.
+                     uint8_t version,    //!< Wireline version.
+                     std::vector<oid_t> &previous_index //!< Index of the
+                                                        //!< previous record
+                                                        //!< of the root OID.
+  );
+
+  /*!
+    Append a variable binding to the columns of this result's root OID.
+  */
+  void append_result(ColumnarResults &columns,     //!< Collected columns.
+                     VarBind const &resp_var_bind, //!< Variable binding.
+                     size_t stamp_index //!< Index of the receive stamp of
+                                        //!< the response PDU.
+  );
 };
 
 /*!
@@ -84,6 +158,26 @@ public:
   };
 
 private:
+  /*!
+    Pipeline slot of a request PDU awaiting its response.  Slots are reused,
+    so their message buffers are only allocated once.
+  */
+  struct OutstandingPdu {
+    bool active;   //!< Slot holds an outstanding request.
+    int64_t reqid; //!< Request-id of the request.
+    std::vector<CollectionHead *> heads; //!< Collection nodes in the PDU.
+    std::vector<uint8_t> message; //!< Encoded request kept for resends.
+    size_t var_binds;     //!< Variable bindings requested by the PDU.
+    ssize_t retries_left; //!< Resends left.
+    bool shrunk; //!< Repeats a timed out request with fewer variable
+                 //!< bindings, so it is not made smaller on timeout again.
+    size_t retransmits;   //!< Retransmissions of the request.
+    std::chrono::steady_clock::time_point
+        sent_at; //!< Last (re)transmission of the request.
+    std::chrono::steady_clock::time_point
+        deadline; //!< Retry or timeout deadline.
+  };
+
   SessionStatus status;   //!< Session status.
   SnmpRequest request;    //!< SNMP request used to build this session.
   int pdu_type;           //!< PDU type.
@@ -94,22 +188,243 @@ href="http://net-snmp.sourceforge.net/dev/agent/structsnmp__session.html">
 NET-SNMP session
 </a>.
 */
-  std::shared_ptr<std::vector<uint8_t>> results; //!< Collected results.
-  std::list<std::unique_ptr<CollectionHead>>
-      collection_heads; //!< Collection nodes.
+  std::shared_ptr<SegmentPool> pool;     //!< Pool of result segments.
+  std::shared_ptr<ResultBuffer> results; //!< Collected results.
+  std::shared_ptr<ColumnarResults>
+      columns; //!< Collected columns or `nullptr` to collect wireline
+               //!< records into `results`.
+  size_t result_records; //!< Records in `results` or `columns`.
+  std::shared_ptr<ResultSink>
+      sink; //!< Sink the wireline results are handed off to or `nullptr` to
+            //!< return them in the responses.
+  std::vector<std::vector<oid_t>>
+      previous_indexes; //!< Index of the last record of each root OID in
+                        //!< `results`, for delta encoded indexes.
+  std::deque<CollectionHead>
+      collection_heads; //!< Collection nodes.  Only appended to, so pointers
+                        //!< remain valid as partitions are split off.
+  std::vector<size_t>
+      root_partitions; //!< Incomplete collection nodes per root OID.
+  std::vector<CollectionHead *>
+      head_index; //!< Collection nodes sorted by range start.
+  std::vector<std::optional<ObjectIdentity>>
+      head_index_limits; //!< Running maximum over `head_index` of the first
+                         //!< OID past each range stop's subtree.
+                         //!< `std::nullopt` is unbounded.
+  std::vector<CollectionHead *>
+      head_ring; //!< Round-robin order of the collection nodes.  Completed
+                 //!< nodes are skipped and compacted lazily.
+  size_t head_ring_pos;  //!< Next position in `head_ring`.
+  size_t stale_heads;    //!< Completed nodes still in `head_ring`.
+  size_t active_heads;   //!< Number of incomplete collection nodes.
+  size_t busy_heads;     //!< Collection nodes in outstanding PDUs.
+  std::vector<OutstandingPdu>
+      pdus; //!< Pipeline slots.  Sessions on a shared transport have
+            //!< `Config::pipeline_depth` slots, NET-SNMP sessions one.
   bool err_flag;        //!< Marks this session as hitting a critical error.
   std::vector<SnmpError> errors; //!< Collected errors.
+  Transport *transport;  //!< Shared transport or `nullptr`.
+  Transport::Peer *peer; //!< Endpoint on the shared transport or `nullptr`
+                         //!< when the session uses NET-SNMP.
+  std::vector<ObjectIdentity const *>
+      req_oids;       //!< Request OIDs scratch for encoding.
+  BerScratch scratch; //!< Response decoding storage.
+  std::vector<PduStamp> stamps; //!< Receive stamps of the response PDUs.
+  size_t bulk_var_binds; //!< Variable bindings to request per GETBULK
+                         //!< response; adapted per device with
+                         //!< `adaptive_repetitions`.
+  RttEstimator *rtt;     //!< Round trip time estimator of the host or
+                         //!< `nullptr` to always wait the configured timeout.
+  TokenBucket *bucket;   //!< PDU rate limit of the host or `nullptr`.
+  CounterRates *counters; //!< Counter samples of the host or `nullptr` to
+                          //!< emit raw counter values.
+  std::optional<size_t> job; //!< Recurring job that started the session.
+  std::optional<std::chrono::steady_clock::time_point>
+      throttled_until; //!< When the rate limit allows the next new PDU.
 
   /*!
     Process a response variable binding.
   */
   static void
-  process_var_bind(variable_list const &resp_var_bind, //!< Variable binding.
-                   Session &session                    //!< Session.
+  process_var_bind(VarBind const &resp_var_bind, //!< Variable binding.
+                   Session &session,             //!< Session.
+                   size_t slot //!< Pipeline slot of the response PDU.
+  );
+
+  /*!
+    Encode and send a request over the shared transport from a free pipeline
+    slot.
+  */
+  void send_native(size_t slot, //!< Free pipeline slot.
+                   size_t oids  //!< Maximum number of request OIDs.
+  );
+
+  /*!
+    Start a new results buffer and write the results header.  With
+    columnar results, new columns are started as well and the buffer only
+    holds the header.
+  */
+  void start_results();
+
+  /*!
+    Hand off the wireline records collected so far to the sink and keep
+    collecting into a new buffer holding only the header.  On failure the
+    records stay in `results` and a `SINK_ERROR` is recorded.
+  */
+  void write_sink();
+
+  /*!
+    Build the range index once the collection nodes are created.
+  */
+  void index_collection_heads();
+
+  /*!
+    Sort the range index and recompute its subtree limits.
+  */
+  void sort_collection_heads();
+
+  /*!
+    With `auto_partition`, split the rest of a walked range off a collection
+    node into a new node once the node's last response PDU stayed within one
+    subtree below the root OID.  The node keeps walking that subtree and the
+    new node walks the remainder concurrently.
+  */
+  void partition_collection_head(CollectionHead &head //!< Collection node.
+  );
+
+  /*!
+    Find the active collection node a response OID belongs to.  Binary
+    searches the range index instead of testing every node.
+
+    \return `CollectionHead *`: Collection node or `nullptr` if none.
+  */
+  [[nodiscard]] auto
+  find_collection_head(ObjectIdentity const &resp_oid, //!< Response OID.
+                       size_t slot //!< Pipeline slot of the response PDU.
+                       ) -> CollectionHead *;
+
+  /*!
+    Get the next incomplete collection node that is not in an outstanding PDU
+    in round-robin order.  Only call while `busy_heads` is less than
+    `active_heads`.
+
+    \return `CollectionHead &`
+  */
+  [[nodiscard]] auto next_collection_head() -> CollectionHead &;
+
+  /*!
+    Complete a collection node and drop it from the round-robin order.
+  */
+  void complete_collection_head(CollectionHead &head //!< Collection node.
+  );
+
+  /*!
+    Stamp a received response PDU.  Records appended while processing it
+    reference the new stamp.
+  */
+  void stamp_pdu(size_t slot //!< Pipeline slot of the response PDU.
+  );
+
+  /*!
+    Take a token from the host's rate limit before sending a new request PDU.
+    Retransmissions are not paced.
+
+    \return `bool`: `true` if the PDU must wait until `throttled_until`.
+  */
+  [[nodiscard]] auto throttle() -> bool;
+
+  /*!
+    Get the time to wait for a response before retransmitting an outstanding
+    request.
+
+    \return `std::chrono::nanoseconds`
+  */
+  [[nodiscard]] auto
+  get_retransmit_timeout(size_t slot //!< Pipeline slot of the request.
+                         ) const -> std::chrono::nanoseconds;
+
+  /*!
+    Get the number of variable bindings to request per response PDU.
+
+    \return `size_t`
+  */
+  [[nodiscard]] auto get_var_binds_per_pdu() const -> size_t;
+
+  /*!
+    With `adaptive_repetitions`, halve the variable bindings per GETBULK
+    response and free the pipeline slot so a later PDU repeats its request.
+
+    \return `bool`: `false` if the PDU cannot be made smaller.
+  */
+  [[nodiscard]] auto retry_smaller_pdu(
+      size_t slot, //!< Pipeline slot of the request.
+      std::optional<ssize_t> retries_left =
+          std::nullopt //!< Resends left to the repeated request, or
+                       //!< `std::nullopt` for all of them.
+      ) -> bool;
+
+  /*!
+    Check if a timed out PDU is answered with a smaller one: with
+    `adaptive_repetitions`, on the first timeout of a PDU that has resends
+    left and is not itself a smaller repeat.
+
+    \return `bool`
+  */
+  [[nodiscard]] auto
+  can_shrink_timed_out_pdu(size_t slot //!< Pipeline slot of the request.
+                           ) const -> bool;
+
+  /*!
+    Repeat a timed out PDU with half the variable bindings if
+    `can_shrink_timed_out_pdu`.  The timeout counts as a resend, so the
+    repeat only has the resends left and a host that does not answer still
+    fails after `retries + 1` timeouts.
+
+    \return `bool`: `false` if the PDU is not made smaller.
+  */
+  [[nodiscard]] auto
+  shrink_timed_out_pdu(size_t slot //!< Pipeline slot of the request.
+                       ) -> bool;
+
+  /*!
+    Set the resends of a new PDU: all of them, or what is left to the heads
+    that repeat a timed out request.
+  */
+  void start_retries(OutstandingPdu &pdu //!< Request PDU.
+  );
+
+  /*!
+    With `adaptive_repetitions`, request one more repetition per OID after a
+    complete and fast response.
+  */
+  void grow_pdu(size_t slot,          //!< Pipeline slot of the response PDU.
+                size_t resp_var_binds //!< Variable bindings in the response.
+  );
+
+  /*!
+    Record a timed out request and close the session.
+  */
+  void process_timeout();
+
+  /*!
+    Remove the collection heads that had a request but no response, free the
+    pipeline slot and close the session once all have completed.
+  */
+  void complete_pdu(size_t slot //!< Pipeline slot of the response PDU.
   );
 
   /*!
-    NET-SNMP callback handler.
+    Handle a NET-SNMP callback for this session.
+
+    \return `int`: 1 once the callback is handled.
+  */
+  auto handle_pdu(int op,       //!< Response opcode.
+                  snmp_pdu *pdu //!< Response PDU
+                  ) -> int;
+
+  /*!
+    NET-SNMP callback handler.  Errors close the session instead of unwinding
+    through NET-SNMP.
 
     \return `int`: Always returns 1.
   */
@@ -121,7 +436,29 @@ NET-SNMP session
                           ) -> int;
 
 public:
-  Session(SnmpRequest request //!< SNMP request used to build this session.
+  Session(SnmpRequest request, //!< SNMP request used to build this session.
+          Transport *transport = nullptr, //!< Optional shared transport.
+                                          //!< Sessions on a shared transport
+                                          //!< encode and decode messages
+                                          //!< natively.  `nullptr` opens a
+                                          //!< dedicated NET-SNMP socket for
+                                          //!< the session.
+          std::shared_ptr<SegmentPool> pool = nullptr, //!< Pool of result
+                                                       //!< segments.
+                                                       //!< `nullptr`
+                                                       //!< allocates segments
+                                                       //!< on demand.
+          RttEstimator *rtt = nullptr, //!< Round trip time estimator shared
+                                       //!< by the sessions to the same host.
+          TokenBucket *bucket = nullptr, //!< PDU rate limit shared by the
+                                         //!< sessions to the same host.
+          CounterRates *counters = nullptr, //!< Counter samples shared by
+                                            //!< the sessions to the same
+                                            //!< host.
+          std::shared_ptr<ResultSink> sink = nullptr //!< Sink of the results
+                                                     //!< or `nullptr` to
+                                                     //!< return them in the
+                                                     //!< responses.
   );
 
   /*!
@@ -131,22 +468,87 @@ public:
 
   INLINE_CONST_GETTER(Session, status);
   INLINE_CONST_GETTER(Session, request);
+  INLINE_CONST_GETTER(Session, job);
+  INLINE_SETTER(Session, job);
 
   /*!
-    Send the next request PDU.
+    Get the earliest retry or timeout deadline of the outstanding PDUs, or
+    when a rate limited session may send again.
+
+    \return `std::optional<std::chrono::steady_clock::time_point>`: Deadline
+    or `std::nullopt` if no request is outstanding.
+  */
+  [[nodiscard]] auto get_deadline() const
+      -> std::optional<std::chrono::steady_clock::time_point>;
+
+  /*!
+    Get the session socket.
+
+    \return `int`: File descriptor or -1 if the session failed to open.
+  */
+  [[nodiscard]] auto get_fd() const -> int;
+
+  /*!
+    Send the next request PDUs, filling the free pipeline slots.
   */
   void send();
 
   /*!
-    Read the next response PDU.
+    Read the next response PDU.  Only call when the session socket is readable.
   */
-  void read();
+  void read(netsnmp_large_fd_set &fdset //!< Scratch socket set.
+  );
 
   /*!
-    Get the session response.
+    Read a response datagram routed by the shared transport.
+  */
+  void read(uint8_t const *data, //!< Encoded message.
+            size_t size          //!< Size of the encoded message.
+  );
+
+  /*!
+    Retry or time out the outstanding request PDUs past their deadline and
+    resume sending once the rate limit allows.  Only call once the deadline
+    has passed.
+  */
+  void timeout();
+
+  /*!
+    Get the session response.  With a sink, the remaining records are handed
+    off first.
   */
   [[nodiscard]] auto get_response() -> SnmpResponse;
 
+  /*!
+    Check if the collected results have reached a partial response threshold
+    of the request's configuration, or columnar results are nearing their
+    32-bit Arrow offsets, while the session is still collecting.
+
+    \return `bool`
+  */
+  [[nodiscard]] auto has_partial_response() const -> bool;
+
+  /*!
+    Hand off the results, errors and stamps collected so far as a `PARTIAL`
+    response and continue collecting into a new results buffer.  With a sink,
+    the records are handed off to it instead of the response.
+
+    \return `SnmpResponse`
+  */
+  [[nodiscard]] auto take_partial_response() -> SnmpResponse;
+
+  /*!
+    Record a `SESSION_ERROR` and close the session, keeping the results
+    collected so far.  Used for errors the session cannot recover from, such
+    as running out of sockets or shared memory.
+  */
+  void fail(std::string const &message, //!< Error message.
+            std::optional<size_t> sys_errno = std::nullopt, //!< System error
+                                                            //!< code.
+            std::optional<size_t> snmp_errno = std::nullopt //!< SNMP error
+                                                            //!< code.
+  );
+
   /*!
     Append an error.  TODO timestamp
 
@@ -190,41 +592,439 @@ attr_to_string(Session::SessionStatus const &status //!< SNMP session type.
 }
 
 /*!
-  SNMP session.
+  Event loop over a set of async sessions.  A worker owns its reactor, its
+  sessions and, optionally, its shared transport, so each worker can run on its
+  own thread without locking.
+*/
+class Worker {
+private:
+  Reactor reactor;                 //!< Socket readiness loop.
+  netsnmp_large_fd_set read_fdset; //!< Scratch socket set for reads.
+  int wake_fd;                     //!< Event counter used to interrupt `step`.
+  std::unique_ptr<Transport>
+      transport; //!< Shared transport or `nullptr` for a socket per session.
+  std::shared_ptr<SegmentPool> pool; //!< Pool of result segments.
+  std::shared_ptr<ResultSink> sink;  //!< Sink of the results or `nullptr`.
+  std::list<Session> async_sessions; //!< Active sessions.
+  std::unordered_map<std::string, RttEstimator>
+      rtt_estimators; //!< Round trip time estimators by host, kept across
+                      //!< requests.
+  std::unordered_map<Session const *, std::list<Session>::iterator>
+      open_sessions; //!< Sessions that have not closed.
+  std::multiset<size_t>
+      session_limits; //!< `Config::max_async_sessions` of the open sessions.
+  std::vector<Session *>
+      ready_sessions; //!< Idle sessions with requests to send.  May repeat.
+  std::vector<Session *> sending_sessions; //!< Scratch for `ready_sessions`.
+  std::vector<Session *>
+      partial_sessions; //!< Sessions that reached a partial response
+                        //!< threshold.  May repeat.
+  std::vector<std::list<Session>::iterator>
+      closed_sessions; //!< Closed sessions with responses to collect.
+  TimingWheel timers; //!< Retry, timeout and pacing deadline of each open
+                      //!< session.
+  std::vector<void *> expired_timers; //!< Scratch for expired sessions.
+  std::vector<size_t>
+      finished_jobs; //!< Recurring jobs of the sessions collected by `step`.
+
+  /*!
+    Queue a session for the next send, partial response or collection and
+    reschedule its deadline after it has been admitted, sent, read or timed
+    out.
+  */
+  void update(Session &session //!< Session.
+  );
+
+  /*!
+    Run a step of a session, closing the session with a `SESSION_ERROR` if it
+    throws, then `update` it.
+  */
+  template <typename Step>
+  void process(Session &session, //!< Session.
+               Step &&step       //!< Callable performing the step.
+  ) {
+    try {
+      step();
+    } catch (std::exception const &e) {
+      session.fail(e.what());
+    }
+    update(session);
+  }
+
+public:
+  /*!
+    \exception std::runtime_error The epoll instance or the wake event could
+    not be created.
+  */
+  Worker(size_t shared_sockets, //!< Number of UDP sockets per address family
+                                //!< shared by the worker's sessions.  0 opens
+                                //!< a dedicated socket for each session.
+         size_t io_batch_size,  //!< Datagrams per `sendmmsg`/`recvmmsg`.
+         std::shared_ptr<SegmentPool> pool, //!< Pool of result segments.
+         std::shared_ptr<ResultSink> sink   //!< Sink of the results or
+                                            //!< `nullptr`.
+  );
+
+  /*!
+    Close the sessions and release the scratch socket set.
+  */
+  ~Worker();
+
+  Worker(Worker const &) = delete;
+  auto operator=(Worker const &) -> Worker & = delete;
+
+  /*!
+    Get the number of active async sessions.  Kept incrementally.
+
+    \return `size_t`
+  */
+  [[nodiscard]] auto get_active_async_sessions_count() const -> size_t;
+
+  /*!
+    Check if the worker has sessions, open or closed with a response `step`
+    has yet to collect.
+
+    \return `bool`
+  */
+  [[nodiscard]] inline auto has_sessions() const -> bool {
+    return !async_sessions.empty();
+  }
+
+  /*!
+    Get the maximum number of active sessions allowed with the current requests
+    being processed.  Takes the minimum `Config::max_async_sessions` from each
+    request, kept incrementally.
+
+    \return `size_t`
+  */
+  [[nodiscard]] auto get_max_async_sessions() const -> size_t;
+
+  /*!
+    Check if another session can be started for a request without exceeding
+    the maximum number of async sessions of this worker.
+
+    \return `bool`
+  */
+  [[nodiscard]] auto can_admit(SnmpRequest const &request //!< SNMP request.
+                               ) const -> bool;
+
+  /*!
+    Start a session for a request.
+  */
+  void admit(SnmpRequest const &request,  //!< SNMP request.
+             TokenBucket *bucket = nullptr, //!< PDU rate limit of the host or
+                                            //!< `nullptr`.
+             CounterRates *counters = nullptr, //!< Counter samples of the host
+                                               //!< or `nullptr`.
+             std::optional<size_t> job = std::nullopt //!< Recurring job.
+  );
+
+  /*!
+    Run the async sessions until one or more completes or `wake` is called.
+    Completed responses are appended to `responses`.  Without `block`, make a
+    single pass that only handles the sockets that are already readable and
+    the deadlines that have already passed.
+  */
+  void step(std::vector<SnmpResponse> &responses, //!< Completed responses.
+            bool block = true, //!< Wait for a session to complete.
+            std::optional<std::chrono::steady_clock::time_point> until =
+                std::nullopt //!< Stop waiting at this time.
+  );
+
+  /*!
+    Move the recurring jobs of the sessions completed by `step` to `jobs`.
+  */
+  void take_finished_jobs(std::vector<size_t> &jobs //!< Finished jobs.
+  );
+
+  /*!
+    Get the earliest retry or timeout deadline of the sessions, rounded up to
+    the timer resolution.
+
+    \return `std::optional<std::chrono::steady_clock::time_point>`: Deadline
+    or `std::nullopt` if no request is outstanding.
+  */
+  [[nodiscard]] auto get_deadline() const
+      -> std::optional<std::chrono::steady_clock::time_point>;
+
+  /*!
+    Get the epoll file descriptor, readable when a socket of the worker is.
+
+    \return `int`
+  */
+  [[nodiscard]] inline auto get_fd() const -> int { return reactor.get_fd(); }
+
+  /*!
+    Interrupt a running or the next call to `step`.  Safe to call from any
+    thread.
+  */
+  void wake();
+
+  /*!
+    Close every open session with a `SESSION_ERROR`, for errors of the worker
+    itself, such as its reactor or shared transport failing.  The next `step`
+    collects their responses.
+  */
+  void fail(std::string const &message //!< Error message.
+  );
+
+  /*!
+    Get the I/O counters of the shared transport.
+
+    \return `IoStats`: Counters or zeroes when sockets are not shared.
+  */
+  [[nodiscard]] inline auto get_io_stats() const -> IoStats {
+    return transport == nullptr ? IoStats() : transport->get_stats();
+  }
+};
+
+/*!
+  SNMP session manager.  Runs the sessions on the calling thread or, with
+  `threads`, on a pool of worker threads that take requests from a shared
+  queue as they have capacity and report completed responses to a shared
+  completion queue.
 */
 class SessionManager {
+public:
+  /*!
+    What a recurring job does when it comes due while its previous poll is
+    still pending or running.
+  */
+  enum MissedDeadlinePolicy {
+    SKIP = 0, //!< Skip the poll and wait for the next interval.
+    DEFER,    //!< Poll as soon as the previous poll completes.
+    OVERLAP,  //!< Poll anyway, alongside the previous poll.
+  };
+
 private:
-  std::deque<SnmpRequest> pending_requests; //!< Pending requests.
-  std::list<Session> async_sessions;        //!< Active sessions.
+  /*!
+    Request waiting to be admitted to a worker.
+  */
+  struct PendingRequest {
+    SnmpRequest request;       //!< SNMP request.
+    std::optional<size_t> job; //!< Recurring job that added the request.
+  };
+
+  /*!
+    Sessions and limits of a host or subnet.
+  */
+  struct HostState {
+    size_t sessions; //!< Admitted or released sessions.
+    std::deque<PendingRequest>
+        waiting; //!< Requests held back by `max_host_sessions`.
+    std::unique_ptr<TokenBucket> bucket; //!< PDU rate limit or `nullptr`.
+  };
+
+  /*!
+    Recurring poll.
+  */
+  struct Job {
+    SnmpRequest request;                        //!< SNMP request polled.
+    std::chrono::nanoseconds interval;          //!< Time between polls.
+    MissedDeadlinePolicy missed_deadline;       //!< Overrunning poll policy.
+    std::chrono::steady_clock::time_point next; //!< Next due time.
+    size_t running;                             //!< Polls pending or running.
+    bool deferred;                              //!< A poll awaits the last.
+  };
+
   Config config; //!< Default configuration.  Guaranteed to have a
                  //!< value for each configuration item.
+  size_t max_host_sessions;        //!< Concurrent sessions per host key.
+  double max_host_pdus_per_second; //!< New request PDUs per host key.
+  size_t ipv4_prefix_length;       //!< IPv4 subnet prefix of the host keys.
+  size_t ipv6_prefix_length;       //!< IPv6 subnet prefix of the host keys.
+  std::mutex mutex; //!< Guards the queues, counters and worker stats.
+  std::condition_variable
+      pending_cv; //!< Signaled when requests are added or on shutdown.
+  std::condition_variable
+      completed_cv; //!< Signaled when responses complete or a worker idles.
+  std::deque<PendingRequest> pending_requests; //!< Pending requests.
+  std::deque<PendingRequest>
+      ready_requests; //!< Requests released from a host's wait queue with a
+                      //!< session already reserved.  Admitted first.
+  std::unordered_map<std::string, HostState>
+      hosts;               //!< Host states by host key.
+  std::unordered_map<std::string, std::unique_ptr<CounterRates>>
+      counter_rates; //!< Counter samples by host, kept across requests.
+  size_t waiting_requests; //!< Requests in the host wait queues.
+  size_t admitting; //!< Requests taken off a queue by a worker that is
+                    //!< opening their sessions without the lock.
+  std::deque<SnmpResponse> completed; //!< Completed responses.
+  std::unordered_map<size_t, Job> jobs; //!< Recurring jobs by id.
+  std::set<std::pair<std::chrono::steady_clock::time_point, size_t>>
+      job_queue;      //!< Recurring job ids by due time.
+  size_t next_job_id; //!< Id of the next recurring job.
+  std::mt19937_64 random; //!< Source of the recurring job phases.
+  std::shared_ptr<SegmentPool>
+      pool; //!< Pool of result segments shared by the workers.
+  std::vector<std::unique_ptr<Worker>> workers; //!< Session event loops.
+  std::vector<IoStats> worker_io_stats; //!< I/O counters published by each
+                                        //!< worker after each step.
+  std::vector<bool>
+      spare_capacity; //!< Workers blocked in `step` with room for more
+                      //!< sessions, cleared once woken.
+  size_t busy_workers;              //!< Workers with active sessions.
+  bool stopping;                    //!< Worker threads are shutting down.
+  int notify_fd; //!< Event counter signaled when worker threads complete
+                 //!< responses or go idle.
+  std::vector<std::thread> threads; //!< Worker threads.
+
+  /*!
+    Signal `notify_fd`.
+  */
+  void notify();
+
+  /*!
+    Hand newly queued requests to a worker: an idle worker waiting on
+    `pending_cv` or a worker blocked in `step` with spare capacity.  Call with
+    the lock held.
+  */
+  void signal_pending();
 
   /*!
     Get the default configuration.
 
     \code{.cpp}
     Config(
-      3,   // retries
-      3,   // timeout
-      10,  // max_response_var_binds_per_pdu
-      10   // max_async_sessions
+      3,     // retries
+      3,     // timeout
+      10,    // max_response_var_binds_per_pdu
+      10,    // max_async_sessions
+      0,     // partial_result_bytes
+      0,     // partial_result_records
+      false, // adaptive_repetitions
+      1,     // pipeline_depth
+      0,     // auto_partition
+      false, // counter_rates
+      false, // columnar
+      1,     // wireline_version
+      false  // shared_memory
     )
     \endcode
 
     \return `Config`
   */
   [[nodiscard]] inline static auto get_default_config() -> Config const & {
-    static Config const config = Config(3, 3, 10, 10);
+    static Config const config =
+        Config(3, 3, 10, 10, 0, 0, false, 1, 0, false, false, 1, false);
     return config;
   }
 
+  /*!
+    Queue a poll of a recurring job.
+  */
+  void start_job(size_t id, //!< Job id.
+                 Job &job   //!< Job.
+  );
+
+  /*!
+    Queue the polls of the recurring jobs that are due and schedule their
+    next polls.  Polls missed while the manager was not driven are coalesced
+    into one.
+  */
+  void run_jobs(std::chrono::steady_clock::time_point now //!< Now.
+  );
+
+  /*!
+    Record the completed polls of recurring jobs, starting deferred polls.
+  */
+  void finish_jobs(Worker &worker //!< Worker that completed the polls.
+  );
+
+  /*!
+    Get the due time of the next recurring job.
+
+    \return `std::optional<std::chrono::steady_clock::time_point>`: Due time
+    or `std::nullopt` without jobs.
+  */
+  [[nodiscard]] auto get_next_job() const
+      -> std::optional<std::chrono::steady_clock::time_point>;
+
+  /*!
+    Check if there are requests not yet admitted to a worker, including those
+    being admitted.
+
+    \return `bool`
+  */
+  [[nodiscard]] auto has_pending_requests() const -> bool;
+
+  /*!
+    Queue the due recurring jobs, then move pending requests to a worker
+    until it reaches its maximum number of async sessions.  Requests to a host
+    at `max_host_sessions` are moved to the host's wait queue instead so they
+    do not hold back other hosts.
+    Sessions are opened without holding the lock.
+  */
+  void admit_requests(std::unique_lock<std::mutex> &lock, //!< Held lock.
+                      Worker &worker                      //!< Worker.
+  );
+
+  /*!
+    Release the host sessions of completed responses, passing each to the
+    next request waiting on the host.
+  */
+  void release_hosts(
+      std::vector<SnmpResponse> const &responses //!< Completed responses.
+  );
+
+  /*!
+    Worker thread main loop.
+  */
+  void work(size_t index //!< Index of the worker.
+  );
+
+  /*!
+    Stop and join the worker threads and close the notify event.
+  */
+  void stop();
+
 public:
+  /*!
+    \exception std::runtime_error The epoll instance or an event counter could
+    not be created.
+    \exception std::invalid_argument `io_batch_size` is set without
+    `shared_sockets`, `result_segment_bytes` is not greater than 0 or
+    `max_host_pdus_per_second` is negative.
+  */
   SessionManager(
       std::optional<Config> const
-          &config //!< Replacement default configuration.  `std::nullopt` values
-                  //!< will be replaced by the standard default configuration.
-      )
-      : config(get_default_config() << config){};
+          &config, //!< Replacement default configuration.  `std::nullopt`
+                   //!< values will be replaced by the standard default
+                   //!< configuration.
+      size_t shared_sockets = 0, //!< Number of UDP sockets per address family
+                                 //!< shared by the sessions of a worker.  0
+                                 //!< opens a dedicated socket per session.
+      size_t io_batch_size = 0,  //!< Datagrams per `sendmmsg`/`recvmmsg` on
+                                 //!< the shared sockets.  0 disables batching.
+      size_t threads = 0,        //!< Number of worker threads.  0 runs the
+                                 //!< sessions on the thread calling `run`.
+      size_t result_segment_bytes =
+          DEFAULT_RESULT_SEGMENT_BYTES, //!< Size of the pooled segments the
+                                        //!< results are collected into.
+      size_t max_host_sessions = 0, //!< Concurrent sessions per host key.  0
+                                    //!< is unlimited.
+      double max_host_pdus_per_second = 0, //!< New request PDUs per second
+                                           //!< per host key, bursting up to
+                                           //!< one second's worth.  0 is
+                                           //!< unlimited.
+      size_t ipv4_prefix_length = 32, //!< Literal IPv4 hosts share limits
+                                      //!< with the hosts of this subnet.
+      size_t ipv6_prefix_length = 128, //!< Literal IPv6 hosts share limits
+                                       //!< with the hosts of this subnet.
+      std::shared_ptr<ResultSink> sink = nullptr //!< Sink the wireline
+                                                 //!< results are handed off
+                                                 //!< to.  `nullptr` returns
+                                                 //!< them in the responses.
+  );
+
+  /*!
+    Stop and join the worker threads.  The GIL is released while joining, so
+    workers calling into python can finish.
+  */
+  ~SessionManager();
+
+  SessionManager(SessionManager const &) = delete;
+  auto operator=(SessionManager const &) -> SessionManager & = delete;
 
   /*!
     Add a new request.
@@ -233,38 +1033,96 @@ public:
   );
 
   /*!
-    Get the number of pending requests.
+    Add a recurring job that polls a request every `interval` seconds.  The
+    first poll is delayed by a random phase of up to `phase_jitter` times the
+    interval, so jobs added together spread their load over the interval.
 
-    \return `size_t`
+    \exception std::invalid_argument `interval` is not greater than 0 or
+    `phase_jitter` is not within [0, 1].
+
+    \return `size_t`: Job id.
   */
-  [[nodiscard]] inline auto get_pending_requests_count() -> size_t {
-    return pending_requests.size();
-  }
+  [[nodiscard]] auto add_job(
+      SnmpRequest const &request, //!< SNMP request.
+      double interval,            //!< Seconds between polls.
+      double phase_jitter = 1,    //!< Fraction of the interval the first poll
+                                  //!< is randomly delayed by.
+      MissedDeadlinePolicy missed_deadline =
+          SKIP //!< What to do when a poll comes due while the previous poll
+               //!< is still pending or running.
+      ) -> size_t;
 
   /*!
-    Get the number of active async sessions.
+    Remove a recurring job.  Polls already started still complete.
+
+    \return `bool`: `false` if there is no such job.
+  */
+  auto remove_job(size_t id //!< Job id.
+                  ) -> bool;
+
+  /*!
+    Get the number of recurring jobs.
 
     \return `size_t`
   */
-  [[nodiscard]] auto get_active_async_sessions_count() -> size_t;
+  [[nodiscard]] auto get_jobs_count() -> size_t;
 
   /*!
-    Get the maximum number of active sessions allowed with the current requests
-    being processed.  Takes the minimum `Config::max_async_sessions` from each
-    request.
+    Get the number of pending requests, including those waiting on a host
+    limit.
 
     \return `size_t`
   */
-  [[nodiscard]] auto get_max_async_sessions() -> size_t;
+  [[nodiscard]] auto get_pending_requests_count() -> size_t;
+
+  /*!
+    Get the I/O counters of the shared transports summed over the workers.
+
+    \return `IoStats`: Counters or zeroes when sockets are not shared.
+  */
+  [[nodiscard]] auto get_io_stats() -> IoStats;
 
   /*!
-    Run all async sessions until one or more completes.
+    Run all async sessions until one or more completes, starting recurring
+    jobs as they come due.
 
-    \return `std::nullopt`: There are no pending or active sessions to process.
+    \return `std::nullopt`: There are no pending or active sessions or
+    recurring jobs to process.
     \return `std::optional<std::vector<SnmpRequest>>`: Sequence of completed
     requests.
   */
   [[nodiscard]] auto run() -> std::optional<std::vector<SnmpResponse>>;
+
+  /*!
+    Process the async sessions without blocking.  Without threads this makes
+    one pass over the sockets that are readable and the deadlines that have
+    passed; with threads it takes the responses the workers have completed.
+    Call it when `get_fd` is readable or `get_timeout` expires.
+
+    \return `std::nullopt`: There are no pending or active sessions or
+    recurring jobs to process.
+    \return `std::optional<std::vector<SnmpRequest>>`: Sequence of completed
+    requests, possibly empty.
+  */
+  [[nodiscard]] auto step() -> std::optional<std::vector<SnmpResponse>>;
+
+  /*!
+    Get a file descriptor that becomes readable when `step` has work to do:
+    the epoll instance of the session loop without threads or an event
+    counter signaled by the worker threads.
+
+    \return `int`
+  */
+  [[nodiscard]] auto get_fd() const -> int;
+
+  /*!
+    Get the time until `step` must be called to retry or time out a request
+    or to start a recurring job even if `get_fd` is not readable.
+
+    \return `std::optional<double>`: Seconds or `std::nullopt` if there is no
+    deadline.
+  */
+  [[nodiscard]] auto get_timeout() -> std::optional<double>;
 };
 
 } // namespace snmp_stream
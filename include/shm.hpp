@@ -0,0 +1,109 @@
+// snmp_stream/_snmp_stream/shm.hpp
+
+#ifndef SHM_HPP
+#define SHM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// prefix of the names of shared memory result segments
+#define SHARED_SEGMENT_PREFIX "/snmp_stream"
+
+namespace snmp_stream {
+
+/*!
+  POSIX shared memory segment mapped read-write, used to hand results to
+  another process without copying them.  A segment created by this process
+  is unlinked when destroyed unless it was handed off.  A handed off segment
+  is unlinked as soon as the receiving process maps it, so it can be opened
+  once and the memory is freed when the last mapping goes away.
+*/
+class SharedSegment {
+private:
+  std::string name; //!< Shared memory object name.
+  uint8_t *data;    //!< Mapping.
+  size_t size;      //!< Size of the mapping.
+  bool created;     //!< Created by this process.
+  bool linked;      //!< Name still has to be unlinked by this object.
+
+public:
+  /*!
+    Create and map a new segment under a unique name.  The pages are
+    allocated up front, so running out of shared memory is an error here
+    rather than a `SIGBUS` on a later write.
+
+    \exception std::invalid_argument `size` is not greater than 0.
+    \exception std::runtime_error The segment could not be created, allocated
+    or mapped.
+  */
+  explicit SharedSegment(size_t size //!< Size in bytes.
+  );
+
+  /*!
+    Map a segment handed off by another process and unlink its name.
+
+    \exception std::invalid_argument `name` is not a result segment name.
+    \exception std::runtime_error The segment does not exist, was already
+    opened or is smaller than `size`.
+  */
+  SharedSegment(std::string name, //!< Shared memory object name.
+                size_t size       //!< Bytes to map.
+  );
+
+  /*!
+    Unmap the segment and unlink the name unless it was handed off.
+  */
+  ~SharedSegment();
+
+  SharedSegment(SharedSegment const &) = delete;
+  auto operator=(SharedSegment const &) -> SharedSegment & = delete;
+
+  /*!
+    Keep the name after this object is destroyed, so another process can
+    open it.
+  */
+  inline void hand_off() { linked = false; }
+
+  /*!
+    Get the shared memory object name.
+
+    \return `std::string const &`
+  */
+  [[nodiscard]] inline auto get_name() const -> std::string const & {
+    return name;
+  }
+
+  /*!
+    Get the mapping.
+
+    \return `uint8_t *`
+  */
+  [[nodiscard]] inline auto get_data() const -> uint8_t * { return data; }
+
+  /*!
+    Get the size of the mapping.
+
+    \return `size_t`
+  */
+  [[nodiscard]] inline auto get_size() const -> size_t { return size; }
+
+  /*!
+    Check if the segment was created by this process.
+
+    \return `bool`
+  */
+  [[nodiscard]] inline auto is_created() const -> bool { return created; }
+
+  /*!
+    Check if the name is still unlinked by this object, i.e. the segment was
+    not handed off.
+
+    \return `bool`
+  */
+  [[nodiscard]] inline auto is_linked() const -> bool { return linked; }
+};
+
+} // namespace snmp_stream
+
+#endif
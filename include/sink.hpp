@@ -0,0 +1,168 @@
+// snmp_stream/_snmp_stream/sink.hpp
+
+#ifndef SINK_HPP
+#define SINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "buffer.hpp"
+
+// default bytes an `FdResultSink` stages before writing them out
+#define DEFAULT_SINK_BATCH_BYTES (4 * 1024 * 1024)
+
+namespace snmp_stream {
+
+/*!
+  Destination of wireline results.  Sessions hand off each results buffer,
+  a header followed by whole records, when it would otherwise be returned in
+  a `PARTIAL` or final response; the response then only keeps the header.
+  Buffers of different sessions are handed off concurrently from the worker
+  threads, but each one is written as a unit, so streams never interleave.
+*/
+class ResultSink {
+public:
+  virtual ~ResultSink() = default;
+
+  /*!
+    Take a results buffer.  Thread-safe.
+
+    \exception std::runtime_error The results could not be written.  The
+    session keeps them in its response instead.
+  */
+  virtual void write(std::shared_ptr<ResultBuffer> const &results //!< Results.
+                     ) = 0;
+};
+
+/*!
+  Sink keeping the results buffers in memory until they are taken.
+*/
+class MemoryResultSink : public ResultSink {
+private:
+  std::mutex mutex; //!< Guards `buffers`.
+  std::vector<std::shared_ptr<ResultBuffer>>
+      buffers; //!< Results buffers in hand-off order.
+
+public:
+  void write(std::shared_ptr<ResultBuffer> const &results) override;
+
+  /*!
+    Take the results buffers handed off so far.
+
+    \return `std::vector<std::shared_ptr<ResultBuffer>>`
+  */
+  [[nodiscard]] auto take() -> std::vector<std::shared_ptr<ResultBuffer>>;
+};
+
+/*!
+  Sink writing the results buffers to a file descriptor, such as a file or a
+  pipe.  Each buffer is framed by its size as an unsigned 64-bit
+  little-endian integer.  Buffers are staged without copying until
+  `batch_bytes` is reached and then written with as few `writev` calls as
+  possible, so the segments go straight from the pool to the kernel.  The
+  file descriptor is not closed.
+
+  A failed write loses nothing that was accepted: the unwritten rest of the
+  staged buffers, including a partly written frame, stays staged and is
+  written first by the next `write` or `flush`.  A buffer is only rejected
+  if none of it was written, so frames are never torn or duplicated.
+*/
+class FdResultSink : public ResultSink {
+private:
+  /*!
+    Buffer waiting to be written.
+  */
+  struct Staged {
+    std::shared_ptr<ResultBuffer> results; //!< Results.
+    uint64_t frame;                        //!< Little-endian results size.
+    size_t written;                        //!< Bytes already written.
+  };
+
+  int fd;             //!< Output file descriptor.
+  size_t batch_bytes; //!< Staged bytes that trigger a write.
+  std::mutex mutex;   //!< Guards the staged buffers and serializes writes.
+  std::deque<Staged> staged; //!< Buffers in write order.
+  size_t staged_bytes;       //!< Bytes of the staged buffers left to write.
+
+  /*!
+    Write the staged buffers.  The caller holds `mutex`.
+
+    \exception std::runtime_error `writev` failed.  What was not written
+    stays staged.
+  */
+  void write_staged();
+
+  /*!
+    Account for bytes written from the front of the staged buffers and
+    release the buffers written completely.  The caller holds `mutex`.
+  */
+  void consume(size_t bytes //!< Bytes written.
+  );
+
+public:
+  /*!
+    \exception std::invalid_argument `fd` is negative.
+  */
+  explicit FdResultSink(int fd, //!< Output file descriptor.
+                        size_t batch_bytes =
+                            DEFAULT_SINK_BATCH_BYTES //!< Staged bytes that
+                                                     //!< trigger a write.  0
+                                                     //!< writes every buffer
+                                                     //!< as it arrives.
+  );
+
+  /*!
+    Write the staged buffers.  Errors are discarded along with the buffers
+    that could not be written; call `flush` first to see them.
+  */
+  ~FdResultSink() override;
+
+  FdResultSink(FdResultSink const &) = delete;
+  auto operator=(FdResultSink const &) -> FdResultSink & = delete;
+
+  /*!
+    Stage a results buffer and write the staged buffers once `batch_bytes`
+    is reached.
+
+    \exception std::runtime_error `writev` failed before any of `results`
+    was written; `results` is not staged.  If part of it was written, the
+    rest stays staged and no error is raised.
+  */
+  void write(std::shared_ptr<ResultBuffer> const &results) override;
+
+  /*!
+    Write the staged buffers.
+
+    \exception std::runtime_error `writev` failed.  What was not written
+    stays staged.
+  */
+  void flush();
+};
+
+/*!
+  Sink calling a function with each results buffer.  Calls are serialized.
+*/
+class CallbackResultSink : public ResultSink {
+public:
+  using Callback = std::function<void(std::shared_ptr<ResultBuffer> const &)>;
+
+private:
+  Callback callback; //!< Function called with each buffer.
+  std::mutex mutex;  //!< Serializes the calls.
+
+public:
+  explicit CallbackResultSink(Callback callback //!< Function called with
+                                                //!< each buffer.
+  );
+
+  void write(std::shared_ptr<ResultBuffer> const &results) override;
+};
+
+} // namespace snmp_stream
+
+#endif
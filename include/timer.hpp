@@ -0,0 +1,125 @@
+// snmp_stream/_snmp_stream/timer.hpp
+
+#ifndef TIMER_HPP
+#define TIMER_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// timer resolution in microseconds
+#define TIMER_TICK_US 1000
+// log2 of the number of slots per wheel level
+#define TIMER_WHEEL_BITS 6
+// number of wheel levels; 64^4 ticks of 1 ms span over 4.6 hours
+#define TIMER_WHEEL_LEVELS 4
+
+namespace snmp_stream {
+
+/*!
+  Hierarchical timing wheel holding one deadline per key.  Level 0 has a slot
+  per tick and each higher level a slot per full rotation of the level below;
+  timers cascade down a level as their slot comes due.  Scheduling, moving
+  and cancelling a timer are O(1), and finding the next deadline and
+  expiring timers only look at occupied slots, so neither depends on the
+  number of timers.  Deadlines are rounded up to the tick, so timers never
+  expire early.  Timers further out than the top level spans are parked in
+  its last slot and re-cascaded.
+*/
+class TimingWheel {
+private:
+  static constexpr size_t SLOTS = 1 << TIMER_WHEEL_BITS;
+
+  /*!
+    Scheduled timer.
+  */
+  struct Timer {
+    uint64_t tick; //!< Tick the timer expires at.
+    size_t level;  //!< Wheel level of the slot holding the timer.
+    size_t slot;   //!< Slot holding the timer.
+    std::list<void *>::iterator position; //!< Position in the slot.
+  };
+
+  std::chrono::steady_clock::time_point origin; //!< Time of tick 0.
+  uint64_t now; //!< Last tick expired.
+  std::array<std::array<std::list<void *>, SLOTS>, TIMER_WHEEL_LEVELS>
+      slots; //!< Keys by level and slot.
+  std::array<uint64_t, TIMER_WHEEL_LEVELS>
+      occupied; //!< Bitmap of the non-empty slots per level.
+  std::list<void *> due; //!< Keys scheduled at or before `now`.
+  std::unordered_map<void *, Timer> timers; //!< Timers by key.
+
+  /*!
+    Get the slot list of a timer.
+
+    \return `std::list<void *> &`
+  */
+  [[nodiscard]] auto get_list(Timer const &timer //!< Timer.
+                              ) -> std::list<void *> &;
+
+  /*!
+    Move a timer's key to the slot of its tick, or to `due` once the tick has
+    passed.
+  */
+  void place(Timer &timer //!< Timer.
+  );
+
+  /*!
+    Get the next tick after `now` at which a timer expires or cascades.
+
+    \return `std::optional<uint64_t>`: Tick or `std::nullopt` without timers
+    on the wheel.
+  */
+  [[nodiscard]] auto get_next_tick() const -> std::optional<uint64_t>;
+
+public:
+  TimingWheel();
+
+  TimingWheel(TimingWheel const &) = delete;
+  auto operator=(TimingWheel const &) -> TimingWheel & = delete;
+
+  /*!
+    Schedule or move the timer of a key.
+  */
+  void schedule(void *key, //!< Key.
+                std::chrono::steady_clock::time_point deadline //!< Deadline.
+  );
+
+  /*!
+    Cancel the timer of a key, if any.
+  */
+  void cancel(void *key //!< Key.
+  );
+
+  /*!
+    Get the time of the next expiry or cascade.  Waking at a cascade finds
+    no expired timers but keeps the wheel's cost independent of how far out
+    the timers are.
+
+    \return `std::optional<std::chrono::steady_clock::time_point>`: Deadline
+    or `std::nullopt` without timers.
+  */
+  [[nodiscard]] auto get_deadline() const
+      -> std::optional<std::chrono::steady_clock::time_point>;
+
+  /*!
+    Advance the wheel to `time` and remove the expired timers, appending
+    their keys to `expired`.
+  */
+  void expire(std::chrono::steady_clock::time_point time, //!< Now.
+              std::vector<void *> &expired //!< Keys of expired timers.
+  );
+
+  [[nodiscard]] inline auto get_size() const -> size_t {
+    return timers.size();
+  }
+};
+
+} // namespace snmp_stream
+
+#endif
@@ -0,0 +1,288 @@
+// snmp_stream/_snmp_stream/transport.hpp
+
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "reactor.hpp"
+#include "types.hpp"
+
+namespace snmp_stream {
+
+class Session;
+
+/*!
+  Datagram I/O counters of a shared transport.  Dividing the datagram counts
+  by the call counts gives the average number of datagrams moved per syscall.
+*/
+class IoStats {
+private:
+  size_t send_calls;         //!< Number of send syscalls.
+  size_t sent_datagrams;     //!< Number of datagrams sent.
+  size_t max_send_batch;     //!< Largest number of datagrams in one send.
+  size_t recv_calls;         //!< Number of receive syscalls returning data.
+  size_t received_datagrams; //!< Number of datagrams received.
+  size_t max_recv_batch;     //!< Largest number of datagrams in one receive.
+
+public:
+  IoStats(size_t send_calls = 0,         //!< Number of send syscalls.
+          size_t sent_datagrams = 0,     //!< Number of datagrams sent.
+          size_t max_send_batch = 0,     //!< Largest send batch.
+          size_t recv_calls = 0,         //!< Number of receive syscalls.
+          size_t received_datagrams = 0, //!< Number of datagrams received.
+          size_t max_recv_batch = 0      //!< Largest receive batch.
+          )
+      : send_calls(send_calls), sent_datagrams(sent_datagrams),
+        max_send_batch(max_send_batch), recv_calls(recv_calls),
+        received_datagrams(received_datagrams),
+        max_recv_batch(max_recv_batch) {}
+
+  /*!
+    Record one send syscall.
+  */
+  inline void record_send(size_t datagrams //!< Datagrams sent by the call.
+  ) {
+    send_calls++;
+    sent_datagrams += datagrams;
+    max_send_batch = std::max(max_send_batch, datagrams);
+  }
+
+  /*!
+    Record one receive syscall.
+  */
+  inline void record_recv(size_t datagrams //!< Datagrams read by the call.
+  ) {
+    recv_calls++;
+    received_datagrams += datagrams;
+    max_recv_batch = std::max(max_recv_batch, datagrams);
+  }
+
+  INLINE_CONST_GETTER(IoStats, send_calls);
+  INLINE_CONST_GETTER(IoStats, sent_datagrams);
+  INLINE_CONST_GETTER(IoStats, max_send_batch);
+  INLINE_CONST_GETTER(IoStats, recv_calls);
+  INLINE_CONST_GETTER(IoStats, received_datagrams);
+  INLINE_CONST_GETTER(IoStats, max_recv_batch);
+  REPR(IoStats);
+};
+
+/*!
+  Compare two `IoStats`.
+
+  \return `bool`
+*/
+[[nodiscard]] inline auto
+operator==(IoStats const &lhs, //!< Left-hand side object to compare.
+           IoStats const &rhs  //!< Right-hand side object to compare.
+           ) -> bool {
+  return (lhs.get_send_calls() == rhs.get_send_calls()) &&
+         (lhs.get_sent_datagrams() == rhs.get_sent_datagrams()) &&
+         (lhs.get_max_send_batch() == rhs.get_max_send_batch()) &&
+         (lhs.get_recv_calls() == rhs.get_recv_calls()) &&
+         (lhs.get_received_datagrams() == rhs.get_received_datagrams()) &&
+         (lhs.get_max_recv_batch() == rhs.get_max_recv_batch());
+}
+
+/*!
+  Combine the counters of two `IoStats`.
+
+  \return `IoStats`
+*/
+[[nodiscard]] inline auto
+operator+(IoStats const &lhs, //!< Left-hand side counters.
+          IoStats const &rhs  //!< Right-hand side counters.
+          ) -> IoStats {
+  return IoStats(
+      lhs.get_send_calls() + rhs.get_send_calls(),
+      lhs.get_sent_datagrams() + rhs.get_sent_datagrams(),
+      std::max(lhs.get_max_send_batch(), rhs.get_max_send_batch()),
+      lhs.get_recv_calls() + rhs.get_recv_calls(),
+      lhs.get_received_datagrams() + rhs.get_received_datagrams(),
+      std::max(lhs.get_max_recv_batch(), rhs.get_max_recv_batch()));
+}
+
+/*!
+  Resolve an SNMP peer name (`host`, `host:port`, `[v6]:port`, optionally
+  prefixed with `udp:` or `udp6:`) to a socket address.  The port defaults to
+  161.
+
+  \return `std::optional<std::pair<sockaddr_storage, socklen_t>>`: Address or
+  `std::nullopt` if the name could not be resolved.
+*/
+[[nodiscard]] auto resolve_peer(std::string const &peername //!< Peer name.
+                                )
+    -> std::optional<std::pair<sockaddr_storage, socklen_t>>;
+
+/*!
+  Shared UDP transport.  A small pool of UDP sockets per address family is
+  shared by every session of a worker instead of one socket per session.
+  Sessions send encoded messages through the pool, and responses are routed
+  back to the owning session by request-id and source address.
+
+  With a batch size, outgoing datagrams are queued and sent with one
+  `sendmmsg` per socket on `flush`, and incoming datagrams are drained with
+  `recvmmsg` into a reusable receive ring.  The sockets are then
+  non-blocking: datagrams a full socket buffer does not take stay queued,
+  and the socket is watched for writability until they are sent.
+*/
+class Transport {
+public:
+  /*!
+    Per-session endpoint on the shared sockets.
+  */
+  struct Peer {
+    Session *session;                   //!< Owning session.
+    int fd;                             //!< Shared socket used by this peer.
+    sockaddr_storage address;           //!< Remote address.
+    socklen_t address_length;           //!< Remote address length.
+    std::unordered_set<int64_t> reqids; //!< Outstanding request-ids.
+  };
+
+private:
+  /*!
+    Datagram queued for the next batched send.
+  */
+  struct Outgoing {
+    int fd;                        //!< Shared socket to send on.
+    sockaddr_storage address;      //!< Remote address.
+    socklen_t address_length;      //!< Remote address length.
+    std::vector<uint8_t> datagram; //!< Encoded message.
+    bool sent;                     //!< Sent or dropped by the last flush.
+  };
+
+  Reactor &reactor;                         //!< Reactor to register sockets.
+  size_t sockets_per_family;                //!< Pool size per address family.
+  size_t batch_size; //!< Datagrams per batched syscall; 0 disables batching.
+  std::map<int, std::vector<int>> sockets;  //!< Socket pool by family.
+  std::map<int, size_t> next_socket;        //!< Round-robin cursor by family.
+  std::unordered_map<int64_t, Peer *> routes; //!< Request-id routing table.
+  std::vector<uint8_t> buffer; //!< Receive ring, one slot per datagram.
+  std::vector<sockaddr_storage> sources; //!< Source address per ring slot.
+  std::vector<iovec> iovecs;             //!< Scatter/gather scratch.
+  std::vector<mmsghdr> headers;          //!< Batched syscall scratch.
+  std::vector<Outgoing> send_queue;      //!< Reusable send queue slots.
+  size_t queued;                         //!< Number of queued datagrams.
+  std::unordered_set<int>
+      blocked; //!< Sockets with queued datagrams waiting for writability.
+  IoStats stats;                         //!< I/O counters.
+
+  /*!
+    Queue a datagram for the next batched send, flushing a full queue.
+  */
+  void enqueue(Peer const &peer,     //!< Destination peer.
+               uint8_t const *data,  //!< Encoded message.
+               size_t size           //!< Size of the encoded message.
+  );
+
+  /*!
+    Read the next datagrams from a socket into the receive ring.
+
+    \return `size_t`: Number of datagrams read.
+  */
+  [[nodiscard]] auto read_socket(int fd //!< Shared socket.
+                                 ) -> size_t;
+
+  /*!
+    Route one received datagram to its session.
+  */
+  void route(uint8_t const *data,            //!< Received datagram.
+             size_t size,                    //!< Size of the datagram.
+             sockaddr_storage const &source, //!< Source address.
+             std::function<void(Session &, uint8_t const *, size_t)> const
+                 &deliver //!< Delivery.
+  );
+
+  /*!
+    Get the next socket of the pool for an address family, opening sockets
+    as needed.
+
+    \exception std::runtime_error The socket could not be opened.
+    \return `int`
+  */
+  [[nodiscard]] auto get_socket(int family //!< Address family.
+                                ) -> int;
+
+public:
+  /*!
+    \exception std::invalid_argument `sockets` is not greater than 0.
+  */
+  Transport(Reactor &reactor,     //!< Reactor to register shared sockets with.
+            size_t sockets,       //!< Number of sockets per address family.
+            size_t batch_size = 0 //!< Datagrams per `sendmmsg`/`recvmmsg`.
+                                  //!< 0 sends and receives one at a time.
+  );
+
+  /*!
+    Close the shared sockets.
+  */
+  ~Transport();
+
+  Transport(Transport const &) = delete;
+  auto operator=(Transport const &) -> Transport & = delete;
+
+  /*!
+    Create an endpoint for a session over the shared sockets.  Release it with
+    `close`.
+
+    \exception std::runtime_error A shared socket could not be opened.
+    \return `Peer *`: Endpoint or `nullptr` if the peer name could not be
+    resolved.
+  */
+  [[nodiscard]] auto open(Session *session,           //!< Owning session.
+                          std::string const &peername //!< Peer name.
+                          ) -> Peer *;
+
+  /*!
+    Remove the routes of an endpoint and release it.
+  */
+  void close(Peer *peer //!< Endpoint returned by `open`.
+  );
+
+  /*!
+    Send an encoded message and route responses with its request-id to the
+    endpoint's session.  Resending a request-id is allowed.
+
+    \return `bool`: `false` if the message could not be sent; `errno` is set.
+  */
+  [[nodiscard]] auto send(Peer &peer,          //!< Destination endpoint.
+                          uint8_t const *data, //!< Encoded message.
+                          size_t size,         //!< Size of the message.
+                          int64_t reqid        //!< Request-id of the message.
+                          ) -> bool;
+
+  /*!
+    Drain every shared socket and deliver each routed datagram to its
+    session.  Datagrams with an unknown request-id or an unexpected source
+    address are discarded.
+  */
+  void receive(std::function<void(Session &, uint8_t const *, size_t)> const
+                   &deliver //!< Called with the session and the datagram.
+  );
+
+  /*!
+    Send every queued datagram.  Does nothing unless batching is enabled.
+    Interrupted sends are retried.  When a socket buffer is full (`EAGAIN`,
+    `ENOBUFS`), the rest of that socket's datagrams stay queued and the
+    socket is watched for writability; call `flush` again once it is ready.
+    A datagram failing with any other error is dropped and recovered by the
+    session's retry and timeout path.
+  */
+  void flush();
+
+  INLINE_CONST_GETTER(Transport, stats);
+};
+
+} // namespace snmp_stream
+
+#endif
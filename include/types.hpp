@@ -5,6 +5,9 @@
 
 #include <memory>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
 extern "C" {
@@ -12,6 +15,9 @@ extern "C" {
 #include <net-snmp/net-snmp-includes.h>
 }
 
+#include "buffer.hpp"
+#include "columns.hpp"
+
 #define INLINE_CONST_GETTER(T, field)                                          \
   /*! Auto-generated getter. */                                                \
   [[nodiscard]] inline auto get_##field() const->decltype(T::field) const & {  \
@@ -415,13 +421,43 @@ private:
       max_response_var_binds_per_pdu;       //!< Maximum number of variable
                                             //!< bindings per PDU.
   std::optional<size_t> max_async_sessions; //!< Number of concurrent sessions.
+  std::optional<size_t>
+      partial_result_bytes; //!< Hand off a partial response once the results
+                            //!< reach this many bytes.  0 disables.
+  std::optional<size_t>
+      partial_result_records; //!< Hand off a partial response once the
+                              //!< results reach this many records.  0
+                              //!< disables.
+  std::optional<bool>
+      adaptive_repetitions; //!< Adapt the variable bindings per GETBULK
+                            //!< response to each device.
+  std::optional<size_t>
+      pipeline_depth; //!< Maximum number of outstanding request PDUs per
+                      //!< session.
+  std::optional<size_t>
+      auto_partition; //!< Maximum number of partitions a walk of each root
+                      //!< OID is split into.  0 disables.
+  std::optional<bool>
+      counter_rates; //!< Emit counter deltas and rates against the previous
+                     //!< poll instead of raw counter values.
+  std::optional<bool>
+      columnar; //!< Collect the results into Arrow-layout columns per root
+                //!< OID instead of wireline records.
+  std::optional<size_t>
+      wireline_version; //!< Wireline format of the results: 1 for word
+                        //!< aligned records, 2 for compact varint records,
+                        //!< 3 for varint records with delta encoded indexes.
+  std::optional<bool>
+      shared_memory; //!< Collect the results into POSIX shared memory that
+                     //!< is handed off when the response is pickled.
 
 public:
   /*!
     \exception std::invalid_argument `retries` is not greater than or equal to
     0. \exception std::invalid_argument `timeout` is not greater than or equal
     to 0. \exception std::invalid_argument `max_async_sessions` is not greater
-    than 0.
+    than 0. \exception std::invalid_argument `pipeline_depth` is not greater
+    than 0. \exception std::invalid_argument `wireline_version` is not 1, 2 or 3.
   */
   Config(std::optional<ssize_t> const retries, //!< Number of retries.
          std::optional<ssize_t> const timeout, //!< Timeout in seconds.
@@ -429,11 +465,35 @@ public:
              max_response_var_binds_per_pdu, //!< Maximum number of variable
                                              //!< bindings per PDU.
          std::optional<size_t> const
-             max_async_sessions //!< Number of concurrent sessions.
+             max_async_sessions, //!< Number of concurrent sessions.
+         std::optional<size_t> const
+             partial_result_bytes, //!< Partial response byte threshold.
+         std::optional<size_t> const
+             partial_result_records, //!< Partial response record threshold.
+         std::optional<bool> const
+             adaptive_repetitions, //!< Adapt GETBULK repetitions.
+         std::optional<size_t> const
+             pipeline_depth, //!< Outstanding request PDUs per session.
+         std::optional<size_t> const
+             auto_partition, //!< Partitions per walked root OID.
+         std::optional<bool> const
+             counter_rates, //!< Emit counter deltas and rates.
+         std::optional<bool> const
+             columnar, //!< Collect the results into columns.
+         std::optional<size_t> const
+             wireline_version, //!< Wireline format of the results.
+         std::optional<bool> const
+             shared_memory //!< Collect the results into shared memory.
          )
       : retries(retries), timeout(timeout),
         max_response_var_binds_per_pdu(max_response_var_binds_per_pdu),
-        max_async_sessions(max_async_sessions) {
+        max_async_sessions(max_async_sessions),
+        partial_result_bytes(partial_result_bytes),
+        partial_result_records(partial_result_records),
+        adaptive_repetitions(adaptive_repetitions),
+        pipeline_depth(pipeline_depth), auto_partition(auto_partition),
+        counter_rates(counter_rates), columnar(columnar),
+        wireline_version(wireline_version), shared_memory(shared_memory) {
     if (this->retries.has_value() && *this->retries < 0) {
       throw std::invalid_argument("retries must be greater than or equal to 0");
     }
@@ -448,12 +508,28 @@ public:
     if (this->max_async_sessions.has_value() && *this->max_async_sessions < 1) {
       throw std::invalid_argument("max_async_sessions must be greater than 0");
     }
+    if (this->pipeline_depth.has_value() && *this->pipeline_depth < 1) {
+      throw std::invalid_argument("pipeline_depth must be greater than 0");
+    }
+    if (this->wireline_version.has_value() &&
+        (*this->wireline_version < 1 || *this->wireline_version > 3)) {
+      throw std::invalid_argument("wireline_version must be 1, 2 or 3");
+    }
   }
 
   INLINE_CONST_GETTER(Config, retries);
   INLINE_CONST_GETTER(Config, timeout);
   INLINE_CONST_GETTER(Config, max_response_var_binds_per_pdu);
   INLINE_CONST_GETTER(Config, max_async_sessions);
+  INLINE_CONST_GETTER(Config, partial_result_bytes);
+  INLINE_CONST_GETTER(Config, partial_result_records);
+  INLINE_CONST_GETTER(Config, adaptive_repetitions);
+  INLINE_CONST_GETTER(Config, pipeline_depth);
+  INLINE_CONST_GETTER(Config, auto_partition);
+  INLINE_CONST_GETTER(Config, counter_rates);
+  INLINE_CONST_GETTER(Config, columnar);
+  INLINE_CONST_GETTER(Config, wireline_version);
+  INLINE_CONST_GETTER(Config, shared_memory);
   REPR(Config);
 };
 
@@ -470,7 +546,17 @@ operator==(Config const &lhs, //!< Left-hand side object to compare.
          (lhs.get_timeout() == rhs.get_timeout()) &&
          (lhs.get_max_response_var_binds_per_pdu() ==
           rhs.get_max_response_var_binds_per_pdu()) &&
-         (lhs.get_max_async_sessions() == rhs.get_max_async_sessions());
+         (lhs.get_max_async_sessions() == rhs.get_max_async_sessions()) &&
+         (lhs.get_partial_result_bytes() == rhs.get_partial_result_bytes()) &&
+         (lhs.get_partial_result_records() ==
+          rhs.get_partial_result_records()) &&
+         (lhs.get_adaptive_repetitions() == rhs.get_adaptive_repetitions()) &&
+         (lhs.get_pipeline_depth() == rhs.get_pipeline_depth()) &&
+         (lhs.get_auto_partition() == rhs.get_auto_partition()) &&
+         (lhs.get_counter_rates() == rhs.get_counter_rates()) &&
+         (lhs.get_columnar() == rhs.get_columnar()) &&
+         (lhs.get_wireline_version() == rhs.get_wireline_version()) &&
+         (lhs.get_shared_memory() == rhs.get_shared_memory());
 }
 
 /*!
@@ -490,7 +576,28 @@ operator<<(Config const &lhs, //!< Left-hand side `Config` to merge.
           ? rhs.get_max_response_var_binds_per_pdu()
           : lhs.get_max_response_var_binds_per_pdu(),
       rhs.get_max_async_sessions().has_value() ? rhs.get_max_async_sessions()
-                                               : lhs.get_max_async_sessions()};
+                                               : lhs.get_max_async_sessions(),
+      rhs.get_partial_result_bytes().has_value()
+          ? rhs.get_partial_result_bytes()
+          : lhs.get_partial_result_bytes(),
+      rhs.get_partial_result_records().has_value()
+          ? rhs.get_partial_result_records()
+          : lhs.get_partial_result_records(),
+      rhs.get_adaptive_repetitions().has_value()
+          ? rhs.get_adaptive_repetitions()
+          : lhs.get_adaptive_repetitions(),
+      rhs.get_pipeline_depth().has_value() ? rhs.get_pipeline_depth()
+                                           : lhs.get_pipeline_depth(),
+      rhs.get_auto_partition().has_value() ? rhs.get_auto_partition()
+                                           : lhs.get_auto_partition(),
+      rhs.get_counter_rates().has_value() ? rhs.get_counter_rates()
+                                          : lhs.get_counter_rates(),
+      rhs.get_columnar().has_value() ? rhs.get_columnar()
+                                     : lhs.get_columnar(),
+      rhs.get_wireline_version().has_value() ? rhs.get_wireline_version()
+                                             : lhs.get_wireline_version(),
+      rhs.get_shared_memory().has_value() ? rhs.get_shared_memory()
+                                          : lhs.get_shared_memory()};
 }
 
 /*!
@@ -669,10 +776,12 @@ public:
     ASYNC_PROBE_ERROR,          //!< Async Probe error.
     TRANSPORT_DISCONNECT_ERROR, //!< Transport disconnect error.
     CREATE_RESPONSE_PDU_ERROR,  //!< Allocation error creating response PDU.
-    VALUE_WARNING //!< Response variable binding contains an END_OF_MIB_VIEW,
+    VALUE_WARNING, //!< Response variable binding contains an END_OF_MIB_VIEW,
                   //!< NO_SUCH_INSTANCE, or NO_SUCH_OBJECT value.  The values
                   //!< are discarded from the results and only recorded as an
                   //!< error.
+    SINK_ERROR //!< Results could not be handed off to the result sink.  They
+               //!< stay in the response instead.
   };
 
 private:
@@ -766,10 +875,52 @@ attr_to_string(SnmpError::SnmpErrorType const &type //!< SNMP error type.
   case SnmpError::VALUE_WARNING:
     string = "VALUE_WARNING";
     break;
+  case SnmpError::SINK_ERROR:
+    string = "SINK_ERROR";
+    break;
   }
   return string;
 }
 
+/*!
+  Receive stamp of a response PDU.  Every record collected from the PDU
+  references it by index, so the clocks are read once per PDU rather than once
+  per variable binding.
+*/
+class PduStamp {
+private:
+  int64_t realtime_ns;  //!< Wall clock receive time in ns since the epoch.
+  int64_t monotonic_ns; //!< Monotonic receive time in ns.
+  int64_t rtt_ns;       //!< Time from the last (re)transmission of the request
+                        //!< to the response in ns.
+
+public:
+  PduStamp(int64_t realtime_ns,  //!< Wall clock receive time.
+           int64_t monotonic_ns, //!< Monotonic receive time.
+           int64_t rtt_ns        //!< Round trip time.
+           )
+      : realtime_ns(realtime_ns), monotonic_ns(monotonic_ns), rtt_ns(rtt_ns) {}
+
+  INLINE_CONST_GETTER(PduStamp, realtime_ns);
+  INLINE_CONST_GETTER(PduStamp, monotonic_ns);
+  INLINE_CONST_GETTER(PduStamp, rtt_ns);
+  REPR(PduStamp);
+};
+
+/*!
+  Compare two `PduStamp`.
+
+  \return `bool`
+*/
+[[nodiscard]] inline auto
+operator==(PduStamp const &lhs, //!< Left-hand side object to compare
+           PduStamp const &rhs  //!< Right-hand side object to compare
+           ) -> bool {
+  return (lhs.get_realtime_ns() == rhs.get_realtime_ns()) &&
+         (lhs.get_monotonic_ns() == rhs.get_monotonic_ns()) &&
+         (lhs.get_rtt_ns() == rhs.get_rtt_ns());
+}
+
 /*!
   SNMP response.
 */
@@ -782,13 +933,17 @@ public:
     SUCCESSFUL = 0,   //!< Request was successful.
     DONE_WITH_ERRORS, //!< Request was successful with errors.
     FAILED,           //!< Request failed.
+    PARTIAL, //!< Intermediate chunk of a request that is still collecting.
   };
 
 private:
-  SnmpResponseType type;                         //!< SNMP response type.
-  SnmpRequest request;                           //!< SNMP request.
-  std::shared_ptr<std::vector<uint8_t>> results; //!< SNMP results.
-  std::vector<SnmpError> errors;                 //!< Collected errors.
+  SnmpResponseType type;                 //!< SNMP response type.
+  SnmpRequest request;                   //!< SNMP request.
+  std::shared_ptr<ResultBuffer> results; //!< SNMP results.
+  std::vector<SnmpError> errors;         //!< Collected errors.
+  std::vector<PduStamp> stamps; //!< Receive stamps referenced by the results.
+  std::shared_ptr<ColumnarResults>
+      columns; //!< Columnar results or `nullptr` for wireline results.
 
 public:
   /*!
@@ -797,28 +952,40 @@ public:
   SnmpResponse(SnmpResponseType type,               //!< SNMP response type.
                SnmpRequest request,                 //!< SNMP request.
                std::vector<uint8_t> const &results, //!< Raw SNMP results.
-               std::vector<SnmpError> const &errors //!< Collected errors.
+               std::vector<SnmpError> const &errors, //!< Collected errors.
+               std::vector<PduStamp> const &stamps,  //!< Receive stamps.
+               std::vector<uint8_t> const &columns //!< Serialized columnar
+                                                   //!< results or empty.
                )
       : type(type), request(std::move(request)),
-        results(std::make_shared<std::vector<uint8_t>>(results)),
-        errors(std::vector<SnmpError>(errors)) {}
+        results(std::make_shared<ResultBuffer>(results)),
+        errors(std::vector<SnmpError>(errors)),
+        stamps(std::vector<PduStamp>(stamps)),
+        columns(columns.empty() ? nullptr
+                                : std::make_shared<ColumnarResults>(columns)) {
+  }
 
   /*!
     Shared argument constructor (for internal use).
   */
-  SnmpResponse(
-      SnmpResponseType type,                         //!< SNMP response type.
-      SnmpRequest request,                           //!< SNMP request.
-      std::shared_ptr<std::vector<uint8_t>> results, //!< Raw SNMP results.
-      std::vector<SnmpError> errors                  //!< Collected errors.
-      )
+  SnmpResponse(SnmpResponseType type,                 //!< SNMP response type.
+               SnmpRequest request,                   //!< SNMP request.
+               std::shared_ptr<ResultBuffer> results, //!< Raw SNMP results.
+               std::vector<SnmpError> errors,         //!< Collected errors.
+               std::vector<PduStamp> stamps,          //!< Receive stamps.
+               std::shared_ptr<ColumnarResults> columns =
+                   nullptr //!< Columnar results.
+               )
       : type(type), request(std::move(request)), results(std::move(results)),
-        errors(std::move(errors)) {}
+        errors(std::move(errors)), stamps(std::move(stamps)),
+        columns(std::move(columns)) {}
 
   INLINE_CONST_GETTER(SnmpResponse, type);
   INLINE_CONST_GETTER(SnmpResponse, request);
   INLINE_CONST_GETTER(SnmpResponse, results);
   INLINE_CONST_GETTER(SnmpResponse, errors);
+  INLINE_CONST_GETTER(SnmpResponse, stamps);
+  INLINE_CONST_GETTER(SnmpResponse, columns);
   REPR(SnmpResponse);
 };
 
@@ -834,7 +1001,11 @@ operator==(SnmpResponse const &lhs, //!< Left-hand side object to compare
   return (lhs.get_type() == rhs.get_type()) &&
          (lhs.get_request() == rhs.get_request()) &&
          (*(lhs.get_results()) == *(rhs.get_results())) &&
-         (lhs.get_errors() == rhs.get_errors());
+         (lhs.get_errors() == rhs.get_errors()) &&
+         (lhs.get_stamps() == rhs.get_stamps()) &&
+         ((lhs.get_columns() == nullptr && rhs.get_columns() == nullptr) ||
+          (lhs.get_columns() != nullptr && rhs.get_columns() != nullptr &&
+           *(lhs.get_columns()) == *(rhs.get_columns())));
 }
 
 /*!
@@ -856,6 +1027,9 @@ operator==(SnmpResponse const &lhs, //!< Left-hand side object to compare
   case SnmpResponse::FAILED:
     string = "FAILED";
     break;
+  case SnmpResponse::PARTIAL:
+    string = "PARTIAL";
+    break;
   }
   return string;
 }
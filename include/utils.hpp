@@ -5,7 +5,9 @@
 
 #include <algorithm>
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <string>
 #include <vector>
 
 namespace snmp_stream {
@@ -97,6 +99,16 @@ attr_to_string(std::string const &string //!< String attribute.
   return "'" + string + "'";
 }
 
+/*!
+  Generate attrs (python module) style attribute values.
+
+  \return `std::string`.
+*/
+[[nodiscard]] inline auto attr_to_string(bool const &val //!< Bool attribute.
+                                         ) -> std::string {
+  return val ? "True" : "False";
+}
+
 /*!
   Generate attrs (python module) style attribute values.
 
@@ -0,0 +1,109 @@
+// snmp_stream/_snmp_stream/wireline.hpp
+
+#ifndef WIRELINE_HPP
+#define WIRELINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ber.hpp"
+#include "columns.hpp"
+#include "types.hpp"
+
+// macro to align to system
+#define SYS_ALIGN(x) (((x) + (sizeof(size_t) - 1)) & ~(sizeof(size_t) - 1))
+
+#define HEADER_BYTES 16
+// word aligned records in the host representation
+#define WIRELINE_VERSION_1 1
+// unpadded records with LEB128 varints, independent of the host
+#define WIRELINE_VERSION_2 2
+// version 2 with each index delta encoded against the previous index of its
+// root OID
+#define WIRELINE_VERSION_3 3
+
+namespace snmp_stream {
+
+enum class endian {
+#ifdef _WIN32
+  little = 0,
+  big = 1,
+  native = little
+#else
+  little = __ORDER_LITTLE_ENDIAN__,
+  big = __ORDER_BIG_ENDIAN__,
+  native = __BYTE_ORDER__
+#endif
+};
+
+/*!
+  Append the results header.  The first 16 bytes are the same for every
+  version: byte order, word size, octet size and the version in byte 3.
+*/
+void append_header(
+    ResultBuffer &results, //!< Results.
+    uint8_t version,       //!< Wireline version.
+    std::optional<std::string> const &req_id,   //!< Request ID.
+    std::vector<ObjectIdentity> const &root_oids //!< Root OIDs.
+);
+
+/*!
+  Append a record.  The whole record is reserved at once, so it never
+  straddles two segments.
+*/
+void append_record(ResultBuffer &results,   //!< Results.
+                   uint8_t version,         //!< Wireline version.
+                   size_t stamp_index,      //!< Index of the receive stamp.
+                   size_t root_oid_index,   //!< Root OID index.
+                   size_t root_oid_size,    //!< Sub-identifiers of the root
+                                            //!< OID.
+                   VarBind const &var_bind, //!< Variable binding.
+                   std::vector<oid_t> &previous_index //!< Index of the
+                                                      //!< previous record of
+                                                      //!< the root OID in
+                                                      //!< `results`, updated
+                                                      //!< by version 3.
+);
+
+/*!
+  Wireline results decoded into columns.
+*/
+struct DecodedResults {
+  std::optional<std::string> req_id;        //!< Request ID of the header.
+  std::vector<ObjectIdentity> root_oids;    //!< Root OIDs of the header.
+  std::shared_ptr<ColumnarResults> columns; //!< Records by root OID.
+};
+
+/*!
+  Decode wireline results of any version in a single pass.  The header must
+  be first and every chunk must hold whole records, as do the segments of a
+  `ResultBuffer`.  The columns are the same as if the results were collected
+  with `Config.columnar`.
+
+  \exception std::invalid_argument The results are malformed, of an unknown
+  version, or version 1 results written by a system with a different byte
+  order, word size or octet size.
+
+  \return `DecodedResults`
+*/
+[[nodiscard]] auto decode_results(
+    std::vector<std::pair<uint8_t const *, size_t>> const &chunks //!< Chunks
+                                                                  //!< in order.
+    ) -> DecodedResults;
+
+/*!
+  Decode the segments of a result buffer.
+
+  \return `DecodedResults`
+*/
+[[nodiscard]] auto decode_results(ResultBuffer const &results //!< Results.
+                                  ) -> DecodedResults;
+
+} // namespace snmp_stream
+
+#endif
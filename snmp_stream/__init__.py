@@ -1,6 +1,7 @@
 """Snmp-stream."""
 
-from typing import Mapping, Optional, Sequence, Text, Tuple, TypedDict, Union
+import asyncio
+from typing import AsyncIterator, Mapping, Optional, Sequence, Text, Tuple, TypedDict, Union
 
 import snmp_stream._snmp_stream as snmp
 
@@ -79,7 +80,16 @@ ConfigMapping = TypedDict('ConfigMapping', {
     'retries': Optional[int],
     'timeout': Optional[int],
     'max_response_var_binds_per_pdu': Optional[int],
-    'max_async_sessions': Optional[int]
+    'max_async_sessions': Optional[int],
+    'partial_result_bytes': Optional[int],
+    'partial_result_records': Optional[int],
+    'adaptive_repetitions': Optional[bool],
+    'pipeline_depth': Optional[int],
+    'auto_partition': Optional[int],
+    'counter_rates': Optional[bool],
+    'columnar': Optional[bool],
+    'wireline_version': Optional[int],
+    'shared_memory': Optional[bool]
 }, total=False)
 
 ConfigType = Union[
@@ -102,19 +112,19 @@ SnmpRequestType = Union[
 ]
 
 
-def get(
+def _request(
+        request_type: snmp.SnmpRequest.SnmpRequestType,
         host: Text,
         community: Union[snmp.Community, Tuple[Text, Union[snmp.Community.Version, Text]]],
         oids: Sequence[ObjectIdentityType],
         ranges: Optional[Sequence[ObjectIdentityRangeType]] = None,
         req_id: Optional[Text] = None,
         config: Optional[Union[snmp.Config, Mapping[Text, Optional[int]]]] = None
-) -> Optional[snmp.SnmpResponse]:
+) -> snmp.SnmpRequest:
     # pylint: disable=too-many-arguments
-    """Perform SNMP get request."""
-    session = snmp.SessionManager()
-    session.add_request(snmp.SnmpRequest(
-        snmp.SnmpRequest.SnmpRequestType.GET_REQUEST,
+    """Build an :class:SnmpRequest from the various argument representations."""
+    return snmp.SnmpRequest(
+        request_type,
         host,
         community if isinstance(community, snmp.Community)
         else snmp.Community(community[0], to_version(community[1])),
@@ -123,7 +133,40 @@ def get(
         else None,
         req_id,
         config if isinstance(config, snmp.Config) or config is None else snmp.Config(**config)
-    ))
+    )
+
+
+def _single_response(request: snmp.SnmpRequest) -> snmp.SnmpRequest:
+    """Reject a request that would complete in partial responses.
+
+    :func:`get`, :func:`walk` and their awaitable counterparts return one response, so the other
+    chunks of partial results would be lost; :func:`stream` and :meth:`SessionManager.run` return
+    every chunk.
+    """
+    config = request.config
+    if config is not None and (config.partial_result_bytes or config.partial_result_records):
+        raise ValueError(f'partial results are not supported by get and walk: {request}')
+    return request
+
+
+def get(
+        host: Text,
+        community: Union[snmp.Community, Tuple[Text, Union[snmp.Community.Version, Text]]],
+        oids: Sequence[ObjectIdentityType],
+        ranges: Optional[Sequence[ObjectIdentityRangeType]] = None,
+        req_id: Optional[Text] = None,
+        config: Optional[Union[snmp.Config, Mapping[Text, Optional[int]]]] = None
+) -> Optional[snmp.SnmpResponse]:
+    # pylint: disable=too-many-arguments
+    """Perform SNMP get request.
+
+    :raises ValueError: The config streams partial results.
+    """
+    session = snmp.SessionManager()
+    session.add_request(_single_response(_request(
+        snmp.SnmpRequest.SnmpRequestType.GET_REQUEST, host, community, oids, ranges, req_id,
+        config
+    )))
     response = session.run()
     return response[0] if response is not None else None
 
@@ -137,18 +180,120 @@ def walk(
         config: Optional[Union[snmp.Config, Mapping[Text, Optional[int]]]] = None
 ) -> Optional[snmp.SnmpResponse]:
     # pylint: disable=too-many-arguments
-    """Perform SNMP walk request."""
+    """Perform SNMP walk request.
+
+    :raises ValueError: The config streams partial results.
+    """
     session = snmp.SessionManager()
-    session.add_request(snmp.SnmpRequest(
-        snmp.SnmpRequest.SnmpRequestType.WALK_REQUEST,
-        host,
-        community if isinstance(community, snmp.Community)
-        else snmp.Community(community[0], to_version(community[1])),
-        [to_object_identity(oid) for oid in oids],
-        [to_object_identity_range(oid_range) for oid_range in ranges] if ranges is not None
-        else None,
-        req_id,
-        config if isinstance(config, snmp.Config) or config is None else snmp.Config(**config)
-    ))
+    session.add_request(_single_response(_request(
+        snmp.SnmpRequest.SnmpRequestType.WALK_REQUEST, host, community, oids, ranges, req_id,
+        config
+    )))
     response = session.run()
     return response[0] if response is not None else None
+
+
+class ColumnTable:
+    # pylint: disable=too-few-public-methods
+    """Columnar results of one root OID of a response.
+
+    Implements the Arrow PyCapsule interface, so e.g. :func:`pyarrow.record_batch` imports the
+    columns without copying.
+
+    :param response: Response collected with :attr:`Config.columnar`.
+    :param root_oid_index: Index of the root OID in the request.
+    """
+
+    def __init__(self, response: snmp.SnmpResponse, root_oid_index: int) -> None:
+        """Initialize the column table."""
+        self.response = response
+        self.root_oid_index = root_oid_index
+
+    def __arrow_c_array__(self, requested_schema: Optional[object] = None) -> Tuple[object, object]:
+        # pylint: disable=unused-argument
+        """Export the columns as Arrow schema and array capsules.
+
+        The columns have a fixed schema, so `requested_schema` is not applied.
+        """
+        return self.response.arrow_c_array(self.root_oid_index)
+
+
+def column_tables(response: snmp.SnmpResponse) -> Sequence[ColumnTable]:
+    """Get the :class:`ColumnTable` of each root OID of a columnar response."""
+    return [ColumnTable(response, index) for index in range(len(response.request.oids))]
+
+
+async def stream(session: snmp.SessionManager) -> AsyncIterator[snmp.SnmpResponse]:
+    """Yield responses as the session manager completes them.
+
+    The manager is driven from the running event loop through its pollable file descriptor, so
+    any number of requests share the loop with other I/O without extra threads.  The iterator
+    ends once there are no pending or active requests.
+
+    Without worker threads, each step opens the sessions of newly added requests on the event
+    loop thread, including any blocking host name resolution; prefer addresses, or a manager with
+    ``threads``, where that latency matters.
+    """
+    loop = asyncio.get_running_loop()
+    ready = asyncio.Event()
+    loop.add_reader(session.get_fd(), ready.set)
+    try:
+        while True:
+            ready.clear()
+            responses = session.step()
+            if responses is None:
+                return
+            for response in responses:
+                yield response
+            if responses:
+                continue
+            try:
+                await asyncio.wait_for(ready.wait(), session.get_timeout())
+            except asyncio.TimeoutError:
+                pass
+    finally:
+        loop.remove_reader(session.get_fd())
+
+
+async def get_async(
+        host: Text,
+        community: Union[snmp.Community, Tuple[Text, Union[snmp.Community.Version, Text]]],
+        oids: Sequence[ObjectIdentityType],
+        ranges: Optional[Sequence[ObjectIdentityRangeType]] = None,
+        req_id: Optional[Text] = None,
+        config: Optional[Union[snmp.Config, Mapping[Text, Optional[int]]]] = None
+) -> Optional[snmp.SnmpResponse]:
+    # pylint: disable=too-many-arguments
+    """Perform SNMP get request without blocking the event loop.
+
+    :raises ValueError: The config streams partial results.
+    """
+    session = snmp.SessionManager()
+    session.add_request(_single_response(_request(
+        snmp.SnmpRequest.SnmpRequestType.GET_REQUEST, host, community, oids, ranges, req_id,
+        config
+    )))
+    responses = [response async for response in stream(session)]
+    return responses[0] if responses else None
+
+
+async def walk_async(
+        host: Text,
+        community: Union[snmp.Community, Tuple[Text, Union[snmp.Community.Version, Text]]],
+        oids: Sequence[ObjectIdentityType],
+        ranges: Optional[Sequence[ObjectIdentityRangeType]] = None,
+        req_id: Optional[Text] = None,
+        config: Optional[Union[snmp.Config, Mapping[Text, Optional[int]]]] = None
+) -> Optional[snmp.SnmpResponse]:
+    # pylint: disable=too-many-arguments
+    """Perform SNMP walk request without blocking the event loop.
+
+    :raises ValueError: The config streams partial results.
+    """
+    session = snmp.SessionManager()
+    session.add_request(_single_response(_request(
+        snmp.SnmpRequest.SnmpRequestType.WALK_REQUEST, host, community, oids, ranges, req_id,
+        config
+    )))
+    responses = [response async for response in stream(session)]
+    return responses[0] if responses else None
@@ -1,4 +1,4 @@
-from typing import Iterator, Optional, Sequence, Text, Tuple, Union
+from typing import Any, Callable, Dict, Iterator, Optional, Sequence, Text, Tuple, Union
 
 import numpy as np
 
@@ -42,12 +42,23 @@ class Config:
     timeout: Optional[int]
     max_response_var_binds_per_pdu: Optional[int]
     max_async_sessions: Optional[int]
-    def __init__(self, retires: Optional[int], timeout: Optional[int], max_reponse_var_binds_per_pdu: Optional[int], max_async_sessions: Optional[int]) -> None: ...
+    partial_result_bytes: Optional[int]
+    partial_result_records: Optional[int]
+    adaptive_repetitions: Optional[bool]
+    pipeline_depth: Optional[int]
+    auto_partition: Optional[int]
+    counter_rates: Optional[bool]
+    columnar: Optional[bool]
+    wireline_version: Optional[int]
+    shared_memory: Optional[bool]
+    def __init__(self, retires: Optional[int], timeout: Optional[int], max_reponse_var_binds_per_pdu: Optional[int], max_async_sessions: Optional[int], partial_result_bytes: Optional[int] = None, partial_result_records: Optional[int] = None, adaptive_repetitions: Optional[bool] = None, pipeline_depth: Optional[int] = None, auto_partition: Optional[int] = None, counter_rates: Optional[bool] = None, columnar: Optional[bool] = None, wireline_version: Optional[int] = None, shared_memory: Optional[bool] = None) -> None: ...
     def __eq__(self, other: object) -> bool: ...
     def __ne__(self, other: object) -> bool: ...
 
 def test_ambiguous_root_oids(oids: Sequence[ObjectIdentity]) -> Optional[Tuple[ObjectIdentity, ObjectIdentity]]: ...
 
+def decode_results(results: np.ndarray) -> Dict[Text, Any]: ...
+
 class SnmpRequest:
     class SnmpRequestType:
         GET_REQUEST: 'SnmpRequest.SnmpRequestType'
@@ -74,6 +85,7 @@ class SnmpError:
         TRANSPORT_DISCONNECT_ERROR: 'SnmpError.SnmpErrorType'
         CREATE_RESPONSE_PDU_ERROR: 'SnmpError.SnmpErrorType'
         VALUE_WARNING: 'SnmpError.SnmpErrorType'
+        SINK_ERROR: 'SnmpError.SnmpErrorType'
     type: SnmpErrorType
     request: SnmpRequest
     sys_errno: Optional[int]
@@ -86,23 +98,76 @@ class SnmpError:
     def __eq__(self, other: object) -> bool: ...
     def __ne__(self, other: object) -> bool: ...
 
+class PduStamp:
+    realtime_ns: int
+    monotonic_ns: int
+    rtt_ns: int
+    def __init__(self, realtime_ns: int, monotonic_ns: int, rtt_ns: int) -> None: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __ne__(self, other: object) -> bool: ...
+
 class SnmpResponse:
     class SnmpResponseType:
         SUCCESSFUL: 'SnmpResponse.SnmpResponseType'
         DONE_WITH_ERRORS: 'SnmpResponse.SnmpResponseType'
         FAILED: 'SnmpResponse.SnmpResponseType'
+        PARTIAL: 'SnmpResponse.SnmpResponseType'
     type: SnmpResponseType
     request: SnmpRequest
     results: np.ndarray
+    segments: Sequence[np.ndarray]
     errors: Sequence[SnmpError]
-    def __init__(self, type: SnmpResponseType, request: SnmpRequest, results: np.ndarray, errors: Sequence[SnmpError]) -> None: ...
+    stamps: Sequence[PduStamp]
+    columns: Optional[Sequence[Dict[Text, np.ndarray]]]
+    def __init__(self, type: SnmpResponseType, request: SnmpRequest, results: np.ndarray, errors: Sequence[SnmpError], stamps: Sequence[PduStamp] = ..., columns: Sequence[int] = ..., shared_memory: bool = False) -> None: ...
+    def decode(self) -> Dict[Text, Any]: ...
+    def arrow_c_array(self, root_oid_index: int) -> Tuple[Any, Any]: ...
+    def __eq__(self, other: object) -> bool: ...
+    def __ne__(self, other: object) -> bool: ...
+
+class IoStats:
+    send_calls: int
+    sent_datagrams: int
+    max_send_batch: int
+    recv_calls: int
+    received_datagrams: int
+    max_recv_batch: int
+    def __init__(self, send_calls: int = 0, sent_datagrams: int = 0, max_send_batch: int = 0, recv_calls: int = 0, received_datagrams: int = 0, max_recv_batch: int = 0) -> None: ...
     def __eq__(self, other: object) -> bool: ...
     def __ne__(self, other: object) -> bool: ...
 
+class CounterRates:
+    def __init__(self) -> None: ...
+    def sample(self, oid: ObjectIdentity, type: int, value: int, monotonic_ns: int) -> Optional[Tuple[int, int, float]]: ...
+
+class ResultSink: ...
+
+class MemoryResultSink(ResultSink):
+    def __init__(self) -> None: ...
+    def take(self) -> Sequence[np.ndarray]: ...
+
+class FdResultSink(ResultSink):
+    def __init__(self, fd: int, batch_bytes: int = 4194304) -> None: ...
+    def flush(self) -> None: ...
+
+class CallbackResultSink(ResultSink):
+    def __init__(self, callback: Callable[[np.ndarray], None]) -> None: ...
+
 class SessionManager:
+    class MissedDeadlinePolicy:
+        SKIP: 'SessionManager.MissedDeadlinePolicy'
+        DEFER: 'SessionManager.MissedDeadlinePolicy'
+        OVERLAP: 'SessionManager.MissedDeadlinePolicy'
     config: Config
-    def __init__(self, config: Optional[Config] = None) -> None: ...
+    def __init__(self, config: Optional[Config] = None, shared_sockets: int = 0, io_batch_size: int = 0, threads: int = 0, result_segment_bytes: int = 1048576, max_host_sessions: int = 0, max_host_pdus_per_second: float = 0.0, ipv4_prefix_length: int = 32, ipv6_prefix_length: int = 128, sink: Optional[ResultSink] = None) -> None: ...
     def add_request(self, request: SnmpRequest) -> None: ...
+    def add_job(self, request: SnmpRequest, interval: float, phase_jitter: float = 1.0, missed_deadline: MissedDeadlinePolicy = MissedDeadlinePolicy.SKIP) -> int: ...
+    def remove_job(self, id: int) -> bool: ...
+    def get_jobs_count(self) -> int: ...
+    def get_io_stats(self) -> IoStats: ...
     def run(self) -> Optional[Sequence[SnmpResponse]]: ...
+    def step(self) -> Optional[Sequence[SnmpResponse]]: ...
+    def get_fd(self) -> int: ...
+    def get_timeout(self) -> Optional[float]: ...
     def __eq__(self, other: object) -> bool: ...
     def __ne__(self, other: object) -> bool: ...
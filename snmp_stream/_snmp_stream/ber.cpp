@@ -0,0 +1,410 @@
+// snmp_stream/_snmp_stream/ber.cpp
+
+#include <algorithm>
+#include <cstring>
+
+#include "ber.hpp"
+
+namespace snmp_stream {
+
+/*!
+  Get the encoded size of a definite length.
+
+  \return `size_t`
+*/
+[[nodiscard]] static auto ber_length_size(size_t length) -> size_t {
+  size_t size = 1;
+  if (length >= 0x80) {
+    for (; length > 0; length >>= 8) {
+      size++;
+    }
+  }
+  return size;
+}
+
+/*!
+  Get the number of content octets of a two's complement integer.
+
+  \return `size_t`
+*/
+[[nodiscard]] static auto ber_integer_size(int64_t value) -> size_t {
+  size_t size = 1;
+  // drop leading octets that only repeat the sign bit
+  while (size < sizeof(value) &&
+         (value >> (8 * size - 1) != 0 && value >> (8 * size - 1) != -1)) {
+    size++;
+  }
+  return size;
+}
+
+/*!
+  Get the number of base-128 octets of a sub-identifier.
+
+  \return `size_t`
+*/
+[[nodiscard]] static auto ber_subid_size(uint64_t subid) -> size_t {
+  size_t size = 1;
+  for (subid >>= 7; subid > 0; subid >>= 7) {
+    size++;
+  }
+  return size;
+}
+
+/*!
+  Get the number of content octets of an object identifier.  The first two
+  sub-identifiers are combined as required by X.690.
+
+  \return `size_t`
+*/
+[[nodiscard]] static auto ber_oid_size(ObjectIdentity const &oid) -> size_t {
+  if (oid.size() < 2) {
+    return ber_subid_size(oid.empty() ? 0 : oid[0] * 40);
+  }
+  size_t size = ber_subid_size(oid[0] * 40 + oid[1]);
+  for (size_t i = 2; i < oid.size(); ++i) {
+    size += ber_subid_size(oid[i]);
+  }
+  return size;
+}
+
+/*!
+  Write a tag and definite length.
+*/
+static void ber_write_header(uint8_t *&out, uint8_t tag, size_t length) {
+  *out++ = tag;
+  size_t size = ber_length_size(length);
+  if (size == 1) {
+    *out++ = (uint8_t)length;
+    return;
+  }
+  *out++ = (uint8_t)(0x80 | (size - 1));
+  for (size_t i = size - 1; i > 0; --i) {
+    *out++ = (uint8_t)(length >> (8 * (i - 1)));
+  }
+}
+
+/*!
+  Write an INTEGER.
+*/
+static void ber_write_integer(uint8_t *&out, int64_t value) {
+  size_t size = ber_integer_size(value);
+  ber_write_header(out, BER_INTEGER, size);
+  for (size_t i = size; i > 0; --i) {
+    *out++ = (uint8_t)((uint64_t)value >> (8 * (i - 1)));
+  }
+}
+
+/*!
+  Write a base-128 sub-identifier.
+*/
+static void ber_write_subid(uint8_t *&out, uint64_t subid) {
+  for (size_t i = ber_subid_size(subid); i > 1; --i) {
+    *out++ = (uint8_t)(0x80 | (subid >> (7 * (i - 1))));
+  }
+  *out++ = (uint8_t)(subid & 0x7f);
+}
+
+/*!
+  Write an OBJECT IDENTIFIER.
+*/
+static void ber_write_oid(uint8_t *&out, ObjectIdentity const &oid) {
+  ber_write_header(out, BER_OBJECT_ID, ber_oid_size(oid));
+  if (oid.size() < 2) {
+    ber_write_subid(out, oid.empty() ? 0 : oid[0] * 40);
+    return;
+  }
+  ber_write_subid(out, oid[0] * 40 + oid[1]);
+  for (size_t i = 2; i < oid.size(); ++i) {
+    ber_write_subid(out, oid[i]);
+  }
+}
+
+/*!
+  Read an OBJECT IDENTIFIER into `oid`.  On success `pos` is advanced past the
+  object identifier.
+
+  \return `bool`: `false` if malformed.
+*/
+[[nodiscard]] static auto ber_read_oid(uint8_t const *data, size_t size,
+                                       size_t &pos, std::vector<oid_t> &oid)
+    -> bool {
+  size_t cur = pos;
+  auto length = ber_read_header(data, size, cur, BER_OBJECT_ID);
+  if (!length.has_value() || *length == 0) {
+    return false;
+  }
+  oid.clear();
+  uint64_t subid = 0;
+  for (size_t end = cur + *length; cur < end; ++cur) {
+    subid = (subid << 7) | (data[cur] & 0x7f);
+    if ((data[cur] & 0x80) != 0) {
+      continue;
+    }
+    // split the combined first two sub-identifiers
+    if (oid.empty()) {
+      uint64_t first = std::min<uint64_t>(subid / 40, 2);
+      oid.push_back(first);
+      oid.push_back(subid - first * 40);
+    } else {
+      oid.push_back(subid);
+    }
+    subid = 0;
+  }
+  // the last octet must end a sub-identifier
+  if ((data[cur - 1] & 0x80) != 0) {
+    return false;
+  }
+  pos = cur;
+  return true;
+}
+
+/*!
+  Read an unsigned integer of any tag.  On success `pos` is advanced past the
+  integer.
+
+  \return `std::optional<uint64_t>`: Value or `std::nullopt` if malformed.
+*/
+[[nodiscard]] static auto ber_read_unsigned(uint8_t const *data, size_t size,
+                                            size_t &pos, uint8_t tag)
+    -> std::optional<uint64_t> {
+  size_t cur = pos;
+  auto length = ber_read_header(data, size, cur, tag);
+  // a leading zero octet keeps the high bit of a 64-bit value unsigned
+  if (!length.has_value() || *length == 0 ||
+      *length > sizeof(uint64_t) + 1 ||
+      (*length == sizeof(uint64_t) + 1 && data[cur] != 0)) {
+    return std::nullopt;
+  }
+  uint64_t value = 0;
+  for (size_t i = 0; i < *length; ++i) {
+    value = (value << 8) | data[cur + i];
+  }
+  pos = cur + *length;
+  return value;
+}
+
+auto ber_read_header(uint8_t const *data, size_t size, size_t &pos, uint8_t tag)
+    -> std::optional<size_t> {
+  size_t cur = pos;
+  if (cur + 2 > size || data[cur++] != tag) {
+    return std::nullopt;
+  }
+  size_t length = data[cur++];
+  // long form: low bits are the number of length octets
+  if ((length & 0x80) != 0) {
+    size_t octets = length & 0x7f;
+    if (octets == 0 || octets > sizeof(uint32_t) || cur + octets > size) {
+      return std::nullopt;
+    }
+    length = 0;
+    while (octets-- > 0) {
+      length = (length << 8) | data[cur++];
+    }
+  }
+  if (cur + length > size) {
+    return std::nullopt;
+  }
+  pos = cur;
+  return length;
+}
+
+auto ber_read_integer(uint8_t const *data, size_t size, size_t &pos,
+                      uint8_t tag) -> std::optional<int64_t> {
+  size_t cur = pos;
+  auto length = ber_read_header(data, size, cur, tag);
+  if (!length.has_value() || *length == 0 || *length > sizeof(int64_t)) {
+    return std::nullopt;
+  }
+  // sign extend from the first content octet
+  auto value = (int64_t)(int8_t)data[cur];
+  for (size_t i = 1; i < *length; ++i) {
+    value = (int64_t)(((uint64_t)value << 8) | data[cur + i]);
+  }
+  pos = cur + *length;
+  return value;
+}
+
+auto ber_peek_request_id(uint8_t const *data, size_t size)
+    -> std::optional<int64_t> {
+  size_t pos = 0;
+  // Message ::= SEQUENCE { version, community, data }
+  if (!ber_read_header(data, size, pos, BER_SEQUENCE).has_value() ||
+      !ber_read_integer(data, size, pos, BER_INTEGER).has_value()) {
+    return std::nullopt;
+  }
+  auto community = ber_read_header(data, size, pos, BER_OCTET_STRING);
+  if (!community.has_value()) {
+    return std::nullopt;
+  }
+  pos += *community;
+  // PDU ::= [tag] IMPLICIT SEQUENCE { request-id, ... }
+  if (pos >= size || ((data[pos] & 0xe0) != 0xa0) ||
+      !ber_read_header(data, size, pos, data[pos]).has_value()) {
+    return std::nullopt;
+  }
+  return ber_read_integer(data, size, pos, BER_INTEGER);
+}
+
+void ber_encode_request(std::vector<uint8_t> &buffer, int64_t version,
+                        std::string const &community, uint8_t command,
+                        int64_t request_id, int64_t non_repeaters,
+                        int64_t max_repetitions,
+                        std::vector<ObjectIdentity const *> const &oids) {
+  // size each constructed type from the inside out
+  size_t var_binds_length = 0;
+  for (auto &&oid : oids) {
+    size_t oid_length = ber_oid_size(*oid);
+    size_t var_bind_length = 1 + ber_length_size(oid_length) + oid_length + 2;
+    var_binds_length += 1 + ber_length_size(var_bind_length) + var_bind_length;
+  }
+  size_t pdu_length = 1 + 1 + ber_integer_size(request_id) + 1 + 1 +
+                      ber_integer_size(non_repeaters) + 1 + 1 +
+                      ber_integer_size(max_repetitions) + 1 +
+                      ber_length_size(var_binds_length) + var_binds_length;
+  size_t message_length = 1 + 1 + ber_integer_size(version) + 1 +
+                          ber_length_size(community.size()) +
+                          community.size() + 1 + ber_length_size(pdu_length) +
+                          pdu_length;
+  buffer.resize(1 + ber_length_size(message_length) + message_length);
+
+  // Message ::= SEQUENCE { version, community, data }
+  uint8_t *out = buffer.data();
+  ber_write_header(out, BER_SEQUENCE, message_length);
+  ber_write_integer(out, version);
+  ber_write_header(out, BER_OCTET_STRING, community.size());
+  std::memcpy(out, community.data(), community.size());
+  out += community.size();
+
+  // PDU ::= [tag] IMPLICIT SEQUENCE { request-id, ..., variable-bindings }
+  ber_write_header(out, command, pdu_length);
+  ber_write_integer(out, request_id);
+  ber_write_integer(out, non_repeaters);
+  ber_write_integer(out, max_repetitions);
+  ber_write_header(out, BER_SEQUENCE, var_binds_length);
+  for (auto &&oid : oids) {
+    size_t oid_length = ber_oid_size(*oid);
+    ber_write_header(out, BER_SEQUENCE,
+                     1 + ber_length_size(oid_length) + oid_length + 2);
+    ber_write_oid(out, *oid);
+    ber_write_header(out, BER_NULL, 0);
+  }
+}
+
+auto ber_decode_pdu(uint8_t const *data, size_t size)
+    -> std::optional<BerPdu> {
+  BerPdu pdu{};
+  size_t pos = 0;
+  // Message ::= SEQUENCE { version, community, data }
+  if (!ber_read_header(data, size, pos, BER_SEQUENCE).has_value()) {
+    return std::nullopt;
+  }
+  auto version = ber_read_integer(data, size, pos, BER_INTEGER);
+  auto community = ber_read_header(data, size, pos, BER_OCTET_STRING);
+  if (!version.has_value() || !community.has_value()) {
+    return std::nullopt;
+  }
+  pos += *community;
+  // PDU ::= [tag] IMPLICIT SEQUENCE { request-id, ..., variable-bindings }
+  if (pos >= size || ((data[pos] & 0xe0) != 0xa0)) {
+    return std::nullopt;
+  }
+  pdu.version = *version;
+  pdu.command = data[pos];
+  if (!ber_read_header(data, size, pos, pdu.command).has_value()) {
+    return std::nullopt;
+  }
+  auto request_id = ber_read_integer(data, size, pos, BER_INTEGER);
+  auto error_status = ber_read_integer(data, size, pos, BER_INTEGER);
+  auto error_index = ber_read_integer(data, size, pos, BER_INTEGER);
+  auto var_binds = ber_read_header(data, size, pos, BER_SEQUENCE);
+  if (!request_id.has_value() || !error_status.has_value() ||
+      !error_index.has_value() || !var_binds.has_value()) {
+    return std::nullopt;
+  }
+  pdu.request_id = *request_id;
+  pdu.error_status = *error_status;
+  pdu.error_index = *error_index;
+  pdu.var_binds_pos = pos;
+  pdu.var_binds_end = pos + *var_binds;
+  return pdu;
+}
+
+auto ber_decode_var_bind(uint8_t const *data, size_t end, size_t &pos,
+                         BerScratch &scratch, VarBind &var_bind) -> bool {
+  // VarBind ::= SEQUENCE { name, value }
+  size_t cur = pos;
+  auto length = ber_read_header(data, end, cur, BER_SEQUENCE);
+  if (!length.has_value()) {
+    return false;
+  }
+  size_t var_bind_end = cur + *length;
+  if (!ber_read_oid(data, var_bind_end, cur, scratch.name) ||
+      cur >= var_bind_end) {
+    return false;
+  }
+  var_bind.name = scratch.name.data();
+  var_bind.name_length = scratch.name.size();
+  var_bind.type = data[cur];
+
+  switch (var_bind.type) {
+  case BER_INTEGER: {
+    auto value = ber_read_integer(data, var_bind_end, cur, BER_INTEGER);
+    if (!value.has_value()) {
+      return false;
+    }
+    scratch.scalar.integer = (long)*value;
+    var_bind.value = &scratch.scalar.integer;
+    var_bind.value_length = sizeof(scratch.scalar.integer);
+    break;
+  }
+  case BER_COUNTER32:
+  case BER_GAUGE32:
+  case BER_TIMETICKS:
+  case BER_UINTEGER32: {
+    auto value = ber_read_unsigned(data, var_bind_end, cur, var_bind.type);
+    if (!value.has_value()) {
+      return false;
+    }
+    // truncated to 32 bits like NET-SNMP
+    scratch.scalar.uinteger = (u_long)(*value & 0xffffffff);
+    var_bind.value = &scratch.scalar.uinteger;
+    var_bind.value_length = sizeof(scratch.scalar.uinteger);
+    break;
+  }
+  case BER_COUNTER64: {
+    auto value = ber_read_unsigned(data, var_bind_end, cur, var_bind.type);
+    if (!value.has_value()) {
+      return false;
+    }
+    scratch.scalar.counter.high = (u_long)(*value >> 32);
+    scratch.scalar.counter.low = (u_long)(*value & 0xffffffff);
+    var_bind.value = &scratch.scalar.counter;
+    var_bind.value_length = sizeof(scratch.scalar.counter);
+    break;
+  }
+  case BER_OBJECT_ID:
+    if (!ber_read_oid(data, var_bind_end, cur, scratch.oid_value)) {
+      return false;
+    }
+    var_bind.value = scratch.oid_value.data();
+    var_bind.value_length = scratch.oid_value.size() * sizeof(oid_t);
+    break;
+  default: {
+    // octet string like values and exceptions are views into the datagram
+    auto value_length = ber_read_header(data, var_bind_end, cur, var_bind.type);
+    if (!value_length.has_value()) {
+      return false;
+    }
+    var_bind.value = *value_length == 0 ? nullptr : &data[cur];
+    var_bind.value_length = *value_length;
+    cur += *value_length;
+    break;
+  }
+  }
+
+  var_bind.index++;
+  pos = var_bind_end;
+  return true;
+}
+
+} // namespace snmp_stream
@@ -0,0 +1,133 @@
+// snmp_stream/_snmp_stream/buffer.cpp
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "buffer.hpp"
+
+namespace snmp_stream {
+
+SegmentPool::SegmentPool(size_t segment_size) : segment_size(segment_size) {
+  if (segment_size < 1) {
+    throw std::invalid_argument("segment_size must be greater than 0");
+  }
+}
+
+auto SegmentPool::acquire() -> std::unique_ptr<uint8_t[]> {
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (!segments.empty()) {
+      auto segment = std::move(segments.back());
+      segments.pop_back();
+      return segment;
+    }
+  }
+  // default-initialized; the buffer overwrites everything it exposes
+  return std::unique_ptr<uint8_t[]>(new uint8_t[segment_size]);
+}
+
+void SegmentPool::release(std::unique_ptr<uint8_t[]> segment) {
+  std::lock_guard<std::mutex> guard(mutex);
+  segments.push_back(std::move(segment));
+}
+
+ResultBuffer::ResultBuffer(std::shared_ptr<SegmentPool> pool, bool shared)
+    : pool(std::move(pool)), shared(shared), size(0) {}
+
+ResultBuffer::ResultBuffer(std::vector<uint8_t> const &data)
+    : pool(nullptr), shared(false), size(0) {
+  if (!data.empty()) {
+    std::memcpy(append(data.size()), data.data(), data.size());
+  }
+}
+
+ResultBuffer::ResultBuffer(
+    std::vector<std::pair<std::string, size_t>> const &handles)
+    : pool(nullptr), shared(false), size(0) {
+  for (auto &&[name, used] : handles) {
+    auto segment = std::make_unique<SharedSegment>(name, used);
+    uint8_t *data = segment->get_data();
+    segments.push_back({nullptr, std::move(segment), data, used, used, false});
+    size += used;
+  }
+}
+
+ResultBuffer::~ResultBuffer() {
+  for (auto &segment : segments) {
+    if (segment.pooled) {
+      pool->release(std::move(segment.memory));
+    }
+  }
+}
+
+auto ResultBuffer::append(size_t size) -> uint8_t * {
+  if (segments.empty() ||
+      segments.back().capacity - segments.back().size < size) {
+    // records never straddle segments; oversized ones get a dedicated segment
+    if (shared) {
+      size_t capacity = std::max<size_t>(
+          size, pool != nullptr ? pool->get_segment_size()
+                                : DEFAULT_RESULT_SEGMENT_BYTES);
+      auto segment = std::make_unique<SharedSegment>(capacity);
+      uint8_t *data = segment->get_data();
+      segments.push_back({nullptr, std::move(segment), data, capacity, 0,
+                          false});
+    } else if (pool != nullptr && size <= pool->get_segment_size()) {
+      auto memory = pool->acquire();
+      uint8_t *data = memory.get();
+      segments.push_back({std::move(memory), nullptr, data,
+                          pool->get_segment_size(), 0, true});
+    } else {
+      size_t capacity = std::max<size_t>(
+          size, pool != nullptr ? 0 : DEFAULT_RESULT_SEGMENT_BYTES);
+      auto memory = std::unique_ptr<uint8_t[]>(new uint8_t[capacity]);
+      uint8_t *data = memory.get();
+      segments.push_back({std::move(memory), nullptr, data, capacity, 0,
+                          false});
+    }
+  }
+  Segment &segment = segments.back();
+  uint8_t *data = segment.data + segment.size;
+  segment.size += size;
+  this->size += size;
+  return data;
+}
+
+auto ResultBuffer::to_vector() const -> std::vector<uint8_t> {
+  std::vector<uint8_t> data;
+  data.reserve(size);
+  for (auto const &segment : segments) {
+    data.insert(data.end(), segment.data, segment.data + segment.size);
+  }
+  return data;
+}
+
+auto ResultBuffer::can_hand_off() const -> bool {
+  return !segments.empty() &&
+         std::all_of(segments.begin(), segments.end(),
+                     [](Segment const &segment) {
+                       return segment.shared != nullptr &&
+                              segment.shared->is_created() &&
+                              segment.shared->is_linked();
+                     });
+}
+
+auto ResultBuffer::hand_off()
+    -> std::vector<std::pair<std::string, size_t>> {
+  std::vector<std::pair<std::string, size_t>> handles;
+  for (auto &segment : segments) {
+    segment.shared->hand_off();
+    handles.emplace_back(segment.shared->get_name(), segment.size);
+  }
+  return handles;
+}
+
+auto operator==(ResultBuffer const &lhs, ResultBuffer const &rhs) -> bool {
+  if (lhs.get_size() != rhs.get_size()) {
+    return false;
+  }
+  return lhs.to_vector() == rhs.to_vector();
+}
+
+} // namespace snmp_stream
@@ -0,0 +1,490 @@
+// snmp_stream/_snmp_stream/columns.cpp
+
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+extern "C" {
+#include <debug.h>
+}
+
+#include "columns.hpp"
+#include "rates.hpp"
+
+namespace snmp_stream {
+
+ColumnTable::ColumnTable()
+    : length(0), index_offsets({0}), octets_offsets({0}) {}
+
+ColumnarResults::ColumnarResults(size_t root_oids) : tables(root_oids) {}
+
+// largest entry count of a variable length column
+static size_t const MAX_OFFSET = std::numeric_limits<int32_t>::max();
+
+void ColumnarResults::append(size_t root_oid_index, oid const *index,
+                             size_t index_size, uint8_t type,
+                             void const *value, size_t value_length,
+                             size_t stamp_index) {
+  ColumnTable &table = tables.at(root_oid_index);
+  size_t row = table.length;
+
+  // sessions hand off their columns well before the limit; a row that still
+  // does not fit must not leave the columns of different lengths
+  if (index_size > MAX_OFFSET - table.index.size() ||
+      value_length > MAX_OFFSET - table.octets.size()) {
+    throw std::runtime_error("columnar results exceed 32-bit Arrow offsets");
+  }
+
+  table.stamps.push_back(stamp_index);
+  table.types.push_back(type);
+  table.index.insert(table.index.end(), index, index + index_size);
+  table.index_offsets.push_back((int32_t)table.index.size());
+
+  // decode the value into the column of its type
+  std::optional<int64_t> integer;
+  std::optional<uint64_t> uinteger;
+  std::optional<CounterRate> rate;
+  bool octets = false;
+  switch (type) {
+  case BER_INTEGER:
+    if (value_length == sizeof(long)) {
+      long tmp;
+      std::memcpy(&tmp, value, sizeof(tmp));
+      integer = tmp;
+    }
+    break;
+  case BER_COUNTER32:
+  case BER_GAUGE32:
+  case BER_TIMETICKS:
+  case BER_UINTEGER32:
+    if (value_length == sizeof(u_long)) {
+      u_long tmp;
+      std::memcpy(&tmp, value, sizeof(tmp));
+      uinteger = tmp & 0xffffffff;
+    }
+    break;
+  case BER_COUNTER64:
+    if (value_length == sizeof(counter64)) {
+      counter64 tmp;
+      std::memcpy(&tmp, value, sizeof(tmp));
+      uinteger = ((uint64_t)(tmp.high & 0xffffffff) << 32) |
+                 (uint64_t)(tmp.low & 0xffffffff);
+    }
+    break;
+  case COUNTER_RATE:
+    if (value_length == sizeof(CounterRate)) {
+      CounterRate tmp;
+      std::memcpy(&tmp, value, sizeof(tmp));
+      uinteger = tmp.value;
+      rate = tmp;
+    }
+    break;
+  case BER_NULL:
+  case BER_NO_SUCH_OBJECT:
+  case BER_NO_SUCH_INSTANCE:
+  case BER_END_OF_MIB_VIEW:
+    break;
+  default:
+    octets = true;
+    break;
+  }
+
+  table.integer_validity.append(row, integer.has_value());
+  table.integer.push_back(integer.value_or(0));
+  table.uinteger_validity.append(row, uinteger.has_value());
+  table.uinteger.push_back(uinteger.value_or(0));
+  table.rate_validity.append(row, rate.has_value());
+  table.delta.push_back(rate.has_value() ? rate->delta : 0);
+  table.rate.push_back(rate.has_value() ? rate->rate : 0.0);
+  table.octets_validity.append(row, octets);
+  if (octets && value_length > 0) {
+    auto const *data = (uint8_t const *)value;
+    table.octets.insert(table.octets.end(), data, data + value_length);
+  }
+  table.octets_offsets.push_back((int32_t)table.octets.size());
+
+  table.length++;
+}
+
+/*!
+  Get the size of a vector's elements in bytes.
+
+  \return `size_t`
+*/
+template <typename T>
+[[nodiscard]] static inline auto
+get_bytes(std::vector<T> const &column //!< Column.
+          ) -> size_t {
+  return column.size() * sizeof(T);
+}
+
+auto ColumnarResults::get_size() const -> size_t {
+  size_t size = 0;
+  for (auto const &table : tables) {
+    size += get_bytes(table.stamps) + get_bytes(table.types) +
+            get_bytes(table.index_offsets) + get_bytes(table.index) +
+            get_bytes(table.integer_validity.bits) + get_bytes(table.integer) +
+            get_bytes(table.uinteger_validity.bits) +
+            get_bytes(table.uinteger) + get_bytes(table.rate_validity.bits) +
+            get_bytes(table.delta) + get_bytes(table.rate) +
+            get_bytes(table.octets_validity.bits) +
+            get_bytes(table.octets_offsets) + get_bytes(table.octets);
+  }
+  return size;
+}
+
+auto ColumnarResults::is_near_offset_limit() const -> bool {
+  for (auto const &table : tables) {
+    if (table.index.size() >= MAX_OFFSET - COLUMN_OFFSET_HEADROOM ||
+        table.octets.size() >= MAX_OFFSET - COLUMN_OFFSET_HEADROOM) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+  Serialize a word.
+*/
+static void write_word(std::vector<uint8_t> &data, //!< Output.
+                       uint64_t word                //!< Word.
+) {
+  auto const *bytes = (uint8_t const *)&word;
+  data.insert(data.end(), bytes, bytes + sizeof(word));
+}
+
+/*!
+  Serialize a column as its element count followed by its elements.
+*/
+template <typename T>
+static void write_column(std::vector<uint8_t> &data,  //!< Output.
+                         std::vector<T> const &column //!< Column.
+) {
+  write_word(data, column.size());
+  auto const *bytes = (uint8_t const *)column.data();
+  data.insert(data.end(), bytes, bytes + get_bytes(column));
+}
+
+/*!
+  Serialize a validity bitmap.
+*/
+static void write_bitmap(std::vector<uint8_t> &data,     //!< Output.
+                         ValidityBitmap const &bitmap //!< Bitmap.
+) {
+  write_word(data, bitmap.valid);
+  write_column(data, bitmap.bits);
+}
+
+auto ColumnarResults::to_vector() const -> std::vector<uint8_t> {
+  std::vector<uint8_t> data;
+  data.reserve(get_size() + sizeof(uint64_t) * (1 + tables.size() * 19));
+  write_word(data, tables.size());
+  for (auto const &table : tables) {
+    write_word(data, table.length);
+    write_column(data, table.stamps);
+    write_column(data, table.types);
+    write_column(data, table.index_offsets);
+    write_column(data, table.index);
+    write_bitmap(data, table.integer_validity);
+    write_column(data, table.integer);
+    write_bitmap(data, table.uinteger_validity);
+    write_column(data, table.uinteger);
+    write_bitmap(data, table.rate_validity);
+    write_column(data, table.delta);
+    write_column(data, table.rate);
+    write_bitmap(data, table.octets_validity);
+    write_column(data, table.octets_offsets);
+    write_column(data, table.octets);
+  }
+  return data;
+}
+
+/*!
+  Deserialize a word.
+
+  \return `uint64_t`
+*/
+[[nodiscard]] static auto
+read_word(std::vector<uint8_t> const &data, //!< Input.
+          size_t &pos                       //!< Read position.
+          ) -> uint64_t {
+  uint64_t word;
+  if (data.size() - pos < sizeof(word)) {
+    throw std::invalid_argument("truncated columnar results");
+  }
+  std::memcpy(&word, data.data() + pos, sizeof(word));
+  pos += sizeof(word);
+  return word;
+}
+
+/*!
+  Deserialize a column.
+*/
+template <typename T>
+static void read_column(std::vector<uint8_t> const &data, //!< Input.
+                        size_t &pos,                      //!< Read position.
+                        std::vector<T> &column,           //!< Column.
+                        size_t size //!< Expected element count.
+) {
+  if (read_word(data, pos) != size) {
+    throw std::invalid_argument("inconsistent columnar results");
+  }
+  if ((data.size() - pos) / sizeof(T) < size) {
+    throw std::invalid_argument("truncated columnar results");
+  }
+  column.resize(size);
+  if (size > 0) {
+    std::memcpy(column.data(), data.data() + pos, size * sizeof(T));
+  }
+  pos += size * sizeof(T);
+}
+
+/*!
+  Deserialize a validity bitmap.
+*/
+static void read_bitmap(std::vector<uint8_t> const &data, //!< Input.
+                        size_t &pos,                      //!< Read position.
+                        ValidityBitmap &bitmap,           //!< Bitmap.
+                        size_t length                     //!< Number of rows.
+) {
+  bitmap.valid = read_word(data, pos);
+  read_column(data, pos, bitmap.bits, (length + 7) / 8);
+  if (bitmap.valid > length) {
+    throw std::invalid_argument("inconsistent columnar results");
+  }
+}
+
+ColumnarResults::ColumnarResults(std::vector<uint8_t> const &data) {
+  size_t pos = 0;
+  size_t root_oids = read_word(data, pos);
+  if (root_oids > data.size()) {
+    throw std::invalid_argument("inconsistent columnar results");
+  }
+  tables.resize(root_oids);
+  for (auto &table : tables) {
+    table.length = read_word(data, pos);
+    if (table.length > data.size()) {
+      throw std::invalid_argument("inconsistent columnar results");
+    }
+    read_column(data, pos, table.stamps, table.length);
+    read_column(data, pos, table.types, table.length);
+    read_column(data, pos, table.index_offsets, table.length + 1);
+    read_column(data, pos, table.index, (size_t)table.index_offsets.back());
+    read_bitmap(data, pos, table.integer_validity, table.length);
+    read_column(data, pos, table.integer, table.length);
+    read_bitmap(data, pos, table.uinteger_validity, table.length);
+    read_column(data, pos, table.uinteger, table.length);
+    read_bitmap(data, pos, table.rate_validity, table.length);
+    read_column(data, pos, table.delta, table.length);
+    read_column(data, pos, table.rate, table.length);
+    read_bitmap(data, pos, table.octets_validity, table.length);
+    read_column(data, pos, table.octets_offsets, table.length + 1);
+    read_column(data, pos, table.octets,
+                (size_t)table.octets_offsets.back());
+    for (size_t row = 0; row < table.length; ++row) {
+      if (table.index_offsets[row] > table.index_offsets[row + 1] ||
+          table.octets_offsets[row] > table.octets_offsets[row + 1]) {
+        throw std::invalid_argument("inconsistent columnar results");
+      }
+    }
+    if (table.index_offsets.front() != 0 || table.octets_offsets.front() != 0) {
+      throw std::invalid_argument("inconsistent columnar results");
+    }
+  }
+  if (pos != data.size()) {
+    throw std::invalid_argument("trailing data after columnar results");
+  }
+}
+
+auto operator==(ColumnarResults const &lhs, ColumnarResults const &rhs)
+    -> bool {
+  return lhs.to_vector() == rhs.to_vector();
+}
+
+/*!
+  Producer data of an exported schema.
+*/
+struct ExportedSchema {
+  std::string format;                //!< Format string.
+  std::string name;                  //!< Field name.
+  std::vector<ArrowSchema *> children; //!< Child schemas.
+};
+
+/*!
+  Release an exported schema and its children.
+*/
+static void release_schema(ArrowSchema *schema //!< Schema.
+) {
+  auto *exported = (ExportedSchema *)schema->private_data;
+  for (auto *child : exported->children) {
+    if (child->release != nullptr) {
+      child->release(child);
+    }
+    delete child;
+  }
+  delete exported;
+  schema->release = nullptr;
+}
+
+/*!
+  Fill an exported schema.
+*/
+static void fill_schema(ArrowSchema *schema, //!< Schema.
+                        std::string format,  //!< Format string.
+                        std::string name,    //!< Field name.
+                        bool nullable,       //!< Field is nullable.
+                        std::vector<ArrowSchema *> children //!< Children.
+) {
+  auto *exported = new ExportedSchema{std::move(format), std::move(name),
+                                      std::move(children)};
+  *schema = (ArrowSchema){exported->format.c_str(),
+                         exported->name.c_str(),
+                         nullptr,
+                         nullable ? ARROW_FLAG_NULLABLE : 0,
+                         (int64_t)exported->children.size(),
+                         exported->children.data(),
+                         nullptr,
+                         release_schema,
+                         exported};
+}
+
+/*!
+  Allocate an exported child schema.
+
+  \return `ArrowSchema *`
+*/
+[[nodiscard]] static auto
+new_schema(std::string format, //!< Format string.
+           std::string name,   //!< Field name.
+           bool nullable,      //!< Field is nullable.
+           std::vector<ArrowSchema *> children = {} //!< Children.
+           ) -> ArrowSchema * {
+  auto *schema = new ArrowSchema;
+  fill_schema(schema, std::move(format), std::move(name), nullable,
+              std::move(children));
+  return schema;
+}
+
+/*!
+  Producer data of an exported array.
+*/
+struct ExportedArray {
+  std::shared_ptr<ColumnarResults const> columns; //!< Owner of the buffers.
+  std::vector<void const *> buffers;              //!< Buffers.
+  std::vector<ArrowArray *> children;             //!< Child arrays.
+};
+
+/*!
+  Release an exported array and its children.
+*/
+static void release_array(ArrowArray *array //!< Array.
+) {
+  auto *exported = (ExportedArray *)array->private_data;
+  for (auto *child : exported->children) {
+    if (child->release != nullptr) {
+      child->release(child);
+    }
+    delete child;
+  }
+  delete exported;
+  array->release = nullptr;
+}
+
+/*!
+  Fill an exported array.
+*/
+static void
+fill_array(ArrowArray *array, //!< Array.
+           std::shared_ptr<ColumnarResults const> const &columns, //!< Owner.
+           size_t length,                      //!< Number of rows.
+           size_t null_count,                  //!< Number of null rows.
+           std::vector<void const *> buffers,  //!< Buffers.
+           std::vector<ArrowArray *> children  //!< Children.
+) {
+  auto *exported =
+      new ExportedArray{columns, std::move(buffers), std::move(children)};
+  *array = (ArrowArray){(int64_t)length,
+                        (int64_t)null_count,
+                        0,
+                        (int64_t)exported->buffers.size(),
+                        (int64_t)exported->children.size(),
+                        exported->buffers.data(),
+                        exported->children.data(),
+                        nullptr,
+                        release_array,
+                        exported};
+}
+
+/*!
+  Allocate an exported child array.
+
+  \return `ArrowArray *`
+*/
+[[nodiscard]] static auto
+new_array(std::shared_ptr<ColumnarResults const> const &columns, //!< Owner.
+          size_t length,                          //!< Number of rows.
+          size_t null_count,                      //!< Number of null rows.
+          std::vector<void const *> buffers,      //!< Buffers.
+          std::vector<ArrowArray *> children = {} //!< Children.
+          ) -> ArrowArray * {
+  auto *array = new ArrowArray;
+  fill_array(array, columns, length, null_count, std::move(buffers),
+             std::move(children));
+  return array;
+}
+
+/*!
+  Export a nullable column; the validity bitmap is omitted without nulls.
+
+  \return `ArrowArray *`
+*/
+[[nodiscard]] static auto
+new_nullable_array(std::shared_ptr<ColumnarResults const> const &columns,
+                   size_t length,                  //!< Number of rows.
+                   ValidityBitmap const &validity, //!< Validity bitmap.
+                   std::vector<void const *> buffers //!< Value buffers.
+                   ) -> ArrowArray * {
+  size_t null_count = length - validity.valid;
+  buffers.insert(buffers.begin(),
+                 null_count > 0 ? validity.bits.data() : nullptr);
+  return new_array(columns, length, null_count, std::move(buffers));
+}
+
+void export_arrow(std::shared_ptr<ColumnarResults const> const &columns,
+                  size_t root_oid_index, ArrowSchema *schema,
+                  ArrowArray *array) {
+  ColumnTable const &table = columns->get_tables().at(root_oid_index);
+  size_t length = table.length;
+  DB_TRACELOC(0, "COLUMNS_EXPORT_ARROW: %zu: %zu rows\n", root_oid_index,
+              length);
+
+  fill_schema(
+      schema, "+s", "", false,
+      {new_schema("L", "stamp", false), new_schema("C", "type", false),
+       new_schema("+l", "index", false, {new_schema("L", "item", false)}),
+       new_schema("l", "integer", true), new_schema("L", "uinteger", true),
+       new_schema("L", "delta", true), new_schema("g", "rate", true),
+       new_schema("z", "octets", true)});
+
+  fill_array(
+      array, columns, length, 0, {nullptr},
+      {new_array(columns, length, 0, {nullptr, table.stamps.data()}),
+       new_array(columns, length, 0, {nullptr, table.types.data()}),
+       new_array(columns, length, 0, {nullptr, table.index_offsets.data()},
+                 {new_array(columns, table.index.size(), 0,
+                            {nullptr, table.index.data()})}),
+       new_nullable_array(columns, length, table.integer_validity,
+                          {table.integer.data()}),
+       new_nullable_array(columns, length, table.uinteger_validity,
+                          {table.uinteger.data()}),
+       new_nullable_array(columns, length, table.rate_validity,
+                          {table.delta.data()}),
+       new_nullable_array(columns, length, table.rate_validity,
+                          {table.rate.data()}),
+       new_nullable_array(columns, length, table.octets_validity,
+                          {table.octets_offsets.data(), table.octets.data()})});
+}
+
+} // namespace snmp_stream
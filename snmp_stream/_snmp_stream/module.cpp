@@ -1,5 +1,7 @@
 // snmp_stream/_snmp_stream/module.cpp
 
+#include <cstring>
+
 #include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 #include <pybind11/pybind11.h>
@@ -11,6 +13,7 @@ extern "C" {
 
 #include "session.hpp"
 #include "utils.hpp"
+#include "wireline.hpp"
 
 #define READONLY_PROPERTY(T, field)                                            \
 #field, \
@@ -29,23 +32,221 @@ namespace py = pybind11;
 
 namespace snmp_stream {
 
-[[nodiscard]] auto as_ndarray(std::shared_ptr<std::vector<uint8_t>> const &seq)
-    -> py::array_t<uint8_t> {
-  DB_TRACELOC(0, "ORIG_NDARRAY_USE_COUNT: %d\n", seq.use_count());
+/*!
+  View one segment of a result buffer as a numpy array without copying.  The
+  array keeps the buffer alive; its segments return to the pool once the
+  response and every view are released.
+
+  \return `py::array_t<uint8_t>`
+*/
+[[nodiscard]] auto as_ndarray(std::shared_ptr<ResultBuffer> const &buffer,
+                              size_t index) -> py::array_t<uint8_t> {
+  DB_TRACELOC(0, "ORIG_NDARRAY_USE_COUNT: %d\n", buffer.use_count());
 
-  auto *shared_ptr = new std::shared_ptr<std::vector<uint8_t>>(seq);
+  auto *shared_ptr = new std::shared_ptr<ResultBuffer>(buffer);
 
   auto capsule = py::capsule((void *)shared_ptr, [](void *ptr) {
-    auto *shared_ptr =
-        reinterpret_cast<std::shared_ptr<std::vector<uint8_t>> *>(ptr);
+    auto *shared_ptr = reinterpret_cast<std::shared_ptr<ResultBuffer> *>(ptr);
 
     DB_TRACELOC(0, "DESTORY_NDARRAY_USE_COUNT: %d\n", shared_ptr->use_count());
-    shared_ptr->~shared_ptr();
+    delete shared_ptr;
   });
 
-  DB_TRACELOC(0, "NEW_NDARRAY_USE_COUNT: %d\n", seq.use_count());
+  DB_TRACELOC(0, "NEW_NDARRAY_USE_COUNT: %d\n", buffer.use_count());
+
+  auto [data, size] = buffer->get_segment(index);
+  return py::array(size, data, capsule);
+}
+
+/*!
+  View a result buffer as one numpy array.  A single segment is viewed
+  without copying; multiple segments are concatenated into a new array.
 
-  return py::array(seq->size(), seq->data(), capsule);
+  \return `py::array_t<uint8_t>`
+*/
+[[nodiscard]] auto as_ndarray(std::shared_ptr<ResultBuffer> const &buffer)
+    -> py::array_t<uint8_t> {
+  if (buffer->get_segment_count() == 1) {
+    return as_ndarray(buffer, 0);
+  }
+  py::array_t<uint8_t> array(buffer->get_size());
+  uint8_t *out = array.mutable_data();
+  for (size_t i = 0; i < buffer->get_segment_count(); ++i) {
+    auto [data, size] = buffer->get_segment(i);
+    std::memcpy(out, data, size);
+    out += size;
+  }
+  return array;
+}
+
+/*!
+  View a column of columnar results as a numpy array without copying.  The
+  array keeps the columns alive.
+
+  \return `py::array_t<T>`
+*/
+template <typename T>
+[[nodiscard]] auto as_ndarray(std::shared_ptr<ColumnarResults> const &columns,
+                              std::vector<T> const &column)
+    -> py::array_t<T> {
+  auto *shared_ptr = new std::shared_ptr<ColumnarResults>(columns);
+
+  auto capsule = py::capsule((void *)shared_ptr, [](void *ptr) {
+    delete reinterpret_cast<std::shared_ptr<ColumnarResults> *>(ptr);
+  });
+
+  return py::array_t<T>(column.size(), column.data(), capsule);
+}
+
+/*!
+  View the columns of a root OID as a dictionary of numpy arrays without
+  copying.
+
+  \return `py::dict`
+*/
+[[nodiscard]] auto as_ndarrays(std::shared_ptr<ColumnarResults> const &columns,
+                               size_t root_oid_index) -> py::dict {
+  ColumnTable const &table = columns->get_tables().at(root_oid_index);
+  py::dict arrays;
+  arrays["stamp"] = as_ndarray(columns, table.stamps);
+  arrays["type"] = as_ndarray(columns, table.types);
+  arrays["index_offsets"] = as_ndarray(columns, table.index_offsets);
+  arrays["index"] = as_ndarray(columns, table.index);
+  arrays["integer_validity"] = as_ndarray(columns, table.integer_validity.bits);
+  arrays["integer"] = as_ndarray(columns, table.integer);
+  arrays["uinteger_validity"] =
+      as_ndarray(columns, table.uinteger_validity.bits);
+  arrays["uinteger"] = as_ndarray(columns, table.uinteger);
+  arrays["rate_validity"] = as_ndarray(columns, table.rate_validity.bits);
+  arrays["delta"] = as_ndarray(columns, table.delta);
+  arrays["rate"] = as_ndarray(columns, table.rate);
+  arrays["octets_validity"] = as_ndarray(columns, table.octets_validity.bits);
+  arrays["octets_offsets"] = as_ndarray(columns, table.octets_offsets);
+  arrays["octets"] = as_ndarray(columns, table.octets);
+  return arrays;
+}
+
+/*!
+  View the columns of each root OID as a dictionary of numpy arrays without
+  copying.
+
+  \return `py::list`
+*/
+[[nodiscard]] auto as_ndarrays(std::shared_ptr<ColumnarResults> const &columns)
+    -> py::list {
+  py::list tables;
+  for (size_t i = 0; i < columns->get_tables().size(); ++i) {
+    tables.append(as_ndarrays(columns, i));
+  }
+  return tables;
+}
+
+/*!
+  Convert decoded results to a dictionary with the request ID, the root OIDs
+  and a dictionary of numpy arrays per root OID.  Tables whose rows all have
+  the same index size also get the index as an `index_matrix` of one row per
+  record.  With the response stamps, the receive times of each record are
+  gathered into `realtime_ns` and `monotonic_ns`.
+
+  \return `py::dict`
+*/
+[[nodiscard]] auto
+as_decoded(DecodedResults const &decoded, //!< Decoded results.
+           std::vector<PduStamp> const *stamps //!< Response stamps or
+                                               //!< `nullptr`.
+           ) -> py::dict {
+  py::list tables;
+  for (size_t i = 0; i < decoded.columns->get_tables().size(); ++i) {
+    ColumnTable const &table = decoded.columns->get_tables()[i];
+    py::dict arrays = as_ndarrays(decoded.columns, i);
+
+    // view a fixed-width index as a matrix
+    bool fixed_width = table.length > 0;
+    for (size_t row = 1; fixed_width && row < table.length; ++row) {
+      fixed_width = table.index_offsets[row + 1] - table.index_offsets[row] ==
+                    table.index_offsets[1];
+    }
+    if (fixed_width) {
+      arrays["index_matrix"] = as_ndarray(decoded.columns, table.index)
+                                   .attr("reshape")(table.length,
+                                                    table.index_offsets[1]);
+    }
+
+    // gather the receive times
+    if (stamps != nullptr) {
+      py::array_t<int64_t> realtime_ns(table.length);
+      py::array_t<int64_t> monotonic_ns(table.length);
+      int64_t *realtime = realtime_ns.mutable_data();
+      int64_t *monotonic = monotonic_ns.mutable_data();
+      for (size_t row = 0; row < table.length; ++row) {
+        PduStamp const &stamp = stamps->at(table.stamps[row]);
+        realtime[row] = stamp.get_realtime_ns();
+        monotonic[row] = stamp.get_monotonic_ns();
+      }
+      arrays["realtime_ns"] = realtime_ns;
+      arrays["monotonic_ns"] = monotonic_ns;
+    }
+    tables.append(arrays);
+  }
+
+  py::dict result;
+  result["req_id"] = py::cast(decoded.req_id);
+  result["root_oids"] = py::cast(decoded.root_oids);
+  result["tables"] = tables;
+  return result;
+}
+
+/*!
+  Release an Arrow schema capsule the consumer did not take.
+*/
+static void release_arrow_schema(PyObject *capsule //!< Capsule.
+) {
+  auto *schema = (ArrowSchema *)PyCapsule_GetPointer(capsule, "arrow_schema");
+  if (schema->release != nullptr) {
+    schema->release(schema);
+  }
+  delete schema;
+}
+
+/*!
+  Release an Arrow array capsule the consumer did not take.
+*/
+static void release_arrow_array(PyObject *capsule //!< Capsule.
+) {
+  auto *array = (ArrowArray *)PyCapsule_GetPointer(capsule, "arrow_array");
+  if (array->release != nullptr) {
+    array->release(array);
+  }
+  delete array;
+}
+
+/*!
+  Export the columns of a root OID as Arrow PyCapsules.
+
+  \return `py::tuple`: Schema and array capsules.
+*/
+[[nodiscard]] auto
+as_arrow_capsules(std::shared_ptr<ColumnarResults> const &columns,
+                  size_t root_oid_index) -> py::tuple {
+  auto schema = std::make_unique<ArrowSchema>();
+  auto array = std::make_unique<ArrowArray>();
+  export_arrow(columns, root_oid_index, schema.get(), array.get());
+  auto schema_capsule = py::reinterpret_steal<py::object>(
+      PyCapsule_New(schema.get(), "arrow_schema", release_arrow_schema));
+  if (!schema_capsule) {
+    schema->release(schema.get());
+    array->release(array.get());
+    throw py::error_already_set();
+  }
+  schema.release();
+  auto array_capsule = py::reinterpret_steal<py::object>(
+      PyCapsule_New(array.get(), "arrow_array", release_arrow_array));
+  if (!array_capsule) {
+    array->release(array.get());
+    throw py::error_already_set();
+  }
+  array.release();
+  return py::make_tuple(schema_capsule, array_capsule);
 }
 
 PYBIND11_MODULE(_snmp_stream, m) { // NOLINT
@@ -219,14 +420,37 @@ PYBIND11_MODULE(_snmp_stream, m) { // NOLINT
   py::class_<Config>(m, "Config", "SNMP configuration.")
       .def(py::init<
                std::optional<ssize_t> const &, std::optional<ssize_t> const &,
-               std::optional<size_t> const &, std::optional<size_t> const &>(),
+               std::optional<size_t> const &, std::optional<size_t> const &,
+               std::optional<size_t> const &, std::optional<size_t> const &,
+               std::optional<bool> const &, std::optional<size_t> const &,
+               std::optional<size_t> const &, std::optional<bool> const &,
+               std::optional<bool> const &, std::optional<size_t> const &,
+               std::optional<bool> const &>(),
            py::arg("retries") = std::nullopt, py::arg("timeout") = std::nullopt,
            py::arg("max_response_var_binds_per_pdu") = std::nullopt,
-           py::arg("max_async_sessions") = std::nullopt)
+           py::arg("max_async_sessions") = std::nullopt,
+           py::arg("partial_result_bytes") = std::nullopt,
+           py::arg("partial_result_records") = std::nullopt,
+           py::arg("adaptive_repetitions") = std::nullopt,
+           py::arg("pipeline_depth") = std::nullopt,
+           py::arg("auto_partition") = std::nullopt,
+           py::arg("counter_rates") = std::nullopt,
+           py::arg("columnar") = std::nullopt,
+           py::arg("wireline_version") = std::nullopt,
+           py::arg("shared_memory") = std::nullopt)
       .def_property(READONLY_PROPERTY(Config, retries))
       .def_property(READONLY_PROPERTY(Config, timeout))
       .def_property(READONLY_PROPERTY(Config, max_response_var_binds_per_pdu))
       .def_property(READONLY_PROPERTY(Config, max_async_sessions))
+      .def_property(READONLY_PROPERTY(Config, partial_result_bytes))
+      .def_property(READONLY_PROPERTY(Config, partial_result_records))
+      .def_property(READONLY_PROPERTY(Config, adaptive_repetitions))
+      .def_property(READONLY_PROPERTY(Config, pipeline_depth))
+      .def_property(READONLY_PROPERTY(Config, auto_partition))
+      .def_property(READONLY_PROPERTY(Config, counter_rates))
+      .def_property(READONLY_PROPERTY(Config, columnar))
+      .def_property(READONLY_PROPERTY(Config, wireline_version))
+      .def_property(READONLY_PROPERTY(Config, shared_memory))
       .def(
           "__eq__", [](Config const &a, Config const &b) { return a == b; },
           py::is_operator())
@@ -236,17 +460,48 @@ PYBIND11_MODULE(_snmp_stream, m) { // NOLINT
           [](Config const &config) {
             return py::make_tuple(config.get_retries(), config.get_timeout(),
                                   config.get_max_response_var_binds_per_pdu(),
-                                  config.get_max_async_sessions());
+                                  config.get_max_async_sessions(),
+                                  config.get_partial_result_bytes(),
+                                  config.get_partial_result_records(),
+                                  config.get_adaptive_repetitions(),
+                                  config.get_pipeline_depth(),
+                                  config.get_auto_partition(),
+                                  config.get_counter_rates(),
+                                  config.get_columnar(),
+                                  config.get_wireline_version(),
+                                  config.get_shared_memory());
           },
           [](py::tuple const &t) {
             return (Config){t[0].cast<std::optional<ssize_t>>(),
                             t[1].cast<std::optional<ssize_t>>(),
                             t[2].cast<std::optional<size_t>>(),
-                            t[3].cast<std::optional<size_t>>()};
+                            t[3].cast<std::optional<size_t>>(),
+                            t[4].cast<std::optional<size_t>>(),
+                            t[5].cast<std::optional<size_t>>(),
+                            t[6].cast<std::optional<bool>>(),
+                            t[7].cast<std::optional<size_t>>(),
+                            t[8].cast<std::optional<size_t>>(),
+                            t[9].cast<std::optional<bool>>(),
+                            t[10].cast<std::optional<bool>>(),
+                            t[11].cast<std::optional<size_t>>(),
+                            t[12].cast<std::optional<bool>>()};
           }));
 
   m.def("test_ambiguous_root_oids", &test_ambiguous_root_oids, py::arg("oids"));
 
+  m.def(
+      "decode_results",
+      [](py::array_t<uint8_t, py::array::c_style | py::array::forcecast> const
+             &results) {
+        DecodedResults decoded;
+        {
+          py::gil_scoped_release release;
+          decoded = decode_results({{results.data(), (size_t)results.size()}});
+        }
+        return as_decoded(decoded, nullptr);
+      },
+      py::arg("results"));
+
   py::class_<SnmpRequest> snmp_request(m, "SnmpRequest", "SNMP request.");
 
   snmp_request
@@ -363,15 +618,60 @@ PYBIND11_MODULE(_snmp_stream, m) { // NOLINT
       .value("CREATE_RESPONSE_PDU_ERROR",
              SnmpError::SnmpErrorType::CREATE_RESPONSE_PDU_ERROR)
       .value("VALUE_WARNING", SnmpError::SnmpErrorType::VALUE_WARNING)
+      .value("SINK_ERROR", SnmpError::SnmpErrorType::SINK_ERROR)
       .export_values();
 
+  py::class_<PduStamp>(m, "PduStamp", "Response PDU receive stamp.")
+      .def(py::init<int64_t, int64_t, int64_t>(), py::arg("realtime_ns"),
+           py::arg("monotonic_ns"), py::arg("rtt_ns"))
+      .def_property(READONLY_PROPERTY(PduStamp, realtime_ns))
+      .def_property(READONLY_PROPERTY(PduStamp, monotonic_ns))
+      .def_property(READONLY_PROPERTY(PduStamp, rtt_ns))
+      .def(
+          "__eq__", [](PduStamp const &a, PduStamp const &b) { return a == b; },
+          py::is_operator())
+      .def("__str__", [](PduStamp const &stamp) { return stamp.repr(); })
+      .def("__repr__", [](PduStamp const &stamp) { return stamp.repr(); })
+      .def(py::pickle(
+          [](PduStamp const &stamp) {
+            return py::make_tuple(stamp.get_realtime_ns(),
+                                  stamp.get_monotonic_ns(), stamp.get_rtt_ns());
+          },
+          [](py::tuple const &t) {
+            return (PduStamp){t[0].cast<int64_t>(), t[1].cast<int64_t>(),
+                              t[2].cast<int64_t>()};
+          }));
+
   py::class_<SnmpResponse> snmp_response(m, "SnmpResponse", "SNMP response.");
 
   snmp_response
-      .def(py::init<SnmpResponse::SnmpResponseType, SnmpRequest const &,
-                    std::vector<uint8_t>, std::vector<SnmpError>>(),
+      .def(py::init([](SnmpResponse::SnmpResponseType type,
+                       SnmpRequest const &request,
+                       std::vector<uint8_t> const &results,
+                       std::vector<SnmpError> const &errors,
+                       std::vector<PduStamp> const &stamps,
+                       std::vector<uint8_t> const &columns,
+                       bool shared_memory) {
+             if (!shared_memory) {
+               return SnmpResponse(type, request, results, errors, stamps,
+                                   columns);
+             }
+             // copy the results into shared memory the way a session with
+             // `shared_memory` collects them
+             auto buffer = std::make_shared<ResultBuffer>(nullptr, true);
+             if (!results.empty()) {
+               std::memcpy(buffer->append(results.size()), results.data(),
+                           results.size());
+             }
+             return SnmpResponse(
+                 type, request, buffer, errors, stamps,
+                 columns.empty() ? nullptr
+                                 : std::make_shared<ColumnarResults>(columns));
+           }),
            py::arg("type"), py::arg("request"), py::arg("results"),
-           py::arg("errors"))
+           py::arg("errors"), py::arg("stamps") = std::vector<PduStamp>(),
+           py::arg("columns") = std::vector<uint8_t>(),
+           py::arg("shared_memory") = false)
       .def_property(READONLY_PROPERTY(SnmpResponse, type))
       .def_property(READONLY_PROPERTY(SnmpResponse, request))
       .def_property(
@@ -383,7 +683,60 @@ PYBIND11_MODULE(_snmp_stream, m) { // NOLINT
                                         py::repr(val).cast<std::string>() +
                                         " to " + obj.repr());
           })
+      .def_property(
+          "segments",
+          [](SnmpResponse const &obj) {
+            py::list segments;
+            for (size_t i = 0; i < obj.get_results()->get_segment_count();
+                 ++i) {
+              segments.append(as_ndarray(obj.get_results(), i));
+            }
+            return segments;
+          },
+          [](SnmpResponse const &obj, py::list &val) {
+            throw std::invalid_argument("SnmpResponse is read-only: "
+                                        "failed to assign segments=" +
+                                        py::repr(val).cast<std::string>() +
+                                        " to " + obj.repr());
+          })
       .def_property(READONLY_PROPERTY(SnmpResponse, errors))
+      .def_property(READONLY_PROPERTY(SnmpResponse, stamps))
+      .def_property(
+          "columns",
+          [](SnmpResponse const &obj) -> py::object {
+            if (obj.get_columns() == nullptr) {
+              return py::none();
+            }
+            return as_ndarrays(obj.get_columns());
+          },
+          [](SnmpResponse const &obj, py::object &val) {
+            throw std::invalid_argument("SnmpResponse is read-only: "
+                                        "failed to assign columns=" +
+                                        py::repr(val).cast<std::string>() +
+                                        " to " + obj.repr());
+          })
+      .def("decode",
+           [](SnmpResponse const &obj) {
+             DecodedResults decoded;
+             {
+               py::gil_scoped_release release;
+               decoded = decode_results(*obj.get_results());
+             }
+             if (obj.get_columns() != nullptr) {
+               decoded.columns = obj.get_columns();
+             }
+             return as_decoded(decoded, &obj.get_stamps());
+           })
+      .def(
+          "arrow_c_array",
+          [](SnmpResponse const &obj, size_t root_oid_index) {
+            if (obj.get_columns() == nullptr) {
+              throw std::invalid_argument(
+                  "SnmpResponse has no columnar results: " + obj.repr());
+            }
+            return as_arrow_capsules(obj.get_columns(), root_oid_index);
+          },
+          py::arg("root_oid_index"))
       .def(
           "__eq__",
           [](SnmpResponse const &a, SnmpResponse const &b) { return a == b; },
@@ -394,16 +747,42 @@ PYBIND11_MODULE(_snmp_stream, m) { // NOLINT
            [](SnmpResponse const &response) { return response.repr(); })
       .def(py::pickle(
           [](SnmpResponse const &response) {
-            return py::make_tuple(response.get_type(), response.get_request(),
-                                  *response.get_results(),
-                                  response.get_errors());
+            // shared memory results only carry the segment names
+            auto const &results = response.get_results();
+            bool hand_off = results->can_hand_off();
+            return py::make_tuple(
+                response.get_type(), response.get_request(),
+                hand_off ? std::vector<uint8_t>() : results->to_vector(),
+                response.get_errors(), response.get_stamps(),
+                response.get_columns() != nullptr
+                    ? response.get_columns()->to_vector()
+                    : std::vector<uint8_t>(),
+                hand_off ? results->hand_off()
+                         : std::vector<std::pair<std::string, size_t>>());
           },
           [](py::tuple const &t) {
-            return (SnmpResponse){t[0].cast<SnmpResponse::SnmpResponseType>(),
-                                  t[1].cast<SnmpRequest>(),
-                                  std::make_shared<std::vector<uint8_t>>(
-                                      t[2].cast<std::vector<uint8_t>>()),
-                                  t[3].cast<std::vector<SnmpError>>()};
+            auto handles =
+                t.size() > 6
+                    ? t[6].cast<std::vector<std::pair<std::string, size_t>>>()
+                    : std::vector<std::pair<std::string, size_t>>();
+            if (handles.empty()) {
+              return (SnmpResponse){
+                  t[0].cast<SnmpResponse::SnmpResponseType>(),
+                  t[1].cast<SnmpRequest>(),
+                  t[2].cast<std::vector<uint8_t>>(),
+                  t[3].cast<std::vector<SnmpError>>(),
+                  t[4].cast<std::vector<PduStamp>>(),
+                  t[5].cast<std::vector<uint8_t>>()};
+            }
+            auto columns = t[5].cast<std::vector<uint8_t>>();
+            return (SnmpResponse){
+                t[0].cast<SnmpResponse::SnmpResponseType>(),
+                t[1].cast<SnmpRequest>(),
+                std::make_shared<ResultBuffer>(handles),
+                t[3].cast<std::vector<SnmpError>>(),
+                t[4].cast<std::vector<PduStamp>>(),
+                columns.empty() ? nullptr
+                                : std::make_shared<ColumnarResults>(columns)};
           }));
 
   py::enum_<SnmpResponse::SnmpResponseType>(snmp_response, "SnmpResponseType",
@@ -412,13 +791,148 @@ PYBIND11_MODULE(_snmp_stream, m) { // NOLINT
       .value("DONE_WITH_ERRORS",
              SnmpResponse::SnmpResponseType::DONE_WITH_ERRORS)
       .value("FAILED", SnmpResponse::SnmpResponseType::FAILED)
+      .value("PARTIAL", SnmpResponse::SnmpResponseType::PARTIAL)
+      .export_values();
+
+  py::class_<IoStats>(m, "IoStats", "Shared transport I/O counters.")
+      .def(py::init<size_t, size_t, size_t, size_t, size_t, size_t>(),
+           py::arg("send_calls") = 0, py::arg("sent_datagrams") = 0,
+           py::arg("max_send_batch") = 0, py::arg("recv_calls") = 0,
+           py::arg("received_datagrams") = 0, py::arg("max_recv_batch") = 0)
+      .def_property(READONLY_PROPERTY(IoStats, send_calls))
+      .def_property(READONLY_PROPERTY(IoStats, sent_datagrams))
+      .def_property(READONLY_PROPERTY(IoStats, max_send_batch))
+      .def_property(READONLY_PROPERTY(IoStats, recv_calls))
+      .def_property(READONLY_PROPERTY(IoStats, received_datagrams))
+      .def_property(READONLY_PROPERTY(IoStats, max_recv_batch))
+      .def(
+          "__eq__", [](IoStats const &a, IoStats const &b) { return a == b; },
+          py::is_operator())
+      .def("__str__", [](IoStats const &stats) { return stats.repr(); })
+      .def("__repr__", [](IoStats const &stats) { return stats.repr(); })
+      .def(py::pickle(
+          [](IoStats const &stats) {
+            return py::make_tuple(
+                stats.get_send_calls(), stats.get_sent_datagrams(),
+                stats.get_max_send_batch(), stats.get_recv_calls(),
+                stats.get_received_datagrams(), stats.get_max_recv_batch());
+          },
+          [](py::tuple const &t) {
+            return (IoStats){t[0].cast<size_t>(), t[1].cast<size_t>(),
+                             t[2].cast<size_t>(), t[3].cast<size_t>(),
+                             t[4].cast<size_t>(), t[5].cast<size_t>()};
+          }));
+
+  py::class_<CounterRates>(m, "CounterRates",
+                           "Counter samples of a single host, as kept by the "
+                           "session manager for `counter_rates`.")
+      .def(py::init<>())
+      .def(
+          "sample",
+          [](CounterRates &rates, ObjectIdentity const &oid, uint8_t type,
+             uint64_t value, int64_t monotonic_ns)
+              -> std::optional<std::tuple<uint64_t, uint64_t, double>> {
+            u_long uinteger = value & 0xffffffff;
+            counter64 counter;
+            counter.high = value >> 32;
+            counter.low = value & 0xffffffff;
+            VarBind var_bind = {oid.data(), oid.size(), type, &uinteger,
+                                sizeof(uinteger), 1};
+            if (type == BER_COUNTER64) {
+              var_bind.value = &counter;
+              var_bind.value_length = sizeof(counter);
+            }
+            auto rate = rates.sample(var_bind, monotonic_ns);
+            if (!rate.has_value()) {
+              return std::nullopt;
+            }
+            return std::make_tuple(rate->value, rate->delta, rate->rate);
+          },
+          py::arg("oid"), py::arg("type"), py::arg("value"),
+          py::arg("monotonic_ns"),
+          "Sample a TimeTicks, Counter32 or Counter64 value received at "
+          "`monotonic_ns`, returning its value, delta and rate or `None`.");
+
+  py::class_<ResultSink, std::shared_ptr<ResultSink>>(
+      m, "ResultSink", "Destination of wireline results.");
+
+  py::class_<MemoryResultSink, ResultSink, std::shared_ptr<MemoryResultSink>>(
+      m, "MemoryResultSink",
+      "Result sink keeping the results in memory until they are taken.")
+      .def(py::init<>())
+      .def("take", [](MemoryResultSink &sink) {
+        py::list buffers;
+        for (auto &&buffer : sink.take()) {
+          buffers.append(as_ndarray(buffer));
+        }
+        return buffers;
+      });
+
+  py::class_<FdResultSink, ResultSink, std::shared_ptr<FdResultSink>>(
+      m, "FdResultSink",
+      "Result sink writing size framed results to a file descriptor.")
+      .def(py::init<int, size_t>(), py::arg("fd"),
+           py::arg("batch_bytes") = DEFAULT_SINK_BATCH_BYTES)
+      .def("flush", &FdResultSink::flush,
+           py::call_guard<py::gil_scoped_release>());
+
+  py::class_<CallbackResultSink, ResultSink,
+             std::shared_ptr<CallbackResultSink>>(
+      m, "CallbackResultSink",
+      "Result sink calling a function with the results.")
+      .def(py::init([](py::function const &callback) {
+             // held without the GIL by the workers, so released under it
+             auto function = std::shared_ptr<py::function>(
+                 new py::function(callback), [](py::function *function) {
+                   py::gil_scoped_acquire acquire;
+                   delete function;
+                 });
+             return std::make_shared<CallbackResultSink>(
+                 [function](std::shared_ptr<ResultBuffer> const &results) {
+                   py::gil_scoped_acquire acquire;
+                   try {
+                     (*function)(as_ndarray(results));
+                   } catch (py::error_already_set &e) {
+                     throw std::runtime_error(e.what());
+                   }
+                 });
+           }),
+           py::arg("callback"));
+
+  py::class_<SessionManager> session_manager(m, "SessionManager",
+                                            "SNMP session manager");
+
+  py::enum_<SessionManager::MissedDeadlinePolicy>(
+      session_manager, "MissedDeadlinePolicy",
+      "Recurring job missed deadline policies.")
+      .value("SKIP", SessionManager::MissedDeadlinePolicy::SKIP)
+      .value("DEFER", SessionManager::MissedDeadlinePolicy::DEFER)
+      .value("OVERLAP", SessionManager::MissedDeadlinePolicy::OVERLAP)
       .export_values();
 
-  py::class_<SessionManager>(m, "SessionManager", "SNMP session manager")
-      .def(py::init<std::optional<Config> const &>(),
-           py::arg("config") = std::nullopt)
+  session_manager
+      .def(py::init<std::optional<Config> const &, size_t, size_t, size_t,
+                    size_t, size_t, double, size_t, size_t,
+                    std::shared_ptr<ResultSink>>(),
+           py::arg("config") = std::nullopt, py::arg("shared_sockets") = 0,
+           py::arg("io_batch_size") = 0, py::arg("threads") = 0,
+           py::arg("result_segment_bytes") = DEFAULT_RESULT_SEGMENT_BYTES,
+           py::arg("max_host_sessions") = 0,
+           py::arg("max_host_pdus_per_second") = 0.0,
+           py::arg("ipv4_prefix_length") = 32,
+           py::arg("ipv6_prefix_length") = 128,
+           py::arg("sink") = nullptr)
       .def("add_request", &SessionManager::add_request)
-      .def("run", &SessionManager::run);
+      .def("add_job", &SessionManager::add_job, py::arg("request"),
+           py::arg("interval"), py::arg("phase_jitter") = 1.0,
+           py::arg("missed_deadline") = SessionManager::SKIP)
+      .def("remove_job", &SessionManager::remove_job)
+      .def("get_jobs_count", &SessionManager::get_jobs_count)
+      .def("get_io_stats", &SessionManager::get_io_stats)
+      .def("run", &SessionManager::run)
+      .def("step", &SessionManager::step)
+      .def("get_fd", &SessionManager::get_fd)
+      .def("get_timeout", &SessionManager::get_timeout);
 }
 
 } // namespace snmp_stream
@@ -0,0 +1,126 @@
+// snmp_stream/_snmp_stream/rates.cpp
+
+#include <algorithm>
+#include <cinttypes>
+#include <iterator>
+
+extern "C" {
+#include <debug.h>
+}
+
+#include "rates.hpp"
+
+namespace snmp_stream {
+
+// sysUpTime.0
+static oid_t const SYS_UP_TIME[] = {1, 3, 6, 1, 2, 1, 1, 3, 0};
+
+/*!
+  Hash an OID (64-bit FNV-1a over the sub-identifiers).
+
+  \return `uint64_t`
+*/
+[[nodiscard]] static auto hash_oid(oid_t const *name, //!< OID.
+                                   size_t length      //!< Sub-identifiers.
+                                   ) -> uint64_t {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; ++i) {
+    hash = (hash ^ (uint64_t)name[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+CounterRates::CounterRates() : uptime_monotonic_ns(0) {}
+
+void CounterRates::sample_uptime(uint32_t ticks, int64_t monotonic_ns) {
+  if (uptime.has_value() && monotonic_ns > uptime_monotonic_ns) {
+    // TimeTicks wrap after 497 days; going backwards shows as a huge advance
+    uint32_t advanced = ticks - *uptime;
+    int64_t elapsed = (monotonic_ns - uptime_monotonic_ns) / 10000000;
+    if ((int64_t)advanced > elapsed + elapsed / 10 + 100) {
+      DB_TRACELOC(0, "COUNTER_RATES_RESTART: %u -> %u\n", *uptime, ticks);
+      samples.clear();
+    }
+  }
+  uptime = ticks;
+  uptime_monotonic_ns = monotonic_ns;
+}
+
+auto CounterRates::sample(VarBind const &var_bind, int64_t monotonic_ns)
+    -> std::optional<CounterRate> {
+  std::lock_guard<std::mutex> guard(mutex);
+
+  uint64_t value;
+  switch (var_bind.type) {
+  case BER_TIMETICKS:
+    if (var_bind.value_length == sizeof(u_long) &&
+        var_bind.name_length == std::size(SYS_UP_TIME) &&
+        std::equal(var_bind.name, var_bind.name + var_bind.name_length,
+                   SYS_UP_TIME)) {
+      sample_uptime((uint32_t) * (u_long const *)var_bind.value, monotonic_ns);
+    }
+    return std::nullopt;
+  case BER_COUNTER32:
+    if (var_bind.value_length != sizeof(u_long)) {
+      return std::nullopt;
+    }
+    value = *(u_long const *)var_bind.value & 0xffffffff;
+    break;
+  case BER_COUNTER64: {
+    if (var_bind.value_length != sizeof(counter64)) {
+      return std::nullopt;
+    }
+    auto const *counter = (counter64 const *)var_bind.value;
+    value = ((uint64_t)(counter->high & 0xffffffff) << 32) |
+            (uint64_t)(counter->low & 0xffffffff);
+    break;
+  }
+  default:
+    return std::nullopt;
+  }
+
+  auto [it, inserted] =
+      samples.try_emplace(hash_oid(var_bind.name, var_bind.name_length));
+  Sample &previous = it->second;
+  bool same_oid = !inserted &&
+                  previous.oid.size() == var_bind.name_length &&
+                  std::equal(previous.oid.begin(), previous.oid.end(),
+                             var_bind.name);
+
+  std::optional<CounterRate> rate;
+  if (same_oid && previous.type == var_bind.type) {
+    if (monotonic_ns <= previous.monotonic_ns) {
+      // sampled again from the same response PDU
+      return std::nullopt;
+    }
+    double elapsed = (double)(monotonic_ns - previous.monotonic_ns) / 1e9;
+    if (value >= previous.value) {
+      uint64_t delta = value - previous.value;
+      rate = CounterRate{value, delta, (double)delta / elapsed};
+    } else if (var_bind.type == BER_COUNTER32) {
+      // unsigned arithmetic unwraps one wrap; an agent restart is caught by
+      // sysUpTime.0, so only a rate no interface reaches marks a reset
+      uint64_t delta = (uint32_t)(value - previous.value);
+      if ((double)delta / elapsed <= COUNTER32_MAX_WRAP_RATE) {
+        rate = CounterRate{value, delta, (double)delta / elapsed};
+      } else {
+        DB_TRACELOC(0, "COUNTER_RATES_RESET: %" PRIu64 " -> %" PRIu64 "\n",
+                    previous.value, value);
+      }
+    } else {
+      // a Counter64 does not wrap in practice, so it was reset
+      DB_TRACELOC(0, "COUNTER_RATES_RESET: %" PRIu64 " -> %" PRIu64 "\n",
+                  previous.value, value);
+    }
+  }
+
+  if (!same_oid) {
+    previous.oid.assign(var_bind.name, var_bind.name + var_bind.name_length);
+  }
+  previous.type = var_bind.type;
+  previous.value = value;
+  previous.monotonic_ns = monotonic_ns;
+  return rate;
+}
+
+} // namespace snmp_stream
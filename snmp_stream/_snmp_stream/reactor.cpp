@@ -0,0 +1,91 @@
+// snmp_stream/_snmp_stream/reactor.cpp
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+extern "C" {
+#include <debug.h>
+}
+
+#include "reactor.hpp"
+
+namespace snmp_stream {
+
+Reactor::Reactor() : epoll_fd(epoll_create1(EPOLL_CLOEXEC)), registered(0) {
+  if (epoll_fd < 0) {
+    throw std::runtime_error("failed to create epoll instance: " +
+                             std::string(std::strerror(errno)));
+  }
+  DB_TRACELOC(0, "REACTOR_CREATE: %d\n", epoll_fd);
+}
+
+Reactor::~Reactor() {
+  DB_TRACELOC(0, "REACTOR_DESTROY: %d\n", epoll_fd);
+  close(epoll_fd);
+}
+
+void Reactor::add(int fd, void *data) {
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = data;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+    throw std::runtime_error("failed to register file descriptor " +
+                             std::to_string(fd) + ": " +
+                             std::string(std::strerror(errno)));
+  }
+  registered++;
+  DB_TRACELOC(0, "REACTOR_ADD: %d (%zu)\n", fd, registered);
+}
+
+void Reactor::watch_writable(int fd, void *data, bool writable) {
+  epoll_event event{};
+  event.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  event.data.ptr = data;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) != 0) {
+    throw std::runtime_error("failed to modify file descriptor " +
+                             std::to_string(fd) + ": " +
+                             std::string(std::strerror(errno)));
+  }
+  DB_TRACELOC(0, "REACTOR_WATCH_WRITABLE: %d (%d)\n", fd, (int)writable);
+}
+
+void Reactor::remove(int fd) {
+  // a closed descriptor is implicitly removed from the epoll set
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr) == 0) {
+    registered--;
+  }
+  DB_TRACELOC(0, "REACTOR_REMOVE: %d (%zu)\n", fd, registered);
+}
+
+auto Reactor::wait(
+    std::optional<std::chrono::steady_clock::time_point> const &deadline)
+    -> size_t {
+  // round up so a deadline is never reported early
+  int timeout = -1;
+  if (deadline.has_value()) {
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+        *deadline - std::chrono::steady_clock::now());
+    timeout = (int)std::max<int64_t>(remaining.count(), 0);
+  }
+
+  events.resize(std::max<size_t>(registered, 1));
+
+  int count = epoll_wait(epoll_fd, events.data(), (int)events.size(), timeout);
+  DB_TRACELOC(0, "REACTOR_WAIT: %d ms -> %d\n", timeout, count);
+
+  if (count < 0) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    throw std::runtime_error("failed to wait on epoll instance: " +
+                             std::string(std::strerror(errno)));
+  }
+  return (size_t)count;
+}
+
+} // namespace snmp_stream
@@ -0,0 +1,38 @@
+// snmp_stream/_snmp_stream/rtt.cpp
+
+#include <algorithm>
+
+#include "rtt.hpp"
+
+namespace snmp_stream {
+
+RttEstimator::RttEstimator() : srtt(0), rttvar(0), samples(0) {}
+
+void RttEstimator::sample(std::chrono::nanoseconds rtt) {
+  if (samples++ == 0) {
+    srtt = rtt;
+    rttvar = rtt / 2;
+    return;
+  }
+  // rttvar = 3/4 rttvar + 1/4 |srtt - rtt|, srtt = 7/8 srtt + 1/8 rtt
+  auto delta = srtt > rtt ? srtt - rtt : rtt - srtt;
+  rttvar = (3 * rttvar + delta) / 4;
+  srtt = (7 * srtt + rtt) / 8;
+}
+
+auto RttEstimator::get_retransmit_timeout(std::chrono::nanoseconds max_timeout,
+                                          size_t retransmits) const
+    -> std::chrono::nanoseconds {
+  if (samples == 0) {
+    return max_timeout;
+  }
+  auto rto = std::max<std::chrono::nanoseconds>(
+      srtt + 4 * rttvar, std::chrono::milliseconds(MIN_RETRANSMIT_TIMEOUT_MS));
+  // exponential backoff, stopping once the configured timeout is reached
+  for (size_t i = 0; i < retransmits && rto < max_timeout; i++) {
+    rto *= 2;
+  }
+  return std::min(rto, max_timeout);
+}
+
+} // namespace snmp_stream
@@ -0,0 +1,85 @@
+// snmp_stream/_snmp_stream/scheduler.cpp
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <stdexcept>
+
+#include "scheduler.hpp"
+
+namespace snmp_stream {
+
+/*!
+  Zero the bits of an address past a prefix length.
+*/
+static void mask_address(unsigned char *address, //!< Address bytes.
+                         size_t size,            //!< Size of the address.
+                         size_t prefix_length    //!< Prefix length in bits.
+) {
+  for (size_t i = 0; i < size; ++i) {
+    size_t bits = std::min<size_t>(
+        8, prefix_length > i * 8 ? prefix_length - i * 8 : 0);
+    address[i] &= (unsigned char)(0xff00 >> bits);
+  }
+}
+
+auto get_host_key(std::string const &host, size_t ipv4_prefix_length,
+                  size_t ipv6_prefix_length) -> std::string {
+  std::string name = host;
+  if (name.rfind("udp6:", 0) == 0) {
+    name = name.substr(5);
+  } else if (name.rfind("udp:", 0) == 0) {
+    name = name.substr(4);
+  }
+
+  // drop the port the same way the peer is resolved
+  if (!name.empty() && name[0] == '[') {
+    name = name.substr(1, name.find(']') - 1);
+  } else if (std::count(name.begin(), name.end(), ':') == 1) {
+    name = name.substr(0, name.find(':'));
+  }
+
+  unsigned char address[sizeof(in6_addr)];
+  char text[INET6_ADDRSTRLEN];
+  if (inet_pton(AF_INET, name.c_str(), address) == 1) {
+    mask_address(address, sizeof(in_addr),
+                 std::min<size_t>(ipv4_prefix_length, 32));
+    inet_ntop(AF_INET, address, text, sizeof(text));
+    return std::string(text) + "/" +
+           std::to_string(std::min<size_t>(ipv4_prefix_length, 32));
+  }
+  if (inet_pton(AF_INET6, name.c_str(), address) == 1) {
+    mask_address(address, sizeof(in6_addr),
+                 std::min<size_t>(ipv6_prefix_length, 128));
+    inet_ntop(AF_INET6, address, text, sizeof(text));
+    return std::string(text) + "/" +
+           std::to_string(std::min<size_t>(ipv6_prefix_length, 128));
+  }
+  return name;
+}
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate(rate), burst(std::max(burst, 1.0)), tokens(this->burst),
+      updated(std::chrono::steady_clock::now()) {
+  if (!(rate > 0)) {
+    throw std::invalid_argument("rate must be greater than 0");
+  }
+}
+
+auto TokenBucket::take(std::chrono::steady_clock::time_point now)
+    -> std::optional<std::chrono::steady_clock::time_point> {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (now > updated) {
+    tokens = std::min(
+        burst,
+        tokens + std::chrono::duration<double>(now - updated).count() * rate);
+    updated = now;
+  }
+  if (tokens >= 1) {
+    tokens -= 1;
+    return std::nullopt;
+  }
+  return updated + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::duration<double>((1 - tokens) / rate));
+}
+
+} // namespace snmp_stream
@@ -6,42 +6,32 @@
 #include <cinttypes>
 #include <cmath>
 #include <cstring>
+#include <iterator>
 #include <map>
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 extern "C" {
 #include <debug.h>
 }
 
 #include "session.hpp"
 #include "utils.hpp"
+#include "wireline.hpp"
 
-// macro to align to system
-#define SYS_ALIGN(x) (((x) + (sizeof(size_t) - 1)) & ~(sizeof(size_t) - 1))
-
-#define HEADER_BYTES 16
+// upper bound on the adaptive variable bindings per GETBULK response
+#define MAX_ADAPTIVE_VAR_BINDS_PER_PDU 1024
 
 namespace py = pybind11;
 
 namespace snmp_stream {
 
-enum class endian {
-#ifdef _WIN32
-  little = 0,
-  big = 1,
-  native = little
-#else
-  little = __ORDER_LITTLE_ENDIAN__,
-  big = __ORDER_BIG_ENDIAN__,
-  native = __BYTE_ORDER__
-#endif
-};
-
 CollectionHead::CollectionHead(size_t root_oid_index, ObjectIdentity root_oid,
-                               std::optional<ObjectIdentityRange> const &range,
-                               std::shared_ptr<std::vector<uint8_t>> results)
+                               std::optional<ObjectIdentityRange> const &range)
     : root_oid_index(root_oid_index), root_oid(std::move(root_oid)),
-      req_oid(std::nullopt), last_resp_oid(std::nullopt),
-      results(std::move(results)) {
+      req_oid(std::nullopt), last_resp_oid(std::nullopt), completed(false),
+      pdu_slot(0), retries_left(std::nullopt) {
   ObjectIdentity start = this->root_oid;
   ObjectIdentity stop = this->root_oid;
   if (range.has_value()) {
@@ -55,68 +45,37 @@ CollectionHead::CollectionHead(size_t root_oid_index, ObjectIdentity root_oid,
               attr_to_string(this->range).c_str());
 }
 
-void CollectionHead::append_result(variable_list const &resp_var_bind) {
-  // get a timestamp for the response
-  time_t timestamp;
-  time(&timestamp);
-
-  size_t index_size = resp_var_bind.name_length - root_oid.size();
-  size_t resp_var_bind_size = (
-      // timestamp
-      SYS_ALIGN(sizeof(timestamp)) +
-      // root oid index
-      SYS_ALIGN(sizeof(root_oid_index)) +
-      // value type
-      SYS_ALIGN(sizeof(resp_var_bind.type)) +
-      // index size
-      SYS_ALIGN(sizeof(index_size)) +
-      // index
-      SYS_ALIGN(index_size * sizeof(oid_t)) +
-      // value size
-      SYS_ALIGN(sizeof(resp_var_bind.val_len)) +
-      // value
-      SYS_ALIGN(resp_var_bind.val_len));
-
-  // resize the array
-  size_t pos = results->size();
-  results->resize(results->size() + SYS_ALIGN(sizeof(resp_var_bind_size)) +
-                  resp_var_bind_size);
-
-  // copy the variable binding size
-  std::memcpy(&(*results)[pos], &resp_var_bind_size,
-              sizeof(resp_var_bind_size));
-
-  // copy the timestamp
-  std::memcpy(&(*results)[pos += SYS_ALIGN(sizeof(resp_var_bind_size))],
-              &timestamp, sizeof(timestamp));
-
-  // copy the root oid index
-  std::memcpy(&(*results)[pos += SYS_ALIGN(sizeof(timestamp))], &root_oid_index,
-              sizeof(root_oid_index));
-
-  // copy the value type
-  std::memcpy(&(*results)[pos += SYS_ALIGN(sizeof(root_oid_index))],
-              &resp_var_bind.type, sizeof(resp_var_bind.type));
-
-  // copy the index size
-  std::memcpy(&(*results)[pos += SYS_ALIGN(sizeof(resp_var_bind.type))],
-              &index_size, sizeof(index_size));
-
-  // copy the index
-  std::memcpy(&(*results)[pos += SYS_ALIGN(sizeof(index_size))],
-              resp_var_bind.name + root_oid.size(), index_size * sizeof(oid_t));
-
-  // copy the value_size
-  std::memcpy(&(*results)[pos += SYS_ALIGN(index_size * sizeof(oid_t))],
-              &resp_var_bind.val_len, sizeof(resp_var_bind.val_len));
-
-  // copy the value
-  std::memcpy(&(*results)[pos += SYS_ALIGN(sizeof(resp_var_bind.val_len))],
-              resp_var_bind.val.bitstring, resp_var_bind.val_len);
-}
-
-void Session::process_var_bind(variable_list const &resp_var_bind,
-                               Session &session) {
+void CollectionHead::append_result(ResultBuffer &results,
+                                   VarBind const &resp_var_bind,
+                                   size_t stamp_index, uint8_t version,
+                                   std::vector<oid_t> &previous_index) {
+  append_record(results, version, stamp_index, root_oid_index,
+                root_oid.size(), resp_var_bind, previous_index);
+}
+
+void CollectionHead::append_result(ColumnarResults &columns,
+                                   VarBind const &resp_var_bind,
+                                   size_t stamp_index) {
+  columns.append(root_oid_index, resp_var_bind.name + root_oid.size(),
+                 resp_var_bind.name_length - root_oid.size(),
+                 resp_var_bind.type, resp_var_bind.value,
+                 resp_var_bind.value_length, stamp_index);
+}
+
+/*!
+  View a NET-SNMP variable binding as a `VarBind`.
+
+  \return `VarBind`
+*/
+[[nodiscard]] static auto to_var_bind(variable_list const &var_bind)
+    -> VarBind {
+  return (VarBind){var_bind.name,       var_bind.name_length,
+                   var_bind.type,       var_bind.val.bitstring,
+                   var_bind.val_len,    (size_t)var_bind.index};
+}
+
+void Session::process_var_bind(VarBind const &resp_var_bind,
+                               Session &session, size_t slot) {
   static std::map<uint8_t, std::string> WARNING_VALUE_TYPES = {
       {NO_SUCH_OBJECT, "NO_SUCH_OBJECT"},
       {NO_SUCH_INSTANCE, "NO_SUCH_INSTANCE"},
@@ -131,33 +90,13 @@ void Session::process_var_bind(variable_list const &resp_var_bind,
   // Find the collection node for this variable binding.  Note: This is the
   // reason why a request OID cannot be a root of another request OID (ambiguous
   // root OID).
-  auto request_type = session.request.get_type();
-  auto it = std::find_if(
-      session.collection_heads.begin(), session.collection_heads.end(),
-      [&request_type,
-       &resp_oid](std::unique_ptr<CollectionHead> const &collection_head) {
-        // skip if collection head was not active for this PDU
-        if (!collection_head->get_req_oid().has_value()) {
-          return false;
-        }
-        if (request_type == SnmpRequest::GET_REQUEST) {
-          // for a GET_REQUEST, OID must match the range point
-          return collection_head->get_range().get_start() == resp_oid;
-        }
-        // for a WALK_REQUEST, OID must be between the range inclusive or stop
-        // must be a root of the OID
-        if (resp_oid >= collection_head->get_range().get_start() &&
-            resp_oid <= collection_head->get_range().get_stop()) {
-          return true;
-        }
-        return collection_head->get_range().get_stop().is_root_of(resp_oid);
-      });
+  CollectionHead *head = session.find_collection_head(resp_oid, slot);
 
   switch (session.request.get_type()) {
   case SnmpRequest::GET_REQUEST:
     // If no root OID is found, discard the variable binding and generate an
     // error. This should never happen in a GET request.
-    if (it == session.collection_heads.end()) {
+    if (head == nullptr) {
       session.append_error(SnmpError::VALUE_WARNING, {}, {}, {},
                            resp_var_bind.index, resp_oid, "root OID not found");
       DB_TRACELOC(0, "SESSION_PROCESS_VAR_BIND_ROOT_OID_NOT_FOUND: %s\n",
@@ -169,11 +108,11 @@ void Session::process_var_bind(variable_list const &resp_var_bind,
     // If the response OID does not match the request OID, discard the
     // variable binding and generate an error. This should never happen in a
     // GET request.
-    if (resp_oid != *(*it)->get_req_oid()) {
+    if (resp_oid != *head->get_req_oid()) {
       session.append_error(SnmpError::VALUE_WARNING, {}, {}, {},
                            resp_var_bind.index, resp_oid,
                            "request OID does not match response OID: " +
-                               oid_to_string(*(*it)->get_req_oid()));
+                               oid_to_string(*head->get_req_oid()));
       DB_TRACELOC(0, "SESSION_PROCESS_VAR_BIND_GET_RESP_NOT_MATCH_REQ: %s\n",
                   session.errors.back().repr().c_str());
       session.err_flag = true;
@@ -197,37 +136,59 @@ void Session::process_var_bind(variable_list const &resp_var_bind,
     // If no root OID is found, silently discard the variable binding.  Likely
     // cause for collecting this response is an overrun on a walk from another
     // root OID.
-    if (it == session.collection_heads.end()) {
+    if (head == nullptr) {
       return;
     }
 
-    if ((*it)->get_last_resp_oid().has_value()) {
+    if (head->get_last_resp_oid().has_value()) {
       // If the response OID is lexicographically less than or equal to the
       // last response OID, discard the response.  Likely cause for collecting
       // this response is an overrun on a walk from another root OID.
-      if (resp_oid <= *(*it)->get_last_resp_oid()) {
+      if (resp_oid <= *head->get_last_resp_oid()) {
         return;
       }
     } else {
       // If the response OID is lexicographically less than the request OID,
       // discard the response.  Likely cause for collecting this response is
       // an overrun on a walk from another root OID.
-      if (resp_oid <= *(*it)->get_req_oid()) {
+      if (resp_oid <= *head->get_req_oid()) {
         return;
       }
     }
 
     DB_TRACELOC(
         0, "SESSION_PROCESS_VAR_BIND_SET_LAST_RESPONSE_OID: %s: %s -> %s\n",
-        (*it)->get_range().repr().c_str(),
-        oid_to_string((*it)->get_last_resp_oid()).c_str(),
+        head->get_range().repr().c_str(),
+        oid_to_string(head->get_last_resp_oid()).c_str(),
         oid_to_string(resp_oid).c_str());
-    (*it)->set_last_resp_oid(resp_oid);
+    head->set_last_resp_oid(resp_oid);
     break;
   }
   DB_TRACELOC(0, "SESSION_PROCESS_VAR_BIND_APPEND_RESULT: %s\n",
               oid_to_string(resp_oid).c_str());
-  (*it)->append_result(resp_var_bind);
+  // with counter rates, counters with a previous sample are replaced by their
+  // delta and rate
+  std::optional<CounterRate> rate;
+  if (session.counters != nullptr) {
+    rate = session.counters->sample(
+        resp_var_bind, session.stamps.back().get_monotonic_ns());
+  }
+  VarBind result_var_bind = resp_var_bind;
+  if (rate.has_value()) {
+    result_var_bind.type = COUNTER_RATE;
+    result_var_bind.value = &*rate;
+    result_var_bind.value_length = sizeof(*rate);
+  }
+  if (session.columns != nullptr) {
+    head->append_result(*session.columns, result_var_bind,
+                        session.stamps.size() - 1);
+  } else {
+    head->append_result(
+        *session.results, result_var_bind, session.stamps.size() - 1,
+        (uint8_t)*session.request.get_config()->get_wireline_version(),
+        session.previous_indexes[head->get_root_oid_index()]);
+  }
+  session.result_records++;
 }
 
 auto Session::process_pdu(int op,
@@ -237,9 +198,21 @@ auto Session::process_pdu(int op,
   auto *session = (Session *)magic;
   DB_TRACELOC(0, "SESSION_PROCESS_PDU: %s\n", session->request.repr().c_str());
 
+  // exceptions must not unwind through NET-SNMP
+  try {
+    return session->handle_pdu(op, pdu);
+  } catch (std::exception const &e) {
+    session->fail(e.what());
+  } catch (...) {
+    session->fail("unknown error");
+  }
+  return 1;
+}
+
+auto Session::handle_pdu(int op, snmp_pdu *pdu) -> int {
   switch (op) {
   case NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE:
-    session->status = IDLE;
+    stamp_pdu(0);
     DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_RECEIVED_MESSAGE\n");
     // check that we got a PDU
     if (pdu != nullptr) {
@@ -248,10 +221,16 @@ auto Session::process_pdu(int op,
         // check the PDU doesn't have an error status
         if (pdu->errstat == SNMP_ERR_NOERROR) {
           // add each response variable binding to the results
+          size_t resp_var_binds = 0;
           for (variable_list *var_bind = pdu->variables; var_bind != nullptr;
                var_bind = var_bind->next_variable) {
-            process_var_bind(*var_bind, *session);
+            process_var_bind(to_var_bind(*var_bind), *this, 0);
+            resp_var_binds++;
           }
+          grow_pdu(0, resp_var_binds);
+        } else if (pdu->errstat == SNMP_ERR_TOOBIG && retry_smaller_pdu(0)) {
+          DB_TRACELOC(0, "SESSION_PROCESS_PDU_TOO_BIG_RETRY: %zu\n",
+                      bulk_var_binds);
         } else {
           // find the variable binding with an error
           variable_list *err_var_bind;
@@ -259,7 +238,7 @@ auto Session::process_pdu(int op,
                err_var_bind != nullptr && err_var_bind->index != pdu->errindex;
                err_var_bind = err_var_bind->next_variable) {
           }
-          session->append_error(
+          append_error(
               SnmpError::BAD_RESPONSE_PDU_ERROR, {}, {}, pdu->errstat,
               pdu->errindex,
               (err_var_bind == nullptr)
@@ -269,89 +248,425 @@ auto Session::process_pdu(int op,
                         err_var_bind->name + err_var_bind->name_length)},
               std::string(snmp_errstring((int)pdu->errstat)));
           DB_TRACELOC(0, "SESSION_PROCESS_PDU_BAD_RESPONSE_PDU_ERROR: %s\n",
-                      session->errors.back().repr().c_str());
-          session->status = CLOSED;
-          session->err_flag = true;
+                      errors.back().repr().c_str());
+          status = CLOSED;
+          err_flag = true;
         }
       } else {
-        session->append_error(
+        append_error(
             SnmpError::BAD_RESPONSE_PDU_ERROR, {}, SNMPERR_PROTOCOL, {}, {}, {},
             "expected RESPONSE-PDU, got " +
                 std::string(snmp_pdu_type(pdu->command)) + "-PDU");
         DB_TRACELOC(0, "SESSION_PROCESS_PDU_BAD_RESPONSE_PDU_ERROR: %s\n",
-                    session->errors.back().repr().c_str());
-        session->status = CLOSED;
-        session->err_flag = true;
+                    errors.back().repr().c_str());
+        status = CLOSED;
+        err_flag = true;
       }
     } else {
-      session->append_error(SnmpError::CREATE_RESPONSE_PDU_ERROR, {}, {}, {},
-                            {}, {},
-                            "failed to allocate memory for the response PDU");
+      append_error(SnmpError::CREATE_RESPONSE_PDU_ERROR, {}, {}, {}, {}, {},
+                   "failed to allocate memory for the response PDU");
       DB_TRACELOC(0, "SESSION_PROCESS_PDU_CREATE_RESPONSE_PDU_ERROR: %s\n",
-                  session->errors.back().repr().c_str());
-      session->status = CLOSED;
-      session->err_flag = true;
+                  errors.back().repr().c_str());
+      status = CLOSED;
+      err_flag = true;
     }
     break;
   case NETSNMP_CALLBACK_OP_TIMED_OUT:
-    session->append_error(SnmpError::TIMEOUT_ERROR, {}, SNMPERR_TIMEOUT, {}, {},
-                          {}, "timeout error");
-    DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_TIMED_OUT: %s\n",
-                session->errors.back().repr().c_str());
-    session->status = CLOSED;
-    session->err_flag = true;
+    if (shrink_timed_out_pdu(0)) {
+      DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_TIMED_OUT_RETRY: %zu\n",
+                  bulk_var_binds);
+    } else {
+      process_timeout();
+    }
     break;
   case NETSNMP_CALLBACK_OP_SEND_FAILED:
-    session->append_error(SnmpError::ASYNC_PROBE_ERROR, {}, {}, {}, {}, {},
-                          "async probe error");
+    append_error(SnmpError::ASYNC_PROBE_ERROR, {}, {}, {}, {}, {},
+                 "async probe error");
     DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_SEND_FAILED: %s\n",
-                session->errors.back().repr().c_str());
-    session->status = CLOSED;
-    session->err_flag = true;
+                errors.back().repr().c_str());
+    status = CLOSED;
+    err_flag = true;
     break;
   case NETSNMP_CALLBACK_OP_DISCONNECT:
-    session->append_error(SnmpError::TRANSPORT_DISCONNECT_ERROR, {},
-                          SNMPERR_ABORT, {}, {}, {},
-                          "transport disconnect error");
+    append_error(SnmpError::TRANSPORT_DISCONNECT_ERROR, {}, SNMPERR_ABORT, {},
+                 {}, {}, "transport disconnect error");
     DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_DISCONNECT\n: %s\n",
-                session->errors.back().repr().c_str());
-    session->status = CLOSED;
-    session->err_flag = true;
+                errors.back().repr().c_str());
+    status = CLOSED;
+    err_flag = true;
     break;
   case NETSNMP_CALLBACK_OP_RESEND:
+    // the request is still outstanding
     DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_RESEND\n");
-    break;
+    pdus[0].sent_at = std::chrono::steady_clock::now();
+    pdus[0].retransmits++;
+    return 1;
+  }
+
+  complete_pdu(0);
+
+  return 1;
+}
+
+void Session::stamp_pdu(size_t slot) {
+  auto now = std::chrono::steady_clock::now();
+  auto sent_at = pdus[slot].sent_at;
+  // Karn's algorithm: a response to a retransmitted request is ambiguous
+  if (rtt != nullptr && pdus[slot].retransmits == 0) {
+    rtt->sample(now - sent_at);
+  }
+  stamps.emplace_back(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count(),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          now.time_since_epoch())
+          .count(),
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent_at)
+          .count());
+}
+
+auto Session::get_retransmit_timeout(size_t slot) const
+    -> std::chrono::nanoseconds {
+  std::chrono::nanoseconds timeout =
+      std::chrono::seconds(*request.get_config()->get_timeout());
+  return rtt == nullptr ? timeout
+                        : rtt->get_retransmit_timeout(
+                              timeout, pdus[slot].retransmits);
+}
+
+auto Session::get_var_binds_per_pdu() const -> size_t {
+  return pdu_type == SNMP_MSG_GETBULK &&
+                 *request.get_config()->get_adaptive_repetitions()
+             ? bulk_var_binds
+             : *request.get_config()->get_max_response_var_binds_per_pdu();
+}
+
+auto Session::retry_smaller_pdu(size_t slot,
+                                std::optional<ssize_t> retries_left) -> bool {
+  if (pdu_type != SNMP_MSG_GETBULK ||
+      !*request.get_config()->get_adaptive_repetitions() ||
+      bulk_var_binds <= 1) {
+    return false;
+  }
+  // multiplicative decrease; the heads re-request from where they left off
+  bulk_var_binds /= 2;
+  OutstandingPdu &pdu = pdus[slot];
+  for (auto *head : pdu.heads) {
+    head->retry_req_oid(retries_left);
+  }
+  busy_heads -= pdu.heads.size();
+  pdu.heads.clear();
+  pdu.active = false;
+  status = IDLE;
+  return true;
+}
+
+auto Session::can_shrink_timed_out_pdu(size_t slot) const -> bool {
+  // a lost datagram says little about the PDU size, so only halve once
+  return pdu_type == SNMP_MSG_GETBULK &&
+         *request.get_config()->get_adaptive_repetitions() &&
+         bulk_var_binds > 1 && !pdus[slot].shrunk &&
+         pdus[slot].retries_left > 0;
+}
+
+auto Session::shrink_timed_out_pdu(size_t slot) -> bool {
+  if (!can_shrink_timed_out_pdu(slot)) {
+    return false;
+  }
+  return retry_smaller_pdu(slot, pdus[slot].retries_left - 1);
+}
+
+void Session::start_retries(OutstandingPdu &pdu) {
+  pdu.retries_left = *request.get_config()->get_retries();
+  pdu.shrunk = false;
+  for (auto *head : pdu.heads) {
+    auto retries_left = head->take_retries_left();
+    if (retries_left.has_value()) {
+      pdu.retries_left = std::min(pdu.retries_left, *retries_left);
+      pdu.shrunk = true;
+    }
+  }
+}
+
+void Session::grow_pdu(size_t slot, size_t resp_var_binds) {
+  if (pdu_type != SNMP_MSG_GETBULK ||
+      !*request.get_config()->get_adaptive_repetitions()) {
+    return;
   }
+  // additive increase of one repetition per OID while responses come back
+  // complete and well within the timeout
+  int64_t timeout_ns = *request.get_config()->get_timeout() * 1000000000LL;
+  if (resp_var_binds >= pdus[slot].var_binds && !stamps.empty() &&
+      stamps.back().get_rtt_ns() < timeout_ns / 2) {
+    bulk_var_binds = std::min<size_t>(MAX_ADAPTIVE_VAR_BINDS_PER_PDU,
+                                      bulk_var_binds + pdus[slot].heads.size());
+  }
+}
+
+void Session::process_timeout() {
+  append_error(SnmpError::TIMEOUT_ERROR, {}, SNMPERR_TIMEOUT, {}, {}, {},
+               "timeout error");
+  DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_TIMED_OUT: %s\n",
+              errors.back().repr().c_str());
+  status = CLOSED;
+  err_flag = true;
+}
+
+void Session::complete_pdu(size_t slot) {
+  OutstandingPdu &pdu = pdus[slot];
 
   // remove collection nodes that had a request but no response
-  for (auto it = session->collection_heads.begin();
-       it != session->collection_heads.end();) {
+  for (auto *head : pdu.heads) {
     DB_TRACELOC(0, "SESSION_PROCESS_PDU_FINAL_COLLECTION_HEAD: (%s, %s)\n",
-                attr_to_string((*it)->get_req_oid()).c_str(),
-                attr_to_string((*it)->get_last_resp_oid()).c_str());
-    if ((*it)->get_req_oid().has_value()) {
-      if (!(*it)->get_last_resp_oid().has_value()) {
+                attr_to_string(head->get_req_oid()).c_str(),
+                attr_to_string(head->get_last_resp_oid()).c_str());
+    if (head->get_req_oid().has_value()) {
+      if (!head->get_last_resp_oid().has_value()) {
         DB_TRACELOC(0, "SESSION_PROCESS_PDU_REMOVE_COLLECTION_HEAD: %s\n",
-                    (*it)->get_range().repr().c_str());
-        it = session->collection_heads.erase(it);
+                    head->get_range().repr().c_str());
+        complete_collection_head(*head);
         continue;
       }
-      (*it)->reset_req_oid();
+      if (*request.get_config()->get_auto_partition() > 1) {
+        partition_collection_head(*head);
+      }
+      head->reset_req_oid();
     }
-    ++it;
   }
+  busy_heads -= pdu.heads.size();
+  pdu.heads.clear();
+  pdu.active = false;
 
-  // close the session once all collection nodes have completed
-  if (session->collection_heads.empty()) {
-    session->status = CLOSED;
+  // close the session once all collection nodes have completed, otherwise
+  // the slot can take the next request
+  if (active_heads == 0) {
+    status = CLOSED;
+  } else if (status != CLOSED) {
+    status = IDLE;
   }
+}
 
-  return 1;
+/*!
+  Get the first OID past the subtree of `oid`, i.e. every OID less than the
+  result is less than or equal to `oid` or has `oid` as its root.
+
+  \return `std::optional<ObjectIdentity>`: OID or `std::nullopt` if unbounded.
+*/
+[[nodiscard]] static auto subtree_limit(ObjectIdentity oid)
+    -> std::optional<ObjectIdentity> {
+  while (!oid.empty()) {
+    if (oid.back() < std::numeric_limits<oid_t>::max()) {
+      oid.back()++;
+      return oid;
+    }
+    oid.pop_back();
+  }
+  return std::nullopt;
 }
 
-Session::Session(SnmpRequest request)
-    : request(std::move(request)),
-      results(std::make_shared<std::vector<uint8_t>>()) {
+void Session::index_collection_heads() {
+  head_ring.clear();
+  head_index.clear();
+  for (auto &&head : collection_heads) {
+    head_ring.push_back(&head);
+    head_index.push_back(&head);
+  }
+  head_ring_pos = 0;
+  stale_heads = 0;
+  active_heads = collection_heads.size();
+  root_partitions.assign(request.get_oids().size(), 0);
+  for (auto &&head : collection_heads) {
+    root_partitions[head.get_root_oid_index()]++;
+  }
+  sort_collection_heads();
+}
+
+void Session::sort_collection_heads() {
+  std::stable_sort(head_index.begin(), head_index.end(),
+                   [](CollectionHead const *lhs, CollectionHead const *rhs) {
+                     return lhs->get_range().get_start() <
+                            rhs->get_range().get_start();
+                   });
+
+  // running maximum of the subtree limits bounds how far back a lookup scans
+  head_index_limits.clear();
+  for (auto *head : head_index) {
+    auto limit = subtree_limit(head->get_range().get_stop());
+    if (!head_index_limits.empty() &&
+        (!head_index_limits.back().has_value() ||
+         (limit.has_value() && *limit < *head_index_limits.back()))) {
+      limit = head_index_limits.back();
+    }
+    head_index_limits.push_back(std::move(limit));
+  }
+}
+
+auto Session::find_collection_head(ObjectIdentity const &resp_oid,
+                                   size_t slot) -> CollectionHead * {
+  if (request.get_type() == SnmpRequest::GET_REQUEST) {
+    // for a GET_REQUEST, OID must match the range point
+    auto it = std::lower_bound(
+        head_index.begin(), head_index.end(), resp_oid,
+        [](CollectionHead const *head, ObjectIdentity const &oid) {
+          return head->get_range().get_start() < oid;
+        });
+    for (; it != head_index.end() && (*it)->get_range().get_start() == resp_oid;
+         ++it) {
+      // skip if collection head was not active for this PDU
+      if ((*it)->get_req_oid().has_value() && (*it)->get_pdu_slot() == slot) {
+        return *it;
+      }
+    }
+    return nullptr;
+  }
+
+  // for a WALK_REQUEST, OID must be between the range inclusive or stop must
+  // be a root of the OID; candidates are the ranges starting at or before the
+  // OID, nearest first
+  auto it = std::upper_bound(
+      head_index.begin(), head_index.end(), resp_oid,
+      [](ObjectIdentity const &oid, CollectionHead const *head) {
+        return oid < head->get_range().get_start();
+      });
+  for (auto pos = (size_t)(it - head_index.begin()); pos > 0; --pos) {
+    // no range at or before this position reaches the OID
+    auto const &limit = head_index_limits[pos - 1];
+    if (limit.has_value() && *limit <= resp_oid) {
+      break;
+    }
+    CollectionHead *head = head_index[pos - 1];
+    // skip if collection head was not active for this PDU
+    if (head->get_req_oid().has_value() && head->get_pdu_slot() == slot &&
+        (resp_oid <= head->get_range().get_stop() ||
+         head->get_range().get_stop().is_root_of(resp_oid))) {
+      return head;
+    }
+  }
+  return nullptr;
+}
+
+auto Session::next_collection_head() -> CollectionHead & {
+  while (true) {
+    CollectionHead *head = head_ring[head_ring_pos];
+    head_ring_pos = (head_ring_pos + 1) % head_ring.size();
+    if (!head->get_completed() && !head->get_req_oid().has_value()) {
+      return *head;
+    }
+  }
+}
+
+void Session::partition_collection_head(CollectionHead &head) {
+  if (request.get_type() != SnmpRequest::WALK_REQUEST ||
+      root_partitions[head.get_root_oid_index()] >=
+          *request.get_config()->get_auto_partition()) {
+    return;
+  }
+
+  // every response of the PDU lies between the request and last response
+  // OIDs, so their common prefix is the subtree the PDU stayed within
+  ObjectIdentity const &req_oid = *head.get_req_oid();
+  ObjectIdentity const &last_resp_oid = *head.get_last_resp_oid();
+  auto prefix_size =
+      (size_t)(std::mismatch(req_oid.begin(), req_oid.end(),
+                             last_resp_oid.begin(), last_resp_oid.end())
+                   .second -
+               last_resp_oid.begin());
+  ObjectIdentity subtree(last_resp_oid.data(),
+                         last_resp_oid.data() + prefix_size);
+
+  // a PDU that spans subtrees right below the root has nothing to split
+  ObjectIdentity const &root_oid = head.get_root_oid();
+  ObjectIdentityRange const &range = head.get_range();
+  if (subtree.size() <= root_oid.size() || !root_oid.is_root_of(subtree) ||
+      subtree < range.get_start()) {
+    return;
+  }
+
+  // the rest of the range starts past the subtree
+  auto start = subtree_limit(subtree);
+  ObjectIdentity stop = range.get_stop();
+  if (!start.has_value() || !root_oid.is_root_of(*start) ||
+      !(*start <= stop || stop.is_root_of(*start))) {
+    return;
+  }
+  if (*start > stop) {
+    // same subtree, expressed as a stop at or after the start
+    stop.push_back(std::numeric_limits<oid_t>::max());
+    if (*start > stop) {
+      return;
+    }
+  }
+
+  DB_TRACELOC(0, "SESSION_PARTITION_COLLECTION_HEAD: %s: %s - %s\n",
+              head.get_range().repr().c_str(), oid_to_string(subtree).c_str(),
+              oid_to_string(*start).c_str());
+
+  // the new node resumes the walk just before the start of its range
+  auto &partition = collection_heads.emplace_back(
+      head.get_root_oid_index(), root_oid,
+      ObjectIdentityRange(
+          ObjectIdentity(start->data() + root_oid.size(),
+                         start->data() + start->size()),
+          ObjectIdentity(stop.data() + root_oid.size(),
+                         stop.data() + stop.size())));
+  ObjectIdentity resume = subtree;
+  resume.push_back(std::numeric_limits<oid_t>::max());
+  partition.set_last_resp_oid(resume);
+  head.set_range(ObjectIdentityRange(range.get_start(), subtree));
+
+  head_index.push_back(&partition);
+  sort_collection_heads();
+  head_ring.push_back(&partition);
+  active_heads++;
+  root_partitions[partition.get_root_oid_index()]++;
+}
+
+void Session::complete_collection_head(CollectionHead &head) {
+  head.complete();
+  active_heads--;
+  root_partitions[head.get_root_oid_index()]--;
+
+  // compact once half of the ring is completed nodes
+  if (++stale_heads * 2 > head_ring.size()) {
+    CollectionHead *next = nullptr;
+    for (size_t i = 0; i < head_ring.size() && active_heads > 0; ++i) {
+      CollectionHead *candidate =
+          head_ring[(head_ring_pos + i) % head_ring.size()];
+      if (!candidate->get_completed()) {
+        next = candidate;
+        break;
+      }
+    }
+    head_ring.erase(std::remove_if(head_ring.begin(), head_ring.end(),
+                                   [](CollectionHead const *candidate) {
+                                     return candidate->get_completed();
+                                   }),
+                    head_ring.end());
+    // keep the round-robin position
+    head_ring_pos = next == nullptr ? 0
+                                    : std::find(head_ring.begin(),
+                                                head_ring.end(), next) -
+                                          head_ring.begin();
+    stale_heads = 0;
+  }
+}
+
+Session::Session(SnmpRequest request, Transport *transport,
+                 std::shared_ptr<SegmentPool> pool, RttEstimator *rtt,
+                 TokenBucket *bucket, CounterRates *counters,
+                 std::shared_ptr<ResultSink> sink)
+    : request(std::move(request)), _netsnmp_session(nullptr),
+      pool(std::move(pool)), result_records(0), sink(std::move(sink)),
+      head_ring_pos(0), stale_heads(0), active_heads(0), busy_heads(0),
+      pdus(transport != nullptr
+               ? *this->request.get_config()->get_pipeline_depth()
+               : 1),
+      transport(transport), peer(nullptr),
+      bulk_var_binds(std::min<size_t>(
+          MAX_ADAPTIVE_VAR_BINDS_PER_PDU,
+          *this->request.get_config()->get_max_response_var_binds_per_pdu())),
+      rtt(rtt), bucket(bucket), counters(counters) {
   DB_TRACELOC(0, "SESSION_CREATE: %s\n", this->request.repr().c_str());
 
   switch (this->request.get_type()) {
@@ -370,112 +685,107 @@ Session::Session(SnmpRequest request)
     break;
   }
 
-  // init a NET-SNMP session template
-  netsnmp_session session;
-  snmp_sess_init(&session);
-
-  // configure the NET-SNMP session template
-  session.peername = strdup(this->request.get_host().c_str());
-  session.retries = *this->request.get_config()->get_retries();
-  session.timeout = *this->request.get_config()->get_timeout() * ONE_SEC;
-  session.community =
-      (u_char *)strdup(this->request.get_community().get_string().c_str());
-  session.community_len = strlen((char *)session.community);
-  session.version = this->request.get_community().get_version();
-
-  // open the session
-  _netsnmp_session = snmp_sess_open(&session);
-
-  DB_TRACELOC(0, "SESSION_ADDRESS: 0x%zx\n", _netsnmp_session);
-
-  if (_netsnmp_session == nullptr) {
-    char *message;
-    int sys_errno;
-    int snmp_errno;
-    snmp_error(&session, &errno, &snmp_errno, &message);
-    auto error = append_error(SnmpError::SESSION_ERROR, sys_errno, snmp_errno,
-                              {}, {}, {}, std::string(message));
-    DB_TRACELOC(0, "SNMP_ERROR: %s\n", error.repr().c_str());
-    SNMP_FREE(message);
-    SNMP_FREE(session.peername);
-    SNMP_FREE(session.community);
-    status = CLOSED;
-    err_flag = true;
-    return;
-  }
+  // errors opening the session close it instead of failing the worker
+  try {
+    if (transport != nullptr) {
+      // messages are encoded natively and sent over the shared sockets
+      peer = transport->open(this, this->request.get_host());
+      if (peer == nullptr) {
+        fail("failed to resolve host");
+        return;
+      }
+    } else {
+      // init a NET-SNMP session template
+      netsnmp_session session;
+      snmp_sess_init(&session);
+
+      // configure the NET-SNMP session template
+      session.peername = strdup(this->request.get_host().c_str());
+      session.retries = *this->request.get_config()->get_retries();
+      session.timeout = *this->request.get_config()->get_timeout() * ONE_SEC;
+      session.community =
+          (u_char *)strdup(this->request.get_community().get_string().c_str());
+      session.community_len = strlen((char *)session.community);
+      session.version = this->request.get_community().get_version();
+
+      // open the session on a dedicated socket
+      _netsnmp_session = snmp_sess_open(&session);
+
+      DB_TRACELOC(0, "SESSION_ADDRESS: 0x%zx\n", _netsnmp_session);
+
+      if (_netsnmp_session == nullptr) {
+        char *message;
+        int sys_errno;
+        int snmp_errno;
+        snmp_error(&session, &errno, &snmp_errno, &message);
+        std::string error(message);
+        SNMP_FREE(message);
+        SNMP_FREE(session.peername);
+        SNMP_FREE(session.community);
+        fail(error, sys_errno, snmp_errno);
+        return;
+      }
 
 #ifdef DEBUG
-  // DEBUG check not strictly necessary, but linters will complain the ptr is
-  // never used
-  auto *session_ptr = snmp_sess_session(_netsnmp_session);
-  DB_TRACELOC(0, "SESSION_HOSTNAME: %s\n", session_ptr->peername);
-  DB_TRACELOC(0, "SESSION_VERSION: %u\n", session_ptr->version);
-  DB_TRACELOC(0, "SESSION_COMMUNITY: %s\n", session_ptr->community);
-  DB_TRACELOC(0, "SESSION_COMMUNITY_LENGTH: %u\n", session_ptr->community_len);
-  DB_TRACELOC(0, "SESSION_RETRIES: %d\n", session_ptr->retries);
-  DB_TRACELOC(0, "SESSION_TIMEOUT: %d\n", session_ptr->timeout);
+      // DEBUG check not strictly necessary, but linters will complain the ptr
+      // is never used
+      auto *session_ptr = snmp_sess_session(_netsnmp_session);
+      DB_TRACELOC(0, "SESSION_HOSTNAME: %s\n", session_ptr->peername);
+      DB_TRACELOC(0, "SESSION_VERSION: %u\n", session_ptr->version);
+      DB_TRACELOC(0, "SESSION_COMMUNITY: %s\n", session_ptr->community);
+      DB_TRACELOC(0, "SESSION_COMMUNITY_LENGTH: %u\n",
+                  session_ptr->community_len);
+      DB_TRACELOC(0, "SESSION_RETRIES: %d\n", session_ptr->retries);
+      DB_TRACELOC(0, "SESSION_TIMEOUT: %d\n", session_ptr->timeout);
 #endif
+    }
 
-  status = IDLE;
+    status = IDLE;
 
-  // fill the results header
-  size_t pos = 0;
-  results->resize(HEADER_BYTES);
-  // endianess
-  if constexpr (endian::native == endian::little) {
-    (*results)[0] = 0;
-  } else if constexpr (endian::native == endian::big) {
-    (*results)[0] = 1;
-  } else {
-    throw std::runtime_error("endianness could not be detected");
-  }
-  (*results)[1] = SYS_ALIGN(sizeof(size_t)); // word size
-  (*results)[2] = sizeof(oid_t);             // octet size
-
-  // add metadata to the results header
-  pos = results->size();
-  size_t tmp = this->request.get_req_id().has_value()
-                   ? this->request.get_req_id()->size()
-                   : 0;
-  results->resize(pos + SYS_ALIGN(sizeof(tmp)) + SYS_ALIGN(tmp));
-  std::memcpy(&(*results)[pos], &tmp, sizeof(tmp));
-  if (this->request.get_req_id().has_value()) {
-    std::memcpy(&(*results)[pos + SYS_ALIGN(sizeof(tmp))],
-                this->request.get_req_id()->c_str(), tmp);
-  }
-
-  // append the number of root OIDs to the results header
-  pos = results->size();
-  tmp = this->request.get_oids().size();
-  results->resize(pos + SYS_ALIGN(sizeof(tmp)));
-  std::memcpy(&(*results)[pos], &tmp, sizeof(tmp));
-
-  // create each collection head
-  size_t root_oid_index = 0;
-  for (auto &&oid : this->request.get_oids()) {
-    if (this->request.get_ranges().has_value() &&
-        !this->request.get_ranges()->empty()) {
-      for (auto &&range : *this->request.get_ranges()) {
-        collection_heads.push_back(std::make_unique<CollectionHead>(
-            root_oid_index++, oid, range, results));
+    // create each collection head
+    size_t root_oid_index = 0;
+    for (auto &&oid : this->request.get_oids()) {
+      if (this->request.get_ranges().has_value() &&
+          !this->request.get_ranges()->empty()) {
+        for (auto &&range : *this->request.get_ranges()) {
+          collection_heads.emplace_back(root_oid_index, oid, range);
+        }
+      } else {
+        collection_heads.emplace_back(root_oid_index, oid, std::nullopt);
       }
-    } else {
-      collection_heads.push_back(std::make_unique<CollectionHead>(
-          root_oid_index++, oid, std::nullopt, results));
+      root_oid_index++;
     }
-    // append the root OID to the results header
-    pos = results->size();
-    tmp = oid.size();
-    results->resize(pos + SYS_ALIGN(sizeof(tmp)) +
-                    SYS_ALIGN(tmp * sizeof(oid_t)));
-    std::memcpy(&(*results)[pos], &tmp, sizeof(tmp));
-    std::memcpy(&(*results)[pos + SYS_ALIGN(sizeof(tmp))], oid.data(),
-                tmp * sizeof(oid_t));
+
+    start_results();
+    index_collection_heads();
+  } catch (std::exception const &e) {
+    fail(e.what());
   }
 }
 
+void Session::start_results() {
+  // the header may fail to allocate, so only replace the results once written
+  auto started = std::make_shared<ResultBuffer>(
+      pool, *request.get_config()->get_shared_memory());
+  append_header(*started,
+                (uint8_t)*request.get_config()->get_wireline_version(),
+                request.get_req_id(), request.get_oids());
+  results = std::move(started);
+  result_records = 0;
+  // delta encoded indexes start over with every results buffer
+  previous_indexes.assign(request.get_oids().size(), {});
+
+  columns = *request.get_config()->get_columnar()
+                ? std::make_shared<ColumnarResults>(request.get_oids().size())
+                : nullptr;
+}
+
 Session::~Session() {
   DB_TRACELOC(0, "SESSION_DESTORY: %s\n", request.repr().c_str());
+  if (peer != nullptr) {
+    transport->close(peer);
+    return;
+  }
   if (_netsnmp_session == nullptr) {
     return;
   }
@@ -487,6 +797,52 @@ Session::~Session() {
               request.repr().c_str());
 }
 
+void Session::send_native(size_t slot, size_t oids) {
+  OutstandingPdu &pdu = pdus[slot];
+
+  // take the next idle collection heads round-robin
+  req_oids.clear();
+  while (req_oids.size() < oids && busy_heads < active_heads) {
+    CollectionHead &head = next_collection_head();
+    req_oids.push_back(&head.get_next_req_oid(slot));
+    pdu.heads.push_back(&head);
+    busy_heads++;
+    DB_TRACELOC(0, "SESSION_SEND_ADD_VAR_BIND: %zu: '%s'\n", slot,
+                oid_to_string(*req_oids.back()).c_str());
+  }
+
+  // encode straight into the slot's reusable message buffer
+  pdu.reqid = snmp_get_next_reqid();
+  int64_t max_repetitions =
+      pdu_type == SNMP_MSG_GETBULK
+          ? (int64_t)(get_var_binds_per_pdu() / req_oids.size())
+          : 1;
+  pdu.var_binds = req_oids.size() * max_repetitions;
+  ber_encode_request(pdu.message, request.get_community().get_version(),
+                     request.get_community().get_string(), (uint8_t)pdu_type,
+                     pdu.reqid, 0,
+                     pdu_type == SNMP_MSG_GETBULK ? max_repetitions : 0,
+                     req_oids);
+
+  if (!transport->send(*peer, pdu.message.data(), pdu.message.size(),
+                       pdu.reqid)) {
+    int sys_errno = errno;
+    auto error = append_error(SnmpError::SEND_ERROR, sys_errno, {}, {}, {}, {},
+                              std::string(std::strerror(sys_errno)));
+    DB_TRACELOC(0, "SESSION_SEND_ASYNC_SEND_ERROR: %s\n", error.repr().c_str());
+    status = CLOSED;
+    err_flag = true;
+    return;
+  }
+
+  // the slot waits for its response
+  pdu.active = true;
+  start_retries(pdu);
+  pdu.retransmits = 0;
+  pdu.sent_at = std::chrono::steady_clock::now();
+  pdu.deadline = pdu.sent_at + get_retransmit_timeout(slot);
+}
+
 void Session::send() {
   DB_TRACELOC(0, "SESSION_SEND: %s: %s\n", attr_to_string(status).c_str(),
               request.repr().c_str());
@@ -495,6 +851,48 @@ void Session::send() {
     return;
   }
 
+  if (peer != nullptr) {
+    /*
+      Same selection as the NET-SNMP path: up to
+      sqrt(max_response_var_binds_per_pdu) OIDs for BULK requests and
+      max_response_var_binds_per_pdu OIDs otherwise.  The idle collection
+      heads are spread evenly over the free pipeline slots so a multi-range
+      walk keeps several PDUs outstanding.
+    */
+    size_t var_binds_per_pdu = get_var_binds_per_pdu();
+    auto max_oids = (size_t)(pdu_type == SNMP_MSG_GETBULK
+                                 ? std::ceil(std::sqrt(var_binds_per_pdu))
+                                 : var_binds_per_pdu);
+    size_t free_slots = std::count_if(
+        pdus.begin(), pdus.end(),
+        [](OutstandingPdu const &pdu) { return !pdu.active; });
+    for (size_t slot = 0; slot < pdus.size() && busy_heads < active_heads;
+         ++slot) {
+      if (pdus[slot].active) {
+        continue;
+      }
+      if (throttle()) {
+        break;
+      }
+      size_t idle_heads = active_heads - busy_heads;
+      send_native(slot, std::min(max_oids,
+                                 (idle_heads + free_slots - 1) / free_slots));
+      free_slots--;
+      if (status == CLOSED) {
+        return;
+      }
+    }
+    status = WAIT;
+    return;
+  }
+
+  OutstandingPdu &outstanding = pdus[0];
+
+  if (throttle()) {
+    status = WAIT;
+    return;
+  }
+
   // create the request PDU
   netsnmp_pdu *pdu = snmp_pdu_create(pdu_type);
 
@@ -518,15 +916,14 @@ void Session::send() {
     insert up to the number of collection heads.
   */
   size_t var_bind_count = 0;
-  size_t max_response_var_binds_per_pdu =
-      *request.get_config()->get_max_response_var_binds_per_pdu();
+  size_t max_response_var_binds_per_pdu = get_var_binds_per_pdu();
   netsnmp_variable_list *var_bind;
   while (var_bind_count < (pdu_type == SNMP_MSG_GETBULK
                                ? sqrt(max_response_var_binds_per_pdu)
                                : max_response_var_binds_per_pdu) &&
-         var_bind_count < collection_heads.size()) {
-    ObjectIdentity const &req_oid =
-        collection_heads.front()->get_next_req_oid();
+         busy_heads < active_heads) {
+    CollectionHead &head = next_collection_head();
+    ObjectIdentity const &req_oid = head.get_next_req_oid();
     DB_TRACELOC(0, "SESSION_SEND_ADD_VAR_BIND: '%s'\n",
                 oid_to_string(req_oid).c_str());
     var_bind = snmp_add_null_var(pdu, req_oid.data(), req_oid.size());
@@ -536,11 +933,10 @@ void Session::send() {
       DB_TRACELOC(0, "SESSION_SEND_ADD_VAR_BIND_ERROR: %s\n",
                   error.repr().c_str());
       err_flag = true; // not fatal, but OID will no longer be attempted
-      collection_heads.pop_front(); // remove collection head on failure
+      complete_collection_head(head); // remove collection head on failure
     } else {
-      // rotate collection heads
-      collection_heads.splice(collection_heads.end(), collection_heads,
-                              collection_heads.begin());
+      outstanding.heads.push_back(&head);
+      busy_heads++;
       var_bind_count++;
     }
   }
@@ -550,8 +946,21 @@ void Session::send() {
     pdu->max_repetitions = // should be n^2 < max_response_var_binds_per_pdu
                            // unless there are fewer collection heads
         (ssize_t)(max_response_var_binds_per_pdu / var_bind_count);
+    outstanding.var_binds = var_bind_count * pdu->max_repetitions;
+  } else {
+    outstanding.var_binds = var_bind_count;
   }
 
+  // NET-SNMP retransmits on the session timeout taken at send time and
+  // checks the session retries when the request times out
+  start_retries(outstanding);
+  snmp_sess_session(_netsnmp_session)->retries = (int)outstanding.retries_left;
+  outstanding.retransmits = 0;
+  snmp_sess_session(_netsnmp_session)->timeout =
+      (long)std::chrono::duration_cast<std::chrono::microseconds>(
+          get_retransmit_timeout(0))
+          .count();
+
   // dispatch the PDU and log on error
   if (snmp_sess_async_send(_netsnmp_session, pdu, process_pdu, this) == 0) {
     char *message;
@@ -570,131 +979,1026 @@ void Session::send() {
 
   // set the state to waiting
   status = WAIT;
+  outstanding.active = true;
+  outstanding.sent_at = std::chrono::steady_clock::now();
+  outstanding.deadline = outstanding.sent_at + get_retransmit_timeout(0);
 }
 
-void Session::read() {
+void Session::read(netsnmp_large_fd_set &fdset) {
   DB_TRACELOC(0, "SESSION_READ: %s\n", request.repr().c_str());
   DB_TRACELOC(0, "SESSION_READ_STATUS: %s\n", attr_to_string(status).c_str());
 
-  // check that the session is waiting for data
-  if (status != WAIT) {
+  // a closed session has nothing left to read
+  if (status == CLOSED) {
+    return;
+  }
+
+  // grow the scratch socket set if the socket is beyond its size
+  int fd = get_fd();
+  if (fd >= (int)fdset.lfs_setsize) {
+    netsnmp_large_fd_set_resize(&fdset, fd + 1);
+  }
+
+  // read the socket data; this triggers the callback function
+  DB_TRACELOC(0, "SESSION_READ_SOCKET_HAS_DATA\n");
+  NETSNMP_LARGE_FD_SET(fd, &fdset);
+  snmp_sess_read2(_netsnmp_session, &fdset);
+  NETSNMP_LARGE_FD_CLR(fd, &fdset);
+}
+
+void Session::read(uint8_t const *data, size_t size) {
+  DB_TRACELOC(0, "SESSION_READ_NATIVE: %s: %zu bytes\n", request.repr().c_str(),
+              size);
+
+  if (status == CLOSED) {
     return;
   }
 
-  // init a socket set
-  fd_set fdset;
-  FD_ZERO(&fdset);
+  // malformed or stale messages are dropped and the requests keep waiting
+  auto pdu = ber_decode_pdu(data, size);
+  auto it = std::find_if(pdus.begin(), pdus.end(),
+                         [&pdu](OutstandingPdu const &outstanding) {
+                           return pdu.has_value() && outstanding.active &&
+                                  outstanding.reqid == pdu->request_id;
+                         });
+  if (it == pdus.end()) {
+    DB_TRACELOC(0, "SESSION_READ_NATIVE_DROPPED\n");
+    return;
+  }
+  auto slot = (size_t)(it - pdus.begin());
+
+  stamp_pdu(slot);
+  VarBind var_bind{};
+
+  if (pdu->command != SNMP_MSG_RESPONSE) {
+    append_error(SnmpError::BAD_RESPONSE_PDU_ERROR, {}, SNMPERR_PROTOCOL, {},
+                 {}, {},
+                 "expected RESPONSE-PDU, got " +
+                     std::string(snmp_pdu_type(pdu->command)) + "-PDU");
+    DB_TRACELOC(0, "SESSION_PROCESS_PDU_BAD_RESPONSE_PDU_ERROR: %s\n",
+                errors.back().repr().c_str());
+    status = CLOSED;
+    err_flag = true;
+  } else if (pdu->error_status == SNMP_ERR_TOOBIG && retry_smaller_pdu(slot)) {
+    DB_TRACELOC(0, "SESSION_PROCESS_PDU_TOO_BIG_RETRY: %zu\n", bulk_var_binds);
+  } else if (pdu->error_status != SNMP_ERR_NOERROR) {
+    // find the variable binding with an error
+    size_t pos = pdu->var_binds_pos;
+    std::optional<ObjectIdentity> err_oid;
+    while (pos < pdu->var_binds_end &&
+           ber_decode_var_bind(data, pdu->var_binds_end, pos, scratch,
+                               var_bind)) {
+      if ((int64_t)var_bind.index == pdu->error_index) {
+        err_oid = ObjectIdentity(var_bind.name,
+                                 var_bind.name + var_bind.name_length);
+        break;
+      }
+    }
+    append_error(SnmpError::BAD_RESPONSE_PDU_ERROR, {}, {}, pdu->error_status,
+                 pdu->error_index, err_oid,
+                 std::string(snmp_errstring((int)pdu->error_status)));
+    DB_TRACELOC(0, "SESSION_PROCESS_PDU_BAD_RESPONSE_PDU_ERROR: %s\n",
+                errors.back().repr().c_str());
+    status = CLOSED;
+    err_flag = true;
+  } else {
+    // add each response variable binding to the results straight from the
+    // datagram
+    size_t pos = pdu->var_binds_pos;
+    size_t resp_var_binds = 0;
+    while (pos < pdu->var_binds_end) {
+      if (!ber_decode_var_bind(data, pdu->var_binds_end, pos, scratch,
+                               var_bind)) {
+        append_error(SnmpError::BAD_RESPONSE_PDU_ERROR, {}, SNMPERR_PROTOCOL,
+                     {}, var_bind.index + 1, {},
+                     "malformed variable binding");
+        DB_TRACELOC(0, "SESSION_PROCESS_PDU_BAD_RESPONSE_PDU_ERROR: %s\n",
+                    errors.back().repr().c_str());
+        status = CLOSED;
+        err_flag = true;
+        break;
+      }
+      process_var_bind(var_bind, *this, slot);
+      resp_var_binds++;
+    }
+    if (status != CLOSED) {
+      grow_pdu(slot, resp_var_binds);
+    }
+  }
 
-  // init the highest numbered socket id + 1 in the set to 0
-  int nfds = 0;
+  complete_pdu(slot);
+}
 
-  // init a timeout parameter
-  struct timeval timeout;
+void Session::timeout() {
+  DB_TRACELOC(0, "SESSION_TIMEOUT: %s\n", request.repr().c_str());
 
-  // init socket reads to be blocking
-  int block = NETSNMP_SNMPBLOCK;
+  if (status == CLOSED) {
+    return;
+  }
 
-  // let NET-SNMP fill all the parameters above for select
-  snmp_sess_select_info(_netsnmp_session, &nfds, &fdset, &timeout, &block);
+  // resume sending new PDUs once the rate limit allows
+  auto now = std::chrono::steady_clock::now();
+  if (throttled_until.has_value() && *throttled_until <= now) {
+    throttled_until.reset();
+    if (busy_heads < active_heads) {
+      status = IDLE;
+    }
+  }
 
-  // make the syscall to select to read the session socket
-  int count =
-      select(nfds, &fdset, nullptr, nullptr, block != 0 ? nullptr : &timeout);
+  // resend the same message or time out, per pipeline slot
+  if (peer != nullptr) {
+    for (size_t slot = 0; slot < pdus.size(); ++slot) {
+      OutstandingPdu &pdu = pdus[slot];
+      if (!pdu.active || pdu.deadline > now) {
+        continue;
+      }
+      // with adaptive repetitions, first retry with a smaller PDU
+      if (shrink_timed_out_pdu(slot)) {
+        DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_TIMED_OUT_RETRY: %zu\n",
+                    bulk_var_binds);
+        continue;
+      }
+      if (pdu.retries_left-- > 0 &&
+          transport->send(*peer, pdu.message.data(), pdu.message.size(),
+                          pdu.reqid)) {
+        DB_TRACELOC(0, "SESSION_PROCESS_PDU_OP_RESEND: %zu\n", slot);
+        pdu.retransmits++;
+        pdu.sent_at = now;
+        pdu.deadline = pdu.sent_at + get_retransmit_timeout(slot);
+        continue;
+      }
+      process_timeout();
+      complete_pdu(slot);
+      return;
+    }
+    return;
+  }
 
-  // check if the socket is ready to read
-  if (count != 0) {
-    // read the socket data; this triggers the callback function
-    DB_TRACELOC(0, "SESSION_READ_SOCKET_HAS_DATA\n");
-    snmp_sess_read(_netsnmp_session, &fdset);
-  } else {
-    // retry or timeout otherwise
-    DB_TRACELOC(0, "SESSION_READ_TIMEOUT_OR_RETRY_SOCKET\n");
-    snmp_sess_timeout(_netsnmp_session);
+  if (!pdus[0].active || pdus[0].deadline > now) {
+    return;
+  }
+
+  // retry or timeout; NET-SNMP resends the PDU if there are retries remaining
+  DB_TRACELOC(0, "SESSION_READ_TIMEOUT_OR_RETRY_SOCKET\n");
+  // without retries left NET-SNMP reports the timeout now instead of
+  // resending, so the PDU is made smaller on its first timeout
+  if (can_shrink_timed_out_pdu(0)) {
+    snmp_sess_session(_netsnmp_session)->retries = 0;
+  }
+  snmp_sess_timeout(_netsnmp_session);
+
+  if (pdus[0].active) {
+    pdus[0].deadline =
+        std::chrono::steady_clock::now() + get_retransmit_timeout(0);
+  }
+}
+
+auto Session::get_deadline() const
+    -> std::optional<std::chrono::steady_clock::time_point> {
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  for (auto const &pdu : pdus) {
+    if (pdu.active && (!deadline.has_value() || pdu.deadline < *deadline)) {
+      deadline = pdu.deadline;
+    }
+  }
+  if (throttled_until.has_value() &&
+      (!deadline.has_value() || *throttled_until < *deadline)) {
+    deadline = throttled_until;
+  }
+  return deadline;
+}
+
+auto Session::throttle() -> bool {
+  if (bucket == nullptr) {
+    return false;
+  }
+  if (throttled_until.has_value()) {
+    return true;
+  }
+  throttled_until = bucket->take(std::chrono::steady_clock::now());
+  if (throttled_until.has_value()) {
+    DB_TRACELOC(0, "SESSION_THROTTLED: %s\n", request.repr().c_str());
+  }
+  return throttled_until.has_value();
+}
+
+auto Session::get_fd() const -> int {
+  if (peer != nullptr) {
+    return peer->fd;
+  }
+  if (_netsnmp_session == nullptr) {
+    return -1;
+  }
+  netsnmp_transport *transport = snmp_sess_transport(_netsnmp_session);
+  return transport == nullptr ? -1 : transport->sock;
+}
+
+void Session::write_sink() {
+  if (sink == nullptr || columns != nullptr || result_records == 0) {
+    return;
+  }
+  try {
+    sink->write(results);
+  } catch (std::exception const &e) {
+    auto error = append_error(SnmpError::SINK_ERROR, {}, {}, {}, {}, {},
+                              std::string(e.what()));
+    DB_TRACELOC(0, "SNMP_ERROR: %s\n", error.repr().c_str());
+    return;
+  }
+  DB_TRACELOC(0, "SESSION_WRITE_SINK: %zu records, %zu bytes\n",
+              result_records, results->get_size());
+  try {
+    start_results();
+  } catch (std::exception const &e) {
+    // the sink has the records, so they must not be returned again
+    results = nullptr;
+    fail(e.what());
   }
 }
 
 auto Session::get_response() -> SnmpResponse {
-  return (SnmpResponse){SnmpResponse::SUCCESSFUL, request, results, errors};
+  write_sink();
+  return (SnmpResponse){SnmpResponse::SUCCESSFUL, request, results, errors,
+                        stamps, columns};
 };
 
-void SessionManager::add_request(SnmpRequest const &request) {
-  DB_TRACELOC(0, "SESSION_MANAGER_ADD_REQUEST: %s\n", request.repr().c_str());
-  pending_requests.emplace_back(request.get_type(), request.get_host(),
-                                request.get_community(), request.get_oids(),
-                                request.get_ranges(), request.get_req_id(),
-                                config << request.get_config());
+auto Session::has_partial_response() const -> bool {
+  if (status == CLOSED || result_records == 0) {
+    return false;
+  }
+  // Arrow's 32-bit offsets cap a table, so hand off the columns before then
+  if (columns != nullptr && columns->is_near_offset_limit()) {
+    return true;
+  }
+  size_t bytes = *request.get_config()->get_partial_result_bytes();
+  size_t records = *request.get_config()->get_partial_result_records();
+  size_t size =
+      results->get_size() + (columns != nullptr ? columns->get_size() : 0);
+  return (bytes > 0 && size >= bytes) ||
+         (records > 0 && result_records >= records);
 }
 
-auto SessionManager::get_active_async_sessions_count() -> size_t {
-  return std::count_if(async_sessions.begin(), async_sessions.end(),
-                       [](auto const &session) {
-                         return session.get_status() != Session::CLOSED;
-                       });
+auto Session::take_partial_response() -> SnmpResponse {
+  DB_TRACELOC(0, "SESSION_PARTIAL_RESPONSE: %zu records, %zu bytes\n",
+              result_records, results->get_size());
+  write_sink();
+  SnmpResponse response(SnmpResponse::PARTIAL, request, std::move(results),
+                        std::move(errors), std::move(stamps),
+                        std::move(columns));
+  errors.clear();
+  stamps.clear();
+  try {
+    start_results();
+  } catch (std::exception const &e) {
+    fail(e.what());
+  }
+  return response;
+}
+
+void Session::fail(std::string const &message,
+                   std::optional<size_t> sys_errno,
+                   std::optional<size_t> snmp_errno) {
+  auto error = append_error(SnmpError::SESSION_ERROR, sys_errno, snmp_errno,
+                            {}, {}, {}, message);
+  DB_TRACELOC(0, "SNMP_ERROR: %s\n", error.repr().c_str());
+  status = CLOSED;
+  err_flag = true;
+  if (results == nullptr) {
+    // the results never started or could not restart; heap memory will not
+    // run out of shared memory again
+    results = std::make_shared<ResultBuffer>(pool);
+    append_header(*results,
+                  (uint8_t)*request.get_config()->get_wireline_version(),
+                  request.get_req_id(), request.get_oids());
+    result_records = 0;
+  }
 }
 
-auto SessionManager::get_max_async_sessions() -> size_t {
-  auto max_async_sessions = std::numeric_limits<size_t>::max();
-  for (auto &&session : async_sessions) {
-    if (session.get_status() != Session::CLOSED) {
-      max_async_sessions = std::min(
-          max_async_sessions,
-          *session.get_request().get_config()->get_max_async_sessions());
+Worker::Worker(size_t shared_sockets, size_t io_batch_size,
+               std::shared_ptr<SegmentPool> pool,
+               std::shared_ptr<ResultSink> sink)
+    : wake_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)), pool(std::move(pool)),
+      sink(std::move(sink)) {
+  if (wake_fd < 0) {
+    throw std::runtime_error("failed to create wake event: " +
+                             std::string(std::strerror(errno)));
+  }
+  // the destructor does not run for a constructor that throws
+  try {
+    reactor.add(wake_fd, &wake_fd);
+    if (shared_sockets > 0) {
+      transport =
+          std::make_unique<Transport>(reactor, shared_sockets, io_batch_size);
     }
+  } catch (...) {
+    close(wake_fd);
+    throw;
   }
-  return max_async_sessions;
+  netsnmp_large_fd_set_init(&read_fdset, FD_SETSIZE);
 }
 
-auto SessionManager::run() -> std::optional<std::vector<SnmpResponse>> {
-  DB_TRACELOC(0, "SESSION_MANAGER_RUN: %s\n", config.repr().c_str());
-  DB_TRACELOC(0, "SESSION_MANAGER_PRE_PENDING_REQUESTS: %zu\n",
-              get_pending_requests_count());
-  DB_TRACELOC(0, "SESSION_MANAGER_PRE_ASYNC_SESSIONS: %zu\n",
+Worker::~Worker() {
+  // sessions release their transports before the shared sockets close
+  async_sessions.clear();
+  transport.reset();
+  close(wake_fd);
+  netsnmp_large_fd_set_cleanup(&read_fdset);
+}
+
+auto Worker::get_active_async_sessions_count() const -> size_t {
+  return open_sessions.size();
+}
+
+auto Worker::get_max_async_sessions() const -> size_t {
+  return session_limits.empty() ? std::numeric_limits<size_t>::max()
+                                : *session_limits.begin();
+}
+
+auto Worker::can_admit(SnmpRequest const &request) const -> bool {
+  // check that adding another session will not exceed the maximum number of
+  // async sessions for those already active
+  return get_active_async_sessions_count() + 1 <=
+         std::min(get_max_async_sessions(),
+                  *request.get_config()->get_max_async_sessions());
+}
+
+void Worker::admit(SnmpRequest const &request, TokenBucket *bucket,
+                   CounterRates *counters, std::optional<size_t> job) {
+  auto &session = async_sessions.emplace_back(
+      request, transport.get(), pool, &rtt_estimators[request.get_host()],
+      bucket, counters, sink);
+  session.set_job(job);
+  open_sessions.emplace(&session, std::prev(async_sessions.end()));
+  session_limits.insert(*request.get_config()->get_max_async_sessions());
+  process(session, [this, &session] {
+    if (transport == nullptr && session.get_fd() >= 0) {
+      reactor.add(session.get_fd(), &session);
+    }
+  });
+}
+
+void Worker::update(Session &session) {
+  if (session.get_status() == Session::CLOSED) {
+    // only the first update of a closed session finds it open
+    auto it = open_sessions.find(&session);
+    if (it != open_sessions.end()) {
+      session_limits.erase(session_limits.find(
+          *session.get_request().get_config()->get_max_async_sessions()));
+      closed_sessions.push_back(it->second);
+      open_sessions.erase(it);
+      timers.cancel(&session);
+    }
+    return;
+  }
+  auto deadline = session.get_deadline();
+  if (deadline.has_value()) {
+    timers.schedule(&session, *deadline);
+  } else {
+    timers.cancel(&session);
+  }
+  if (session.get_status() == Session::IDLE) {
+    ready_sessions.push_back(&session);
+  }
+  if (session.has_partial_response()) {
+    partial_sessions.push_back(&session);
+  }
+}
+
+void Worker::fail(std::string const &message) {
+  // closing a session removes it from the open sessions
+  std::vector<Session *> failed;
+  failed.reserve(open_sessions.size());
+  for (auto &&open : open_sessions) {
+    failed.push_back(&*open.second);
+  }
+  for (Session *session : failed) {
+    session->fail(message);
+    update(*session);
+  }
+}
+
+void Worker::wake() {
+  uint64_t one = 1;
+  if (write(wake_fd, &one, sizeof(one)) < 0) {
+    DB_TRACELOC(0, "WORKER_WAKE_ERROR: %s\n", std::strerror(errno));
+  }
+}
+
+auto Worker::get_deadline() const
+    -> std::optional<std::chrono::steady_clock::time_point> {
+  return timers.get_deadline();
+}
+
+void Worker::step(std::vector<SnmpResponse> &responses, bool block,
+                  std::optional<std::chrono::steady_clock::time_point> until) {
+  DB_TRACELOC(0, "WORKER_PRE_ASYNC_SESSIONS: %zu\n",
               get_active_async_sessions_count());
 
-  py::gil_scoped_release release;
+  if (async_sessions.empty()) {
+    return;
+  }
+
+  // a failing reactor or shared transport closes every open session; the
+  // worker and its thread carry on
+  try {
+    // perform IO until at least one session has completed
+    bool woken = false;
+    while (!woken && closed_sessions.empty()) {
+      // send only from the sessions that became idle
+      sending_sessions.swap(ready_sessions);
+      for (Session *session : sending_sessions) {
+        process(*session, [session] { session->send(); });
+      }
+      sending_sessions.clear();
+
+      // a session may have closed on a send error
+      if (!closed_sessions.empty()) {
+        break;
+      }
 
-  // move pending requests to active until max async sessions is met
-  while (
-      // check that there are pending requests
-      !pending_requests.empty() &&
-      // check that adding another session will not exceed the maximum
-      // number of async sessions for those already active
-      get_active_async_sessions_count() + 1 <=
-          std::min(get_max_async_sessions(), *pending_requests.front()
-                                                  .get_config()
-                                                  ->get_max_async_sessions())) {
-    async_sessions.emplace_back(pending_requests.front());
-    pending_requests.pop_front();
+      // send everything queued this round in as few syscalls as possible
+      if (transport != nullptr) {
+        transport->flush();
+      }
+
+      // wait on every socket at once until the earliest deadline, or only poll
+      // them when not blocking
+      std::optional<std::chrono::steady_clock::time_point> deadline =
+          block ? get_deadline() : std::chrono::steady_clock::now();
+      if (until.has_value() && (!deadline.has_value() || *until < *deadline)) {
+        deadline = until;
+      }
+      size_t ready = reactor.wait(deadline);
+
+      // dispatch reads only to the sessions with data; shared sockets are
+      // demultiplexed to their sessions by the transport
+      for (size_t i = 0; i < ready; ++i) {
+        void *ptr = reactor.get_ready(i);
+        if (ptr == &wake_fd) {
+          uint64_t count;
+          if (read(wake_fd, &count, sizeof(count)) > 0) {
+            woken = true;
+          }
+        } else if (transport != nullptr && ptr == transport.get()) {
+          // a blocked shared socket drained; send what it held back
+          uint32_t events = reactor.get_ready_events(i);
+          if ((events & EPOLLOUT) != 0) {
+            transport->flush();
+          }
+          if ((events & ~EPOLLOUT) != 0) {
+            transport->receive(
+                [this](Session &session, uint8_t const *data, size_t size) {
+                  process(session, [&] { session.read(data, size); });
+                });
+          }
+        } else {
+          auto *session = static_cast<Session *>(ptr);
+          process(*session, [this, session] { session->read(read_fdset); });
+        }
+      }
+
+      // retry or timeout only the sessions past their deadline
+      timers.expire(std::chrono::steady_clock::now(), expired_timers);
+      for (void *ptr : expired_timers) {
+        auto *session = static_cast<Session *>(ptr);
+        process(*session, [session] { session->timeout(); });
+      }
+      expired_timers.clear();
+
+      // hand off partial responses as soon as a threshold is reached
+      if (!partial_sessions.empty()) {
+        break;
+      }
+
+      if (!block || (until.has_value() &&
+                     std::chrono::steady_clock::now() >= *until)) {
+        break;
+      }
+    }
+
+    // do not hold back messages queued before the loop exited
+    if (transport != nullptr) {
+      transport->flush();
+    }
+  } catch (std::exception const &e) {
+    DB_TRACELOC(0, "WORKER_ERROR: %s\n", e.what());
+    sending_sessions.clear();
+    expired_timers.clear();
+    fail(e.what());
   }
 
-  DB_TRACELOC(0, "SESSION_MANAGER_POST_PENDING_REQUESTS: %zu\n",
-              get_pending_requests_count());
-  DB_TRACELOC(0, "SESSION_MANAGER_POST_ASYNC_SESSIONS: %zu\n",
+  // collect partial results from the sessions still collecting, then the
+  // results of the completed sessions
+  for (Session *session : partial_sessions) {
+    if (session->has_partial_response()) {
+      responses.push_back(session->take_partial_response());
+    }
+  }
+  partial_sessions.clear();
+  if (!closed_sessions.empty()) {
+    ready_sessions.erase(std::remove_if(ready_sessions.begin(),
+                                        ready_sessions.end(),
+                                        [](Session const *session) {
+                                          return session->get_status() ==
+                                                 Session::CLOSED;
+                                        }),
+                         ready_sessions.end());
+  }
+  for (auto it : closed_sessions) {
+    if (transport == nullptr && it->get_fd() >= 0) {
+      reactor.remove(it->get_fd());
+    }
+    responses.push_back(it->get_response());
+    if (it->get_job().has_value()) {
+      finished_jobs.push_back(*it->get_job());
+    }
+    async_sessions.erase(it);
+  }
+  closed_sessions.clear();
+
+  DB_TRACELOC(0, "WORKER_POST_ASYNC_SESSIONS: %zu\n",
               get_active_async_sessions_count());
+}
 
+void Worker::take_finished_jobs(std::vector<size_t> &jobs) {
+  jobs.insert(jobs.end(), finished_jobs.begin(), finished_jobs.end());
+  finished_jobs.clear();
+}
+
+SessionManager::SessionManager(std::optional<Config> const &config,
+                               size_t shared_sockets, size_t io_batch_size,
+                               size_t threads, size_t result_segment_bytes,
+                               size_t max_host_sessions,
+                               double max_host_pdus_per_second,
+                               size_t ipv4_prefix_length,
+                               size_t ipv6_prefix_length,
+                               std::shared_ptr<ResultSink> sink)
+    : config(get_default_config() << config),
+      max_host_sessions(max_host_sessions),
+      max_host_pdus_per_second(max_host_pdus_per_second),
+      ipv4_prefix_length(ipv4_prefix_length),
+      ipv6_prefix_length(ipv6_prefix_length), waiting_requests(0),
+      admitting(0), next_job_id(1), random(std::random_device()()),
+      pool(std::make_shared<SegmentPool>(result_segment_bytes)),
+      busy_workers(0), stopping(false),
+      notify_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+  if (io_batch_size > 0 && shared_sockets == 0) {
+    close(notify_fd);
+    throw std::invalid_argument("io_batch_size requires shared_sockets");
+  }
+  if (max_host_pdus_per_second < 0) {
+    close(notify_fd);
+    throw std::invalid_argument("max_host_pdus_per_second must not be "
+                                "negative");
+  }
+  if (notify_fd < 0) {
+    throw std::runtime_error("failed to create notify event: " +
+                             std::string(std::strerror(errno)));
+  }
+
+  // initialize the NET-SNMP library state once before any worker opens a
+  // session
+  netsnmp_session session;
+  snmp_sess_init(&session);
+
+  // the destructor does not run for a constructor that throws, so stop the
+  // threads already started and release the notify event here
+  try {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+      workers.push_back(
+          std::make_unique<Worker>(shared_sockets, io_batch_size, pool, sink));
+    }
+    worker_io_stats.resize(workers.size());
+    spare_capacity.resize(workers.size());
+    for (size_t i = 0; i < threads; ++i) {
+      this->threads.emplace_back(&SessionManager::work, this, i);
+    }
+  } catch (...) {
+    stop();
+    throw;
+  }
+}
+
+SessionManager::~SessionManager() {
+  // a worker in a python sink callback waits for the GIL, so joining it
+  // while holding the GIL would never return
+  std::optional<py::gil_scoped_release> release;
+  if (PyGILState_Check() != 0) {
+    release.emplace();
+  }
+  stop();
+}
+
+void SessionManager::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  pending_cv.notify_all();
+  for (auto &&worker : workers) {
+    worker->wake();
+  }
+  for (auto &&thread : threads) {
+    thread.join();
+  }
+  close(notify_fd);
+}
+
+void SessionManager::add_request(SnmpRequest const &request) {
+  DB_TRACELOC(0, "SESSION_MANAGER_ADD_REQUEST: %s\n", request.repr().c_str());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending_requests.push_back(
+        {SnmpRequest(request.get_type(), request.get_host(),
+                     request.get_community(), request.get_oids(),
+                     request.get_ranges(), request.get_req_id(),
+                     config << request.get_config()),
+         std::nullopt});
+    signal_pending();
+  }
+}
+
+auto SessionManager::add_job(SnmpRequest const &request, double interval,
+                             double phase_jitter,
+                             MissedDeadlinePolicy missed_deadline) -> size_t {
+  if (!(interval > 0)) {
+    throw std::invalid_argument("interval must be greater than 0");
+  }
+  if (!(phase_jitter >= 0 && phase_jitter <= 1)) {
+    throw std::invalid_argument("phase_jitter must be within [0, 1]");
+  }
+  DB_TRACELOC(0, "SESSION_MANAGER_ADD_JOB: %f: %s\n", interval,
+              request.repr().c_str());
+
+  size_t id;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    id = next_job_id++;
+    std::chrono::duration<double> period(interval);
+    auto phase =
+        std::uniform_real_distribution<double>(0, phase_jitter)(random);
+    Job job{SnmpRequest(request.get_type(), request.get_host(),
+                        request.get_community(), request.get_oids(),
+                        request.get_ranges(), request.get_req_id(),
+                        config << request.get_config()),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(period),
+            missed_deadline,
+            std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::nanoseconds>(period *
+                                                                     phase),
+            0,
+            false};
+    job_queue.emplace(job.next, id);
+    jobs.emplace(id, std::move(job));
+  }
+
+  // idle workers and workers blocked in a step wait on the new due time
+  pending_cv.notify_all();
+  for (auto &&worker : workers) {
+    worker->wake();
+  }
+  return id;
+}
+
+auto SessionManager::remove_job(size_t id) -> bool {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    if (it == jobs.end()) {
+      return false;
+    }
+    job_queue.erase({it->second.next, id});
+    jobs.erase(it);
+  }
+  // `run` may be waiting only on the jobs
+  completed_cv.notify_all();
+  notify();
+  return true;
+}
+
+auto SessionManager::get_jobs_count() -> size_t {
+  std::lock_guard<std::mutex> lock(mutex);
+  return jobs.size();
+}
+
+void SessionManager::start_job(size_t id, Job &job) {
+  DB_TRACELOC(0, "SESSION_MANAGER_START_JOB: %zu\n", id);
+  pending_requests.push_back({job.request, id});
+  job.running++;
+  pending_cv.notify_one();
+}
+
+void SessionManager::run_jobs(std::chrono::steady_clock::time_point now) {
+  while (!job_queue.empty() && job_queue.begin()->first <= now) {
+    size_t id = job_queue.begin()->second;
+    job_queue.erase(job_queue.begin());
+    Job &job = jobs.at(id);
+
+    if (job.running == 0 || job.missed_deadline == OVERLAP) {
+      start_job(id, job);
+    } else if (job.missed_deadline == DEFER) {
+      job.deferred = true;
+    } else {
+      DB_TRACELOC(0, "SESSION_MANAGER_SKIP_JOB: %zu\n", id);
+    }
+
+    // stay on the job's phase, coalescing the polls missed meanwhile
+    job.next += ((now - job.next) / job.interval + 1) * job.interval;
+    job_queue.emplace(job.next, id);
+  }
+}
+
+void SessionManager::finish_jobs(Worker &worker) {
+  std::vector<size_t> finished;
+  worker.take_finished_jobs(finished);
+  for (size_t id : finished) {
+    auto it = jobs.find(id);
+    if (it == jobs.end()) {
+      continue;
+    }
+    Job &job = it->second;
+    job.running--;
+    if (job.deferred && job.running == 0) {
+      job.deferred = false;
+      start_job(id, job);
+    }
+  }
+}
+
+auto SessionManager::get_next_job() const
+    -> std::optional<std::chrono::steady_clock::time_point> {
+  if (job_queue.empty()) {
+    return std::nullopt;
+  }
+  return job_queue.begin()->first;
+}
+
+auto SessionManager::get_pending_requests_count() -> size_t {
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending_requests.size() + ready_requests.size() + waiting_requests +
+         admitting;
+}
+
+auto SessionManager::has_pending_requests() const -> bool {
+  return !pending_requests.empty() || !ready_requests.empty() ||
+         waiting_requests > 0 || admitting > 0;
+}
+
+auto SessionManager::get_io_stats() -> IoStats {
+  std::lock_guard<std::mutex> lock(mutex);
+  IoStats stats;
+  for (auto &&worker_stats : worker_io_stats) {
+    stats = stats + worker_stats;
+  }
+  return stats;
+}
+
+void SessionManager::admit_requests(std::unique_lock<std::mutex> &lock,
+                                    Worker &worker) {
+  run_jobs(std::chrono::steady_clock::now());
+
+  // move pending requests to active until max async sessions is met;
+  // released requests go first as their host session is already reserved
+  while (!stopping) {
+    bool released = !ready_requests.empty();
+    auto &queue = released ? ready_requests : pending_requests;
+    if (queue.empty() || !worker.can_admit(queue.front().request)) {
+      break;
+    }
+    PendingRequest pending = std::move(queue.front());
+    queue.pop_front();
+    SnmpRequest const &request = pending.request;
+
+    TokenBucket *bucket = nullptr;
+    if (max_host_sessions > 0 || max_host_pdus_per_second > 0) {
+      HostState &host = hosts[get_host_key(
+          request.get_host(), ipv4_prefix_length, ipv6_prefix_length)];
+      if (!released) {
+        // park the request on its host instead of blocking the queue
+        if (max_host_sessions > 0 && host.sessions >= max_host_sessions) {
+          DB_TRACELOC(0, "SESSION_MANAGER_HOST_WAIT: %s\n",
+                      request.repr().c_str());
+          host.waiting.push_back(std::move(pending));
+          waiting_requests++;
+          continue;
+        }
+        host.sessions++;
+      }
+      if (max_host_pdus_per_second > 0) {
+        if (host.bucket == nullptr) {
+          host.bucket = std::make_unique<TokenBucket>(
+              max_host_pdus_per_second, max_host_pdus_per_second);
+        }
+        bucket = host.bucket.get();
+      }
+    }
+
+    CounterRates *counters = nullptr;
+    if (*request.get_config()->get_counter_rates()) {
+      auto &rates = counter_rates[request.get_host()];
+      if (rates == nullptr) {
+        rates = std::make_unique<CounterRates>();
+      }
+      counters = rates.get();
+    }
+
+    // opening a session may block on name resolution; the request stays
+    // counted as pending meanwhile so `run` does not see the work as done
+    admitting++;
+    lock.unlock();
+    try {
+      worker.admit(request, bucket, counters, pending.job);
+    } catch (...) {
+      lock.lock();
+      admitting--;
+      throw;
+    }
+    lock.lock();
+    admitting--;
+  }
+}
+
+void SessionManager::release_hosts(
+    std::vector<SnmpResponse> const &responses) {
+  if (max_host_sessions == 0 && max_host_pdus_per_second <= 0) {
+    return;
+  }
+  for (auto &&response : responses) {
+    if (response.get_type() == SnmpResponse::PARTIAL) {
+      continue;
+    }
+    auto it = hosts.find(get_host_key(response.get_request().get_host(),
+                                      ipv4_prefix_length, ipv6_prefix_length));
+    if (it == hosts.end()) {
+      continue;
+    }
+    HostState &host = it->second;
+    if (host.waiting.empty()) {
+      host.sessions--;
+      continue;
+    }
+    // hand the session over to the next waiting request
+    ready_requests.push_back(std::move(host.waiting.front()));
+    host.waiting.pop_front();
+    waiting_requests--;
+    signal_pending();
+  }
+}
+
+void SessionManager::signal_pending() {
+  pending_cv.notify_one();
+  // without threads, `run` or `step` admits the requests once woken
+  if (threads.empty()) {
+    workers.front()->wake();
+    return;
+  }
+  // a worker with sessions waits on its sockets, not the condition variable;
+  // waking one per step is enough as it admits all it can fit
+  for (size_t i = 0; i < threads.size(); ++i) {
+    if (spare_capacity[i]) {
+      spare_capacity[i] = false;
+      workers[i]->wake();
+      return;
+    }
+  }
+}
+
+void SessionManager::notify() {
+  uint64_t one = 1;
+  if (write(notify_fd, &one, sizeof(one)) < 0) {
+    DB_TRACELOC(0, "SESSION_MANAGER_NOTIFY_ERROR: %s\n", std::strerror(errno));
+  }
+}
+
+void SessionManager::work(size_t index) {
+  DB_TRACELOC(0, "SESSION_MANAGER_WORKER_START: %zu\n", index);
+  Worker &worker = *workers[index];
+  bool busy = false;
   std::vector<SnmpResponse> responses;
 
-  if (!async_sessions.empty()) {
-    // perform IO until at least one session has completed
-    while (async_sessions.size() == get_active_async_sessions_count()) {
-      for (auto &&session : async_sessions) {
-        session.send();
+  std::unique_lock<std::mutex> lock(mutex);
+  // an escaping exception would terminate the process; close the worker's
+  // sessions instead so their responses report the error
+  auto recover = [&](char const *message) {
+    if (!lock.owns_lock()) {
+      lock.lock();
+    }
+    DB_TRACELOC(0, "SESSION_MANAGER_WORKER_ERROR: %zu: %s\n", index, message);
+    worker.fail(message);
+  };
+  while (!stopping) {
+    try {
+      admit_requests(lock, worker);
+
+      // idle until there is more work; the admitted requests are counted until
+      // the worker becomes busy under the same lock, so `run` never sees the
+      // work as finished early, and sessions that closed while being admitted
+      // are collected by the next step
+      if (!worker.has_sessions()) {
+        if (busy) {
+          busy = false;
+          busy_workers--;
+          completed_cv.notify_all();
+          notify();
+        }
+        auto ready = [this] {
+          return stopping || !pending_requests.empty() ||
+                 !ready_requests.empty();
+        };
+        auto next_job = get_next_job();
+        if (next_job.has_value()) {
+          pending_cv.wait_until(lock, *next_job, ready);
+        } else {
+          pending_cv.wait(lock, ready);
+        }
+        continue;
+      }
+      if (!busy) {
+        busy = true;
+        busy_workers++;
       }
-      for (auto &&session : async_sessions) {
-        session.read();
+
+      auto next_job = get_next_job();
+      spare_capacity[index] = worker.get_active_async_sessions_count() <
+                              worker.get_max_async_sessions();
+      lock.unlock();
+      worker.step(responses, true, next_job);
+      lock.lock();
+      spare_capacity[index] = false;
+
+      // publish the completed responses
+      release_hosts(responses);
+      finish_jobs(worker);
+      std::move(responses.begin(), responses.end(),
+                std::back_inserter(completed));
+      responses.clear();
+      worker_io_stats[index] = worker.get_io_stats();
+      completed_cv.notify_all();
+      if (!completed.empty()) {
+        notify();
       }
+    } catch (std::exception const &e) {
+      recover(e.what());
+    } catch (...) {
+      recover("unknown error");
     }
+  }
+  DB_TRACELOC(0, "SESSION_MANAGER_WORKER_STOP: %zu\n", index);
+}
+
+auto SessionManager::run() -> std::optional<std::vector<SnmpResponse>> {
+  DB_TRACELOC(0, "SESSION_MANAGER_RUN: %s\n", config.repr().c_str());
+  DB_TRACELOC(0, "SESSION_MANAGER_PRE_PENDING_REQUESTS: %zu\n",
+              get_pending_requests_count());
+
+  py::gil_scoped_release release;
 
-    // collect results from completed sessions
-    for (auto it = async_sessions.begin(); it != async_sessions.end();) {
-      if (it->get_status() == Session::CLOSED) {
-        responses.push_back(it->get_response());
-        it = async_sessions.erase(it);
-        --it;
+  std::vector<SnmpResponse> responses;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  if (threads.empty()) {
+    // run the only worker on this thread
+    Worker &worker = *workers.front();
+    while (true) {
+      admit_requests(lock, worker);
+      auto next_job = get_next_job();
+      lock.unlock();
+      worker.step(responses, true, next_job);
+      lock.lock();
+      release_hosts(responses);
+      finish_jobs(worker);
+      worker_io_stats.front() = worker.get_io_stats();
+      if (!responses.empty()) {
+        break;
+      }
+      // a wake returns from the step early; keep going while there is work
+      if (worker.has_sessions() || has_pending_requests()) {
+        continue;
+      }
+      if (!next_job.has_value()) {
+        break;
       }
+      // idle until the next job is due or a request or an earlier job is added
+      pending_cv.wait_until(lock, *next_job, [this, &next_job] {
+        return !pending_requests.empty() || get_next_job() != next_job;
+      });
     }
+  } else {
+    // wait for the workers to complete at least one request or run dry
+    completed_cv.wait(lock, [this] {
+      return !completed.empty() || (!has_pending_requests() &&
+                                    busy_workers == 0 && jobs.empty());
+    });
+    std::move(completed.begin(), completed.end(),
+              std::back_inserter(responses));
+    completed.clear();
   }
 
+  DB_TRACELOC(0, "SESSION_MANAGER_POST_PENDING_REQUESTS: %zu\n",
+              pending_requests.size() + ready_requests.size() +
+                  waiting_requests);
+
+  lock.unlock();
   py::gil_scoped_acquire acquire;
 
   return responses.empty()
@@ -702,4 +2006,66 @@ auto SessionManager::run() -> std::optional<std::vector<SnmpResponse>> {
              : responses;
 }
 
+auto SessionManager::get_fd() const -> int {
+  return threads.empty() ? workers.front()->get_fd() : notify_fd;
+}
+
+auto SessionManager::get_timeout() -> std::optional<double> {
+  if (!threads.empty()) {
+    return std::nullopt;
+  }
+  auto deadline = workers.front()->get_deadline();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto next_job = get_next_job();
+    if (next_job.has_value() &&
+        (!deadline.has_value() || *next_job < *deadline)) {
+      deadline = next_job;
+    }
+  }
+  if (!deadline.has_value()) {
+    return std::nullopt;
+  }
+  return std::max(std::chrono::duration<double>(
+                      *deadline - std::chrono::steady_clock::now())
+                      .count(),
+                  0.0);
+}
+
+auto SessionManager::step() -> std::optional<std::vector<SnmpResponse>> {
+  std::vector<SnmpResponse> responses;
+  std::unique_lock<std::mutex> lock(mutex);
+
+  if (threads.empty()) {
+    // one non-blocking pass of the only worker on this thread
+    Worker &worker = *workers.front();
+    admit_requests(lock, worker);
+    lock.unlock();
+    worker.step(responses, false);
+    lock.lock();
+    release_hosts(responses);
+    finish_jobs(worker);
+    worker_io_stats.front() = worker.get_io_stats();
+    if (responses.empty() && !has_pending_requests() && jobs.empty() &&
+        worker.get_active_async_sessions_count() == 0) {
+      return std::nullopt;
+    }
+  } else {
+    // consume the notification before taking the responses so none are missed
+    uint64_t count;
+    if (read(notify_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+      DB_TRACELOC(0, "SESSION_MANAGER_STEP_ERROR: %s\n", std::strerror(errno));
+    }
+    std::move(completed.begin(), completed.end(),
+              std::back_inserter(responses));
+    completed.clear();
+    if (responses.empty() && !has_pending_requests() && busy_workers == 0 &&
+        jobs.empty()) {
+      return std::nullopt;
+    }
+  }
+
+  return responses;
+}
+
 } // namespace snmp_stream
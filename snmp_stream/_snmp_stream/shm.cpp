@@ -0,0 +1,121 @@
+// snmp_stream/_snmp_stream/shm.cpp
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern "C" {
+#include <debug.h>
+}
+
+#include "shm.hpp"
+
+namespace snmp_stream {
+
+/*!
+  Map a shared memory object.
+
+  \exception std::runtime_error The object could not be mapped.
+
+  \return `uint8_t *`
+*/
+[[nodiscard]] static auto map_segment(int fd,     //!< Shared memory object.
+                                      size_t size //!< Bytes to map.
+                                      ) -> uint8_t * {
+  void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("failed to map shared memory: " +
+                             std::string(std::strerror(errno)));
+  }
+  return (uint8_t *)data;
+}
+
+SharedSegment::SharedSegment(size_t size)
+    : data(nullptr), size(size), created(true), linked(true) {
+  static std::atomic<uint64_t> counter(0);
+  if (size < 1) {
+    throw std::invalid_argument("size must be greater than 0");
+  }
+
+  // names left behind by a previous process with the same pid are skipped
+  int fd = -1;
+  while (fd < 0) {
+    name = std::string(SHARED_SEGMENT_PREFIX) + "." +
+           std::to_string(getpid()) + "." + std::to_string(counter++);
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno != EEXIST) {
+      throw std::runtime_error("failed to create shared memory: " +
+                               std::string(std::strerror(errno)));
+    }
+  }
+  // reserve the pages up front; tmpfs sizes lazily, so a full /dev/shm would
+  // otherwise raise SIGBUS on a later write instead of an error here
+  int error;
+  do {
+    error = posix_fallocate(fd, 0, (off_t)size);
+  } while (error == EINTR);
+  if (error != 0) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw std::runtime_error("failed to allocate shared memory: " +
+                             std::string(std::strerror(error)));
+  }
+  try {
+    data = map_segment(fd, size);
+  } catch (std::runtime_error const &) {
+    close(fd);
+    shm_unlink(name.c_str());
+    throw;
+  }
+  close(fd);
+  DB_TRACELOC(0, "SHARED_SEGMENT_CREATE: %s, %zu bytes\n", name.c_str(),
+              size);
+}
+
+SharedSegment::SharedSegment(std::string name, size_t size)
+    : name(std::move(name)), data(nullptr), size(size), created(false),
+      linked(false) {
+  if (this->name.rfind(SHARED_SEGMENT_PREFIX, 0) != 0) {
+    throw std::invalid_argument("not a shared result segment: " + this->name);
+  }
+  int fd = shm_open(this->name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    throw std::runtime_error("failed to open shared memory " + this->name +
+                             ": " + std::string(std::strerror(errno)));
+  }
+  // the name is only needed to find the segment once
+  shm_unlink(this->name.c_str());
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < size) {
+    close(fd);
+    throw std::runtime_error("shared memory " + this->name +
+                             " is smaller than the results");
+  }
+  // an empty mapping is not allowed; keep one byte mapped
+  try {
+    data = map_segment(fd, size > 0 ? size : 1);
+  } catch (std::runtime_error const &) {
+    close(fd);
+    throw;
+  }
+  close(fd);
+  DB_TRACELOC(0, "SHARED_SEGMENT_OPEN: %s, %zu bytes\n", this->name.c_str(),
+              size);
+}
+
+SharedSegment::~SharedSegment() {
+  if (data != nullptr) {
+    munmap(data, size > 0 ? size : 1);
+  }
+  if (linked) {
+    shm_unlink(name.c_str());
+  }
+}
+
+} // namespace snmp_stream
@@ -0,0 +1,159 @@
+// snmp_stream/_snmp_stream/sink.cpp
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/uio.h>
+
+extern "C" {
+#include <debug.h>
+}
+
+#include "sink.hpp"
+
+namespace snmp_stream {
+
+void MemoryResultSink::write(std::shared_ptr<ResultBuffer> const &results) {
+  std::lock_guard<std::mutex> guard(mutex);
+  buffers.push_back(results);
+}
+
+auto MemoryResultSink::take() -> std::vector<std::shared_ptr<ResultBuffer>> {
+  std::lock_guard<std::mutex> guard(mutex);
+  return std::move(buffers);
+}
+
+FdResultSink::FdResultSink(int fd, size_t batch_bytes)
+    : fd(fd), batch_bytes(batch_bytes), staged_bytes(0) {
+  if (fd < 0) {
+    throw std::invalid_argument("fd must not be negative");
+  }
+}
+
+FdResultSink::~FdResultSink() {
+  try {
+    flush();
+  } catch (std::runtime_error const &e) {
+    DB_TRACELOC(0, "FD_RESULT_SINK_FLUSH_ERROR: %s\n", e.what());
+  }
+}
+
+void FdResultSink::write(std::shared_ptr<ResultBuffer> const &results) {
+  std::lock_guard<std::mutex> guard(mutex);
+  uint64_t size = results->get_size();
+  uint8_t frame[sizeof(size)];
+  for (size_t i = 0; i < sizeof(size); ++i) {
+    frame[i] = (uint8_t)(size >> (8 * i));
+  }
+  staged.push_back({results, 0, 0});
+  std::memcpy(&staged.back().frame, frame, sizeof(frame));
+  staged_bytes += sizeof(size) + size;
+  if (staged_bytes < batch_bytes) {
+    return;
+  }
+  try {
+    write_staged();
+  } catch (std::runtime_error const &e) {
+    // untouched results go back to the caller, a torn frame must be finished
+    if (!staged.empty() && staged.back().results == results &&
+        staged.back().written == 0) {
+      staged_bytes -= sizeof(size) + size;
+      staged.pop_back();
+      throw;
+    }
+    DB_TRACELOC(0, "FD_RESULT_SINK_DEFER: %zu bytes, %s\n", staged_bytes,
+                e.what());
+  }
+}
+
+void FdResultSink::flush() {
+  std::lock_guard<std::mutex> guard(mutex);
+  write_staged();
+}
+
+void FdResultSink::write_staged() {
+  if (staged.empty()) {
+    return;
+  }
+  DB_TRACELOC(0, "FD_RESULT_SINK_WRITE: %zu buffers, %zu bytes\n",
+              staged.size(), staged_bytes);
+
+  // gather what is left of the frame and segments of every staged buffer;
+  // the buffers stay staged, and their segments out of the pool, until
+  // written
+  std::vector<iovec> iov;
+  for (auto &buffer : staged) {
+    size_t skip = buffer.written;
+    if (skip < sizeof(buffer.frame)) {
+      iov.push_back({(uint8_t *)&buffer.frame + skip,
+                     sizeof(buffer.frame) - skip});
+      skip = 0;
+    } else {
+      skip -= sizeof(buffer.frame);
+    }
+    for (size_t j = 0; j < buffer.results->get_segment_count(); ++j) {
+      auto [data, size] = buffer.results->get_segment(j);
+      if (size <= skip) {
+        skip -= size;
+        continue;
+      }
+      iov.push_back({const_cast<uint8_t *>(data) + skip, size - skip});
+      skip = 0;
+    }
+  }
+
+  size_t pos = 0;
+  while (pos < iov.size()) {
+    int count = (int)std::min<size_t>(iov.size() - pos, IOV_MAX);
+    ssize_t written = writev(fd, &iov[pos], count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("failed to write results: " +
+                               std::string(std::strerror(errno)));
+    }
+    // skip what was written and resume a partial write mid-vector
+    auto remaining = (size_t)written;
+    while (pos < iov.size() && remaining >= iov[pos].iov_len) {
+      remaining -= iov[pos].iov_len;
+      pos++;
+    }
+    if (remaining > 0) {
+      iov[pos].iov_base = (uint8_t *)iov[pos].iov_base + remaining;
+      iov[pos].iov_len -= remaining;
+    }
+    // release the buffers written so far; later iovecs stay valid
+    consume((size_t)written);
+  }
+}
+
+void FdResultSink::consume(size_t bytes) {
+  while (bytes > 0 && !staged.empty()) {
+    Staged &front = staged.front();
+    size_t left =
+        sizeof(front.frame) + front.results->get_size() - front.written;
+    if (bytes < left) {
+      front.written += bytes;
+      staged_bytes -= bytes;
+      return;
+    }
+    bytes -= left;
+    staged_bytes -= left;
+    staged.pop_front();
+  }
+}
+
+CallbackResultSink::CallbackResultSink(Callback callback)
+    : callback(std::move(callback)) {}
+
+void CallbackResultSink::write(std::shared_ptr<ResultBuffer> const &results) {
+  std::lock_guard<std::mutex> guard(mutex);
+  callback(results);
+}
+
+} // namespace snmp_stream
@@ -0,0 +1,152 @@
+// snmp_stream/_snmp_stream/timer.cpp
+
+#include <algorithm>
+
+#include "timer.hpp"
+
+namespace snmp_stream {
+
+static constexpr std::chrono::microseconds TICK(TIMER_TICK_US);
+
+TimingWheel::TimingWheel()
+    : origin(std::chrono::steady_clock::now()), now(0), occupied() {}
+
+auto TimingWheel::get_list(Timer const &timer) -> std::list<void *> & {
+  return timer.level < TIMER_WHEEL_LEVELS ? slots[timer.level][timer.slot]
+                                          : due;
+}
+
+void TimingWheel::place(Timer &timer) {
+  std::list<void *> &from = get_list(timer);
+  size_t from_level = timer.level;
+  size_t from_slot = timer.slot;
+
+  std::list<void *> *to = &due;
+  timer.level = TIMER_WHEEL_LEVELS;
+  if (timer.tick > now) {
+    // park timers beyond the top level in its furthest slot
+    size_t top_shift = TIMER_WHEEL_BITS * (TIMER_WHEEL_LEVELS - 1);
+    uint64_t tick = std::min<uint64_t>(
+        timer.tick, ((now >> top_shift) + SLOTS - 1) << top_shift);
+    // the lowest level whose next level up is in the same rotation
+    size_t level = 0;
+    while (level + 1 < TIMER_WHEEL_LEVELS &&
+           (tick >> (TIMER_WHEEL_BITS * (level + 1))) !=
+               (now >> (TIMER_WHEEL_BITS * (level + 1)))) {
+      level++;
+    }
+    timer.level = level;
+    timer.slot = (tick >> (TIMER_WHEEL_BITS * level)) & (SLOTS - 1);
+    occupied[level] |= uint64_t(1) << timer.slot;
+    to = &slots[level][timer.slot];
+  }
+
+  to->splice(to->end(), from, timer.position);
+  if (from_level < TIMER_WHEEL_LEVELS && from.empty()) {
+    occupied[from_level] &= ~(uint64_t(1) << from_slot);
+  }
+}
+
+auto TimingWheel::get_next_tick() const -> std::optional<uint64_t> {
+  // the lowest occupied level holds the next event: its slots all come due
+  // before the level above next cascades
+  for (size_t level = 0; level < TIMER_WHEEL_LEVELS; ++level) {
+    if (occupied[level] == 0) {
+      continue;
+    }
+    size_t shift = TIMER_WHEEL_BITS * level;
+    size_t rotate = ((now >> shift) + 1) & (SLOTS - 1);
+    uint64_t bits = occupied[level];
+    if (rotate > 0) {
+      bits = (bits >> rotate) | (bits << (SLOTS - rotate));
+    }
+    uint64_t distance = __builtin_ctzll(bits) + 1;
+    return ((now >> shift) + distance) << shift;
+  }
+  return std::nullopt;
+}
+
+void TimingWheel::schedule(void *key,
+                           std::chrono::steady_clock::time_point deadline) {
+  // round up so timers never expire early
+  uint64_t tick = 0;
+  if (deadline > origin) {
+    tick = (deadline - origin + TICK - std::chrono::nanoseconds(1)) / TICK;
+  }
+
+  auto it = timers.find(key);
+  if (it == timers.end()) {
+    due.push_back(key);
+    it = timers
+             .emplace(key, Timer{tick, TIMER_WHEEL_LEVELS, 0,
+                                 std::prev(due.end())})
+             .first;
+  } else if (it->second.tick == tick) {
+    return;
+  } else {
+    it->second.tick = tick;
+  }
+  place(it->second);
+}
+
+void TimingWheel::cancel(void *key) {
+  auto it = timers.find(key);
+  if (it == timers.end()) {
+    return;
+  }
+  Timer &timer = it->second;
+  std::list<void *> &list = get_list(timer);
+  list.erase(timer.position);
+  if (timer.level < TIMER_WHEEL_LEVELS && list.empty()) {
+    occupied[timer.level] &= ~(uint64_t(1) << timer.slot);
+  }
+  timers.erase(it);
+}
+
+auto TimingWheel::get_deadline() const
+    -> std::optional<std::chrono::steady_clock::time_point> {
+  if (!due.empty()) {
+    return origin + now * TICK;
+  }
+  auto tick = get_next_tick();
+  if (!tick.has_value()) {
+    return std::nullopt;
+  }
+  return origin + *tick * TICK;
+}
+
+void TimingWheel::expire(std::chrono::steady_clock::time_point time,
+                         std::vector<void *> &expired) {
+  uint64_t target = time > origin ? (time - origin) / TICK : 0;
+
+  // jump from event to event instead of walking every tick
+  for (auto tick = get_next_tick(); tick.has_value() && *tick <= target;
+       tick = get_next_tick()) {
+    now = *tick;
+    // cascade the higher levels whose slot starts now, top down
+    for (size_t level = TIMER_WHEEL_LEVELS - 1; level > 0; --level) {
+      size_t shift = TIMER_WHEEL_BITS * level;
+      if ((now & ((uint64_t(1) << shift) - 1)) != 0) {
+        continue;
+      }
+      auto &slot = slots[level][(now >> shift) & (SLOTS - 1)];
+      while (!slot.empty()) {
+        place(timers.at(slot.front()));
+      }
+    }
+    // level 0 timers in the current slot expire now
+    auto &slot = slots[0][now & (SLOTS - 1)];
+    while (!slot.empty()) {
+      place(timers.at(slot.front()));
+    }
+  }
+  now = std::max(now, target);
+
+  for (void *key : due) {
+    expired.push_back(key);
+    timers.erase(key);
+  }
+  due.clear();
+}
+
+} // namespace snmp_stream
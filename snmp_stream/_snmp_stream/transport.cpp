@@ -0,0 +1,397 @@
+// snmp_stream/_snmp_stream/transport.cpp
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <boost/format.hpp>
+
+extern "C" {
+#include <debug.h>
+}
+
+#include "ber.hpp"
+#include "session.hpp"
+#include "transport.hpp"
+#include "utils.hpp"
+
+// largest UDP payload
+#define MAX_DATAGRAM_BYTES 65535
+
+// requested kernel receive buffer for a shared socket (capped by rmem_max)
+#define SHARED_SOCKET_RCVBUF_BYTES (8 * 1024 * 1024)
+
+namespace snmp_stream {
+
+auto resolve_peer(std::string const &peername)
+    -> std::optional<std::pair<sockaddr_storage, socklen_t>> {
+  std::string name = peername;
+  int family = AF_UNSPEC;
+  if (name.rfind("udp6:", 0) == 0) {
+    family = AF_INET6;
+    name = name.substr(5);
+  } else if (name.rfind("udp:", 0) == 0) {
+    family = AF_INET;
+    name = name.substr(4);
+  }
+
+  // split the host and port
+  std::string host = name;
+  std::string port = "161";
+  if (!name.empty() && name[0] == '[') {
+    auto close = name.find(']');
+    if (close == std::string::npos) {
+      return std::nullopt;
+    }
+    host = name.substr(1, close - 1);
+    if (close + 1 < name.size()) {
+      if (name[close + 1] != ':') {
+        return std::nullopt;
+      }
+      port = name.substr(close + 2);
+    }
+  } else if (std::count(name.begin(), name.end(), ':') == 1) {
+    auto colon = name.find(':');
+    host = name.substr(0, colon);
+    port = name.substr(colon + 1);
+  }
+
+  addrinfo hints{};
+  hints.ai_family = family;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_NUMERICSERV;
+  addrinfo *result = nullptr;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0 ||
+      result == nullptr) {
+    DB_TRACELOC(0, "RESOLVE_PEER_FAILED: %s\n", peername.c_str());
+    return std::nullopt;
+  }
+  std::pair<sockaddr_storage, socklen_t> address{};
+  std::memcpy(&address.first, result->ai_addr, result->ai_addrlen);
+  address.second = result->ai_addrlen;
+  freeaddrinfo(result);
+  return address;
+}
+
+/*!
+  Compare the address and port of two socket addresses.
+
+  \return `bool`
+*/
+[[nodiscard]] static auto same_address(sockaddr_storage const &lhs,
+                                       sockaddr_storage const &rhs) -> bool {
+  if (lhs.ss_family != rhs.ss_family) {
+    return false;
+  }
+  if (lhs.ss_family == AF_INET) {
+    auto const &l = reinterpret_cast<sockaddr_in const &>(lhs);
+    auto const &r = reinterpret_cast<sockaddr_in const &>(rhs);
+    return l.sin_port == r.sin_port &&
+           l.sin_addr.s_addr == r.sin_addr.s_addr;
+  }
+  if (lhs.ss_family == AF_INET6) {
+    auto const &l = reinterpret_cast<sockaddr_in6 const &>(lhs);
+    auto const &r = reinterpret_cast<sockaddr_in6 const &>(rhs);
+    return l.sin6_port == r.sin6_port &&
+           std::memcmp(&l.sin6_addr, &r.sin6_addr, sizeof(l.sin6_addr)) == 0;
+  }
+  return false;
+}
+
+auto IoStats::repr() const -> std::string {
+  return boost::str(boost::format("IoStats("
+                                  "send_calls=%1%, "
+                                  "sent_datagrams=%2%, "
+                                  "max_send_batch=%3%, "
+                                  "recv_calls=%4%, "
+                                  "received_datagrams=%5%, "
+                                  "max_recv_batch=%6%)") %
+                    attr_to_string(send_calls) %
+                    attr_to_string(sent_datagrams) %
+                    attr_to_string(max_send_batch) %
+                    attr_to_string(recv_calls) %
+                    attr_to_string(received_datagrams) %
+                    attr_to_string(max_recv_batch));
+}
+
+Transport::Transport(Reactor &reactor, size_t sockets, size_t batch_size)
+    : reactor(reactor), sockets_per_family(sockets), batch_size(batch_size),
+      buffer(std::max<size_t>(batch_size, 1) * MAX_DATAGRAM_BYTES),
+      sources(std::max<size_t>(batch_size, 1)),
+      iovecs(std::max<size_t>(batch_size, 1)),
+      headers(std::max<size_t>(batch_size, 1)), send_queue(batch_size),
+      queued(0) {
+  if (sockets_per_family < 1) {
+    throw std::invalid_argument("shared_sockets must be greater than 0");
+  }
+}
+
+Transport::~Transport() {
+  for (auto &&[family, fds] : sockets) {
+    for (int fd : fds) {
+      reactor.remove(fd);
+      ::close(fd);
+    }
+  }
+}
+
+auto Transport::get_socket(int family) -> int {
+  auto &pool = sockets[family];
+  if (pool.size() < sockets_per_family) {
+    // batched sockets never block the worker; a full buffer waits in the
+    // send queue instead
+    int fd = socket(family,
+                    SOCK_DGRAM | SOCK_CLOEXEC |
+                        (batch_size > 0 ? SOCK_NONBLOCK : 0),
+                    0);
+    if (fd < 0) {
+      throw std::runtime_error("failed to open shared socket: " +
+                               std::string(std::strerror(errno)));
+    }
+    // best effort; many sessions converge on this socket
+    int rcvbuf = SHARED_SOCKET_RCVBUF_BYTES;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    try {
+      reactor.add(fd, this);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    pool.push_back(fd);
+    DB_TRACELOC(0, "TRANSPORT_OPEN_SOCKET: %d (%d)\n", fd, family);
+    return fd;
+  }
+  return pool[next_socket[family]++ % pool.size()];
+}
+
+auto Transport::open(Session *session, std::string const &peername)
+    -> Peer * {
+  auto address = resolve_peer(peername);
+  if (!address.has_value()) {
+    return nullptr;
+  }
+  auto *peer = new Peer{session, get_socket(address->first.ss_family),
+                        address->first, address->second, {}};
+  DB_TRACELOC(0, "TRANSPORT_OPEN: %s -> %d\n", peername.c_str(), peer->fd);
+  return peer;
+}
+
+void Transport::close(Peer *peer) {
+  for (auto reqid : peer->reqids) {
+    auto it = routes.find(reqid);
+    if (it != routes.end() && it->second == peer) {
+      routes.erase(it);
+    }
+  }
+  delete peer;
+}
+
+auto Transport::send(Peer &peer, uint8_t const *data, size_t size,
+                     int64_t reqid) -> bool {
+  // batched datagrams go out on the next flush
+  if (batch_size > 0) {
+    enqueue(peer, data, size);
+  } else {
+    if (sendto(peer.fd, data, size, 0,
+               reinterpret_cast<sockaddr const *>(&peer.address),
+               peer.address_length) < 0) {
+      return false;
+    }
+    stats.record_send(1);
+  }
+
+  // retransmissions reuse the request-id so registering is idempotent
+  routes[reqid] = &peer;
+  peer.reqids.insert(reqid);
+  DB_TRACELOC(0, "TRANSPORT_SEND: %zu bytes on %d\n", size, peer.fd);
+  return true;
+}
+
+void Transport::enqueue(Peer const &peer, uint8_t const *data, size_t size) {
+  if (queued == send_queue.size()) {
+    flush();
+  }
+  // datagrams of blocked sockets outlast the batch
+  if (queued == send_queue.size()) {
+    send_queue.emplace_back();
+  }
+  // slots keep their capacity so steady state sends do not allocate
+  Outgoing &outgoing = send_queue[queued++];
+  outgoing.fd = peer.fd;
+  outgoing.address = peer.address;
+  outgoing.address_length = peer.address_length;
+  outgoing.datagram.assign(data, data + size);
+  outgoing.sent = false;
+}
+
+void Transport::flush() {
+  if (queued == 0) {
+    return;
+  }
+  // the queue outgrows the batch while sockets are blocked
+  if (iovecs.size() < queued) {
+    iovecs.resize(queued);
+    headers.resize(queued);
+  }
+
+  // one sendmmsg per shared socket with a datagram in the queue
+  for (auto &&[family, fds] : sockets) {
+    for (int fd : fds) {
+      size_t count = 0;
+      for (size_t i = 0; i < queued; ++i) {
+        Outgoing &outgoing = send_queue[i];
+        if (outgoing.fd != fd) {
+          continue;
+        }
+        iovecs[count] = {outgoing.datagram.data(), outgoing.datagram.size()};
+        headers[count] = {};
+        headers[count].msg_hdr.msg_name = &outgoing.address;
+        headers[count].msg_hdr.msg_namelen = outgoing.address_length;
+        headers[count].msg_hdr.msg_iov = &iovecs[count];
+        headers[count].msg_hdr.msg_iovlen = 1;
+        count++;
+      }
+      if (count == 0 && blocked.count(fd) == 0) {
+        continue;
+      }
+      size_t offset = 0;
+      bool full = false;
+      while (offset < count) {
+        int sent = sendmmsg(fd, &headers[offset], count - offset, 0);
+        if (sent < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          // keep the rest for when the socket buffer drains
+          if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+            full = true;
+            break;
+          }
+          // only the failed datagram is lost; it is recovered by the
+          // retry/timeout path
+          DB_TRACELOC(0, "TRANSPORT_FLUSH_ERROR: %d: %s\n", fd,
+                      std::strerror(errno));
+          offset++;
+          continue;
+        }
+        stats.record_send(sent);
+        offset += sent;
+      }
+      DB_TRACELOC(0, "TRANSPORT_FLUSH: %zu of %zu datagrams on %d\n", offset,
+                  count, fd);
+
+      // mark what left the queue, in queue order
+      size_t seen = 0;
+      for (size_t i = 0; i < queued && seen < offset; ++i) {
+        if (send_queue[i].fd == fd) {
+          send_queue[i].sent = true;
+          seen++;
+        }
+      }
+      if (full != (blocked.count(fd) > 0)) {
+        reactor.watch_writable(fd, this, full);
+        if (full) {
+          blocked.insert(fd);
+        } else {
+          blocked.erase(fd);
+        }
+      }
+    }
+  }
+
+  // move the datagrams still waiting to the front, keeping their order
+  size_t kept = 0;
+  for (size_t i = 0; i < queued; ++i) {
+    if (!send_queue[i].sent) {
+      std::swap(send_queue[kept++], send_queue[i]);
+    }
+  }
+  queued = kept;
+}
+
+auto Transport::read_socket(int fd) -> size_t {
+  if (batch_size == 0) {
+    socklen_t source_length = sizeof(sources[0]);
+    ssize_t size =
+        recvfrom(fd, buffer.data(), MAX_DATAGRAM_BYTES, MSG_DONTWAIT,
+                 reinterpret_cast<sockaddr *>(&sources[0]), &source_length);
+    if (size < 0) {
+      return 0;
+    }
+    iovecs[0].iov_len = size;
+    stats.record_recv(1);
+    return 1;
+  }
+
+  // point every ring slot at its own region of the receive buffer
+  for (size_t i = 0; i < batch_size; ++i) {
+    iovecs[i] = {&buffer[i * MAX_DATAGRAM_BYTES], MAX_DATAGRAM_BYTES};
+    headers[i] = {};
+    headers[i].msg_hdr.msg_name = &sources[i];
+    headers[i].msg_hdr.msg_namelen = sizeof(sources[i]);
+    headers[i].msg_hdr.msg_iov = &iovecs[i];
+    headers[i].msg_hdr.msg_iovlen = 1;
+  }
+  int count = recvmmsg(fd, headers.data(), batch_size, MSG_DONTWAIT, nullptr);
+  if (count <= 0) {
+    return 0;
+  }
+  // record the datagram sizes in the slots
+  for (int i = 0; i < count; ++i) {
+    iovecs[i].iov_len = headers[i].msg_len;
+  }
+  stats.record_recv(count);
+  return (size_t)count;
+}
+
+void Transport::route(
+    uint8_t const *data, size_t size, sockaddr_storage const &source,
+    std::function<void(Session &, uint8_t const *, size_t)> const &deliver) {
+  // route by request-id
+  auto reqid = ber_peek_request_id(data, size);
+  if (!reqid.has_value()) {
+    DB_TRACELOC(0, "TRANSPORT_RECEIVE_MALFORMED: %zu bytes\n", size);
+    return;
+  }
+  auto it = routes.find(*reqid);
+  if (it == routes.end()) {
+    DB_TRACELOC(0, "TRANSPORT_RECEIVE_UNKNOWN_REQID: %" PRId64 "\n", *reqid);
+    return;
+  }
+  Peer *peer = it->second;
+
+  // the response must come from the peer the request was sent to
+  if (!same_address(source, peer->address)) {
+    DB_TRACELOC(0, "TRANSPORT_RECEIVE_WRONG_SOURCE: %" PRId64 "\n", *reqid);
+    return;
+  }
+  routes.erase(it);
+  peer->reqids.erase(*reqid);
+
+  deliver(*peer->session, data, size);
+}
+
+void Transport::receive(
+    std::function<void(Session &, uint8_t const *, size_t)> const &deliver) {
+  size_t slots = std::max<size_t>(batch_size, 1);
+  for (auto &&[family, fds] : sockets) {
+    for (int fd : fds) {
+      // drain the socket; a short read means it is empty
+      size_t count = 0;
+      do {
+        count = read_socket(fd);
+        for (size_t i = 0; i < count; ++i) {
+          route(&buffer[i * MAX_DATAGRAM_BYTES], iovecs[i].iov_len, sources[i],
+                deliver);
+        }
+      } while (count == slots);
+    }
+  }
+}
+
+} // namespace snmp_stream
@@ -83,11 +83,29 @@ auto Config::repr() const -> std::string {
                                   "retries=%1%, "
                                   "timeout=%2%, "
                                   "max_response_var_binds_per_pdu=%3%, "
-                                  "max_async_sessions=%4%)") %
+                                  "max_async_sessions=%4%, "
+                                  "partial_result_bytes=%5%, "
+                                  "partial_result_records=%6%, "
+                                  "adaptive_repetitions=%7%, "
+                                  "pipeline_depth=%8%, "
+                                  "auto_partition=%9%, "
+                                  "counter_rates=%10%, "
+                                  "columnar=%11%, "
+                                  "wireline_version=%12%, "
+                                  "shared_memory=%13%)") %
                     attr_to_string(get_retries()) %
                     attr_to_string(get_timeout()) %
                     attr_to_string(get_max_response_var_binds_per_pdu()) %
-                    attr_to_string(get_max_async_sessions()));
+                    attr_to_string(get_max_async_sessions()) %
+                    attr_to_string(get_partial_result_bytes()) %
+                    attr_to_string(get_partial_result_records()) %
+                    attr_to_string(get_adaptive_repetitions()) %
+                    attr_to_string(get_pipeline_depth()) %
+                    attr_to_string(get_auto_partition()) %
+                    attr_to_string(get_counter_rates()) %
+                    attr_to_string(get_columnar()) %
+                    attr_to_string(get_wireline_version()) %
+                    attr_to_string(get_shared_memory()));
 }
 
 auto test_ambiguous_root_oids(std::vector<ObjectIdentity> const &oids)
@@ -221,6 +239,15 @@ auto SnmpError::repr() const -> std::string {
   );
 }
 
+auto PduStamp::repr() const -> std::string {
+  return boost::str(boost::format("PduStamp("
+                                  "realtime_ns=%1%, "
+                                  "monotonic_ns=%2%, "
+                                  "rtt_ns=%3%)") %
+                    attr_to_string(realtime_ns) %
+                    attr_to_string(monotonic_ns) % attr_to_string(rtt_ns));
+}
+
 auto SnmpResponse::repr() const -> std::string {
   return boost::str(boost::format("SnmpResponse("
                                   "type=%1%, "
@@ -0,0 +1,750 @@
+// snmp_stream/_snmp_stream/wireline.cpp
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+extern "C" {
+#include <debug.h>
+}
+
+#include "rates.hpp"
+#include "wireline.hpp"
+
+// largest version 2 scalar value: a counter rate
+#define MAX_SCALAR_BYTES (10 + 10 + 8)
+
+namespace snmp_stream {
+
+/*!
+  Copy a field into uninitialized result space and zero its alignment padding.
+  Advances `out` past the aligned field.
+*/
+static inline void copy_aligned(uint8_t *&out,   //!< Output position.
+                                void const *src, //!< Field.
+                                size_t size      //!< Size of the field.
+) {
+  if (size > 0) {
+    std::memcpy(out, src, size);
+  }
+  std::memset(out + size, 0, SYS_ALIGN(size) - size);
+  out += SYS_ALIGN(size);
+}
+
+/*!
+  Get the size of an unsigned LEB128 varint.
+
+  \return `size_t`
+*/
+[[nodiscard]] static inline auto varint_size(uint64_t value //!< Value.
+                                             ) -> size_t {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+/*!
+  Write an unsigned LEB128 varint.  Advances `out` past the varint.
+*/
+static inline void write_varint(uint8_t *&out, //!< Output position.
+                                uint64_t value //!< Value.
+) {
+  while (value >= 0x80) {
+    *out++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = (uint8_t)value;
+}
+
+/*!
+  Reserve and encode a version 1 header after its first `HEADER_BYTES`.
+
+  \return `uint8_t *`: Start of the header.
+*/
+[[nodiscard]] static auto
+append_header_v1(ResultBuffer &results, //!< Results.
+                 std::optional<std::string> const &req_id,   //!< Request ID.
+                 std::vector<ObjectIdentity> const &root_oids //!< Root OIDs.
+                 ) -> uint8_t * {
+  size_t req_id_size = req_id.has_value() ? req_id->size() : 0;
+  size_t header_size = HEADER_BYTES + SYS_ALIGN(sizeof(req_id_size)) +
+                       SYS_ALIGN(req_id_size) + SYS_ALIGN(sizeof(size_t));
+  for (auto &&oid : root_oids) {
+    header_size +=
+        SYS_ALIGN(sizeof(size_t)) + SYS_ALIGN(oid.size() * sizeof(oid_t));
+  }
+  uint8_t *header = results.append(header_size);
+  uint8_t *out = header + HEADER_BYTES;
+
+  // add metadata to the results header
+  copy_aligned(out, &req_id_size, sizeof(req_id_size));
+  if (req_id.has_value()) {
+    copy_aligned(out, req_id->c_str(), req_id_size);
+  }
+
+  // append the number of root OIDs to the results header
+  size_t tmp = root_oids.size();
+  copy_aligned(out, &tmp, sizeof(tmp));
+
+  // append each root OID to the results header
+  for (auto &&oid : root_oids) {
+    tmp = oid.size();
+    copy_aligned(out, &tmp, sizeof(tmp));
+    copy_aligned(out, oid.data(), tmp * sizeof(oid_t));
+  }
+  return header;
+}
+
+/*!
+  Reserve and encode a version 2 header after its first `HEADER_BYTES`: the
+  request ID and each root OID prefixed by their varint size.
+
+  \return `uint8_t *`: Start of the header.
+*/
+[[nodiscard]] static auto
+append_header_v2(ResultBuffer &results, //!< Results.
+                 std::optional<std::string> const &req_id,   //!< Request ID.
+                 std::vector<ObjectIdentity> const &root_oids //!< Root OIDs.
+                 ) -> uint8_t * {
+  size_t req_id_size = req_id.has_value() ? req_id->size() : 0;
+  size_t header_size = HEADER_BYTES + varint_size(req_id_size) + req_id_size +
+                       varint_size(root_oids.size());
+  for (auto &&oid : root_oids) {
+    header_size += varint_size(oid.size());
+    for (auto sub_id : oid) {
+      header_size += varint_size(sub_id);
+    }
+  }
+  uint8_t *header = results.append(header_size);
+  uint8_t *out = header + HEADER_BYTES;
+
+  write_varint(out, req_id_size);
+  if (req_id_size > 0) {
+    std::memcpy(out, req_id->data(), req_id_size);
+    out += req_id_size;
+  }
+  write_varint(out, root_oids.size());
+  for (auto &&oid : root_oids) {
+    write_varint(out, oid.size());
+    for (auto sub_id : oid) {
+      write_varint(out, sub_id);
+    }
+  }
+  return header;
+}
+
+void append_header(ResultBuffer &results, uint8_t version,
+                   std::optional<std::string> const &req_id,
+                   std::vector<ObjectIdentity> const &root_oids) {
+  // reserve the whole results header so it stays in the first segment
+  uint8_t *out;
+  switch (version) {
+  case WIRELINE_VERSION_1:
+    out = append_header_v1(results, req_id, root_oids);
+    break;
+  case WIRELINE_VERSION_2:
+  case WIRELINE_VERSION_3:
+    out = append_header_v2(results, req_id, root_oids);
+    break;
+  default:
+    throw std::invalid_argument("unknown wireline version " +
+                                std::to_string(version));
+  }
+
+  // fill the results header
+  std::memset(out, 0, HEADER_BYTES);
+  // endianess
+  if constexpr (endian::native == endian::little) {
+    out[0] = 0;
+  } else if constexpr (endian::native == endian::big) {
+    out[0] = 1;
+  } else {
+    throw std::runtime_error("endianness could not be detected");
+  }
+  out[1] = SYS_ALIGN(sizeof(size_t)); // word size
+  out[2] = sizeof(oid_t);             // octet size
+  out[3] = version;                   // wireline version
+}
+
+/*!
+  Encode a version 1 record.
+*/
+static void append_record_v1(ResultBuffer &results, //!< Results.
+                             size_t stamp_index,    //!< Stamp index.
+                             size_t root_oid_index, //!< Root OID index.
+                             size_t root_oid_size,  //!< Root OID size.
+                             VarBind const &var_bind //!< Variable binding.
+) {
+  size_t index_size = var_bind.name_length - root_oid_size;
+  size_t var_bind_size = (
+      // stamp index
+      SYS_ALIGN(sizeof(stamp_index)) +
+      // root oid index
+      SYS_ALIGN(sizeof(root_oid_index)) +
+      // value type
+      SYS_ALIGN(sizeof(var_bind.type)) +
+      // index size
+      SYS_ALIGN(sizeof(index_size)) +
+      // index
+      SYS_ALIGN(index_size * sizeof(oid_t)) +
+      // value size
+      SYS_ALIGN(sizeof(var_bind.value_length)) +
+      // value
+      SYS_ALIGN(var_bind.value_length));
+
+  // reserve the record; the space is not zero-filled
+  uint8_t *out =
+      results.append(SYS_ALIGN(sizeof(var_bind_size)) + var_bind_size);
+
+  // copy the variable binding size
+  copy_aligned(out, &var_bind_size, sizeof(var_bind_size));
+
+  // copy the stamp index
+  copy_aligned(out, &stamp_index, sizeof(stamp_index));
+
+  // copy the root oid index
+  copy_aligned(out, &root_oid_index, sizeof(root_oid_index));
+
+  // copy the value type
+  copy_aligned(out, &var_bind.type, sizeof(var_bind.type));
+
+  // copy the index size
+  copy_aligned(out, &index_size, sizeof(index_size));
+
+  // copy the index
+  copy_aligned(out, var_bind.name + root_oid_size, index_size * sizeof(oid_t));
+
+  // copy the value_size
+  copy_aligned(out, &var_bind.value_length, sizeof(var_bind.value_length));
+
+  // copy the value
+  copy_aligned(out, var_bind.value, var_bind.value_length);
+}
+
+/*!
+  Encode a scalar value for version 2: integers as zigzag varints, unsigned
+  types as varints and a counter rate as the varint value and delta followed
+  by the rate as a little-endian double.  A scalar with an unexpected host
+  size is encoded empty, as it has no value in the columns either.
+
+  \return `std::optional<size_t>`: Encoded size or `std::nullopt` if the type
+  is not a scalar.
+*/
+[[nodiscard]] static auto
+encode_scalar(VarBind const &var_bind, //!< Variable binding.
+              uint8_t *out //!< Output of at least `MAX_SCALAR_BYTES`.
+              ) -> std::optional<size_t> {
+  uint8_t *start = out;
+  switch (var_bind.type) {
+  case BER_INTEGER:
+    if (var_bind.value_length == sizeof(long)) {
+      long value;
+      std::memcpy(&value, var_bind.value, sizeof(value));
+      // zigzag so small negative values stay short
+      write_varint(out, ((uint64_t)value << 1) ^
+                            (uint64_t)((int64_t)value >> 63));
+    }
+    break;
+  case BER_COUNTER32:
+  case BER_GAUGE32:
+  case BER_TIMETICKS:
+  case BER_UINTEGER32:
+    if (var_bind.value_length == sizeof(u_long)) {
+      u_long value;
+      std::memcpy(&value, var_bind.value, sizeof(value));
+      write_varint(out, value & 0xffffffff);
+    }
+    break;
+  case BER_COUNTER64:
+    if (var_bind.value_length == sizeof(counter64)) {
+      counter64 value;
+      std::memcpy(&value, var_bind.value, sizeof(value));
+      write_varint(out, ((uint64_t)(value.high & 0xffffffff) << 32) |
+                            (uint64_t)(value.low & 0xffffffff));
+    }
+    break;
+  case COUNTER_RATE:
+    if (var_bind.value_length == sizeof(CounterRate)) {
+      CounterRate value;
+      std::memcpy(&value, var_bind.value, sizeof(value));
+      write_varint(out, value.value);
+      write_varint(out, value.delta);
+      uint64_t bits;
+      std::memcpy(&bits, &value.rate, sizeof(bits));
+      for (size_t i = 0; i < sizeof(bits); ++i) {
+        *out++ = (uint8_t)(bits >> (8 * i));
+      }
+    }
+    break;
+  default:
+    return std::nullopt;
+  }
+  return out - start;
+}
+
+/*!
+  Encode a version 2 or 3 record: varint stamp index, varint root OID index,
+  type byte, the index, varint value size and the value.  Object identifier
+  values are varint sub-identifiers and values that are not scalars are copied
+  as is.
+
+  Version 2 writes the index as its varint size and sub-identifiers.  Version
+  3 writes the number of leading sub-identifiers shared with the previous
+  index of the root OID, then the size and sub-identifiers of the rest.  A
+  walk returns each root OID in lexicographic order, so the shared prefix
+  usually covers all but the last sub-identifiers.
+*/
+static void
+append_record_v2(ResultBuffer &results, //!< Results.
+                 size_t stamp_index,    //!< Stamp index.
+                 size_t root_oid_index, //!< Root OID index.
+                 size_t root_oid_size,  //!< Root OID size.
+                 VarBind const &var_bind, //!< Variable binding.
+                 std::vector<oid_t> *previous_index //!< Previous index of the
+                                                    //!< root OID for version
+                                                    //!< 3 or `nullptr`.
+) {
+  oid_t const *index = var_bind.name + root_oid_size;
+  size_t index_size = var_bind.name_length - root_oid_size;
+
+  // split off the prefix shared with the previous index
+  size_t prefix_size = 0;
+  if (previous_index != nullptr) {
+    size_t max_prefix_size = std::min(index_size, previous_index->size());
+    while (prefix_size < max_prefix_size &&
+           (*previous_index)[prefix_size] == index[prefix_size]) {
+      prefix_size++;
+    }
+  }
+  oid_t const *suffix = index + prefix_size;
+  size_t suffix_size = index_size - prefix_size;
+
+  // size the value
+  uint8_t scalar[MAX_SCALAR_BYTES];
+  std::optional<size_t> scalar_size = encode_scalar(var_bind, scalar);
+  auto const *oid_value = (oid_t const *)var_bind.value;
+  size_t oid_value_size = 0;
+  size_t value_size = var_bind.value_length;
+  if (scalar_size.has_value()) {
+    value_size = *scalar_size;
+  } else if (var_bind.type == BER_OBJECT_ID) {
+    oid_value_size = var_bind.value_length / sizeof(oid_t);
+    value_size = 0;
+    for (size_t i = 0; i < oid_value_size; ++i) {
+      value_size += varint_size(oid_value[i]);
+    }
+  }
+
+  // reserve the record; the space is not zero-filled
+  size_t record_size = varint_size(stamp_index) +
+                       varint_size(root_oid_index) + sizeof(var_bind.type) +
+                       varint_size(suffix_size) + varint_size(value_size) +
+                       value_size;
+  if (previous_index != nullptr) {
+    record_size += varint_size(prefix_size);
+  }
+  for (size_t i = 0; i < suffix_size; ++i) {
+    record_size += varint_size(suffix[i]);
+  }
+  uint8_t *out = results.append(record_size);
+
+  write_varint(out, stamp_index);
+  write_varint(out, root_oid_index);
+  *out++ = var_bind.type;
+  if (previous_index != nullptr) {
+    write_varint(out, prefix_size);
+    previous_index->assign(index, index + index_size);
+  }
+  write_varint(out, suffix_size);
+  for (size_t i = 0; i < suffix_size; ++i) {
+    write_varint(out, suffix[i]);
+  }
+  write_varint(out, value_size);
+  if (scalar_size.has_value()) {
+    std::memcpy(out, scalar, value_size);
+  } else if (var_bind.type == BER_OBJECT_ID) {
+    for (size_t i = 0; i < oid_value_size; ++i) {
+      write_varint(out, oid_value[i]);
+    }
+  } else if (value_size > 0) {
+    std::memcpy(out, var_bind.value, value_size);
+  }
+}
+
+void append_record(ResultBuffer &results, uint8_t version, size_t stamp_index,
+                   size_t root_oid_index, size_t root_oid_size,
+                   VarBind const &var_bind,
+                   std::vector<oid_t> &previous_index) {
+  if (version == WIRELINE_VERSION_2) {
+    append_record_v2(results, stamp_index, root_oid_index, root_oid_size,
+                     var_bind, nullptr);
+  } else if (version == WIRELINE_VERSION_3) {
+    append_record_v2(results, stamp_index, root_oid_index, root_oid_size,
+                     var_bind, &previous_index);
+  } else {
+    append_record_v1(results, stamp_index, root_oid_index, root_oid_size,
+                     var_bind);
+  }
+}
+
+/*!
+  Read a word aligned field.  Advances `pos` past the aligned field.
+
+  \return `uint8_t const *`: Field.
+*/
+[[nodiscard]] static auto read_field(uint8_t const *data, //!< Chunk.
+                                     size_t end,          //!< End of the
+                                                          //!< enclosing data.
+                                     size_t &pos,         //!< Read position.
+                                     size_t size //!< Size of the field.
+                                     ) -> uint8_t const * {
+  if (size > end - pos || SYS_ALIGN(size) > end - pos) {
+    throw std::invalid_argument("malformed wireline results");
+  }
+  uint8_t const *field = data + pos;
+  pos += SYS_ALIGN(size);
+  return field;
+}
+
+/*!
+  Read a word.
+
+  \return `size_t`
+*/
+[[nodiscard]] static auto read_word(uint8_t const *data, //!< Chunk.
+                                    size_t end,  //!< End of the enclosing
+                                                 //!< data.
+                                    size_t &pos //!< Read position.
+                                    ) -> size_t {
+  size_t word;
+  std::memcpy(&word, read_field(data, end, pos, sizeof(word)), sizeof(word));
+  return word;
+}
+
+/*!
+  Read an unsigned LEB128 varint.  Advances `pos` past the varint.
+
+  \return `uint64_t`
+*/
+[[nodiscard]] static auto read_varint(uint8_t const *data, //!< Chunk.
+                                      size_t end,  //!< End of the enclosing
+                                                   //!< data.
+                                      size_t &pos //!< Read position.
+                                      ) -> uint64_t {
+  uint64_t value = 0;
+  for (size_t shift = 0; shift < 64 && pos < end; shift += 7) {
+    uint8_t byte = data[pos++];
+    value |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  throw std::invalid_argument("malformed wireline results");
+}
+
+/*!
+  Read a varint counting items of at least one byte each.
+
+  \return `size_t`
+*/
+[[nodiscard]] static auto read_count(uint8_t const *data, //!< Chunk.
+                                     size_t end,  //!< End of the enclosing
+                                                  //!< data.
+                                     size_t &pos //!< Read position.
+                                     ) -> size_t {
+  uint64_t count = read_varint(data, end, pos);
+  if (count > end - pos) {
+    throw std::invalid_argument("malformed wireline results");
+  }
+  return count;
+}
+
+/*!
+  Decode the version 1 header.
+
+  \return `size_t`: Position of the first record.
+*/
+[[nodiscard]] static auto decode_header_v1(uint8_t const *data, //!< Chunk.
+                                           size_t size, //!< Size of the chunk.
+                                           DecodedResults &decoded //!< Decoded
+                                                                   //!< results.
+                                           ) -> size_t {
+  // check the header was written by a compatible system
+  uint8_t byte_order = endian::native == endian::little ? 0 : 1;
+  if (data[0] != byte_order || data[1] != SYS_ALIGN(sizeof(size_t)) ||
+      data[2] != sizeof(oid_t)) {
+    throw std::invalid_argument(
+        "wireline results have a different byte order, word size or octet "
+        "size");
+  }
+  size_t pos = HEADER_BYTES;
+
+  // decode the metadata
+  size_t req_id_size = read_word(data, size, pos);
+  auto const *req_id = (char const *)read_field(data, size, pos, req_id_size);
+  if (req_id_size > 0) {
+    decoded.req_id = std::string(req_id, req_id_size);
+  }
+
+  // decode the root OIDs
+  size_t root_oids = read_word(data, size, pos);
+  if (root_oids > size) {
+    throw std::invalid_argument("malformed wireline results");
+  }
+  for (size_t i = 0; i < root_oids; ++i) {
+    size_t oid_size = read_word(data, size, pos);
+    if (oid_size > size / sizeof(oid_t)) {
+      throw std::invalid_argument("malformed wireline results");
+    }
+    auto const *oid = read_field(data, size, pos, oid_size * sizeof(oid_t));
+    std::vector<oid_t> root_oid(oid_size);
+    if (oid_size > 0) {
+      std::memcpy(root_oid.data(), oid, oid_size * sizeof(oid_t));
+    }
+    decoded.root_oids.emplace_back(root_oid);
+  }
+  return pos;
+}
+
+/*!
+  Decode the version 2 header.  The encoding does not depend on the host, so
+  only the version is checked.
+
+  \return `size_t`: Position of the first record.
+*/
+[[nodiscard]] static auto decode_header_v2(uint8_t const *data, //!< Chunk.
+                                           size_t size, //!< Size of the chunk.
+                                           DecodedResults &decoded //!< Decoded
+                                                                   //!< results.
+                                           ) -> size_t {
+  size_t pos = HEADER_BYTES;
+
+  // decode the metadata
+  size_t req_id_size = read_count(data, size, pos);
+  if (req_id_size > 0) {
+    decoded.req_id = std::string((char const *)data + pos, req_id_size);
+  }
+  pos += req_id_size;
+
+  // decode the root OIDs
+  size_t root_oids = read_count(data, size, pos);
+  for (size_t i = 0; i < root_oids; ++i) {
+    std::vector<oid_t> root_oid(read_count(data, size, pos));
+    for (auto &sub_id : root_oid) {
+      sub_id = read_varint(data, size, pos);
+    }
+    decoded.root_oids.emplace_back(root_oid);
+  }
+  return pos;
+}
+
+/*!
+  Decode the version 1 records of a chunk.
+*/
+static void decode_records_v1(uint8_t const *data, //!< Chunk.
+                              size_t size,         //!< Size of the chunk.
+                              size_t pos,          //!< First record.
+                              std::vector<oid_t> &index, //!< Index scratch.
+                              DecodedResults &decoded //!< Decoded results.
+) {
+  while (pos < size) {
+    size_t record_size = read_word(data, size, pos);
+    if (record_size > size - pos) {
+      throw std::invalid_argument("malformed wireline results");
+    }
+    size_t end = pos + record_size;
+    size_t stamp_index = read_word(data, end, pos);
+    size_t root_oid_index = read_word(data, end, pos);
+    uint8_t type = *read_field(data, end, pos, sizeof(type));
+    size_t index_size = read_word(data, end, pos);
+    if (index_size > (end - pos) / sizeof(oid_t)) {
+      throw std::invalid_argument("malformed wireline results");
+    }
+    auto const *index_data =
+        read_field(data, end, pos, index_size * sizeof(oid_t));
+    size_t value_length = read_word(data, end, pos);
+    auto const *value = read_field(data, end, pos, value_length);
+    if (pos != end || root_oid_index >= decoded.root_oids.size()) {
+      throw std::invalid_argument("malformed wireline results");
+    }
+    // the index is copied out as the chunks may not be aligned for an `oid_t`
+    index.resize(index_size);
+    if (index_size > 0) {
+      std::memcpy(index.data(), index_data, index_size * sizeof(oid_t));
+    }
+    decoded.columns->append(root_oid_index, index.data(), index_size, type,
+                            value, value_length, stamp_index);
+  }
+}
+
+/*!
+  Decode the version 2 or 3 records of a chunk.  Values are rebuilt in the
+  host representation the columns expect.
+*/
+static void decode_records_v2(
+    uint8_t const *data,           //!< Chunk.
+    size_t size,                   //!< Size of the chunk.
+    size_t pos,                    //!< First record.
+    std::vector<oid_t> &index,     //!< Index scratch for version 2.
+    std::vector<oid_t> &oid_value, //!< Object identifier scratch.
+    std::vector<std::vector<oid_t>>
+        *previous_indexes,  //!< Previous index of each root OID for version
+                            //!< 3 or `nullptr`.
+    DecodedResults &decoded //!< Decoded results.
+) {
+  while (pos < size) {
+    size_t stamp_index = read_varint(data, size, pos);
+    size_t root_oid_index = read_varint(data, size, pos);
+    if (pos >= size || root_oid_index >= decoded.root_oids.size()) {
+      throw std::invalid_argument("malformed wireline results");
+    }
+    uint8_t type = data[pos++];
+
+    // rebuild a delta encoded index on top of the previous one
+    std::vector<oid_t> *record_index = &index;
+    size_t prefix_size = 0;
+    if (previous_indexes != nullptr) {
+      record_index = &(*previous_indexes)[root_oid_index];
+      prefix_size = read_varint(data, size, pos);
+      if (prefix_size > record_index->size()) {
+        throw std::invalid_argument("malformed wireline results");
+      }
+    }
+    record_index->resize(prefix_size + read_count(data, size, pos));
+    for (size_t i = prefix_size; i < record_index->size(); ++i) {
+      (*record_index)[i] = read_varint(data, size, pos);
+    }
+    size_t value_size = read_count(data, size, pos);
+    size_t end = pos + value_size;
+
+    // decode the value
+    long integer;
+    u_long uinteger;
+    counter64 counter;
+    CounterRate rate;
+    void const *value = nullptr;
+    size_t value_length = 0;
+    if (value_size > 0) {
+      switch (type) {
+      case BER_INTEGER: {
+        uint64_t zigzag = read_varint(data, end, pos);
+        integer = (long)((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+        value = &integer;
+        value_length = sizeof(integer);
+        break;
+      }
+      case BER_COUNTER32:
+      case BER_GAUGE32:
+      case BER_TIMETICKS:
+      case BER_UINTEGER32:
+        uinteger = read_varint(data, end, pos);
+        value = &uinteger;
+        value_length = sizeof(uinteger);
+        break;
+      case BER_COUNTER64: {
+        uint64_t joined = read_varint(data, end, pos);
+        counter.high = joined >> 32;
+        counter.low = joined & 0xffffffff;
+        value = &counter;
+        value_length = sizeof(counter);
+        break;
+      }
+      case COUNTER_RATE: {
+        rate.value = read_varint(data, end, pos);
+        rate.delta = read_varint(data, end, pos);
+        if (end - pos != sizeof(uint64_t)) {
+          throw std::invalid_argument("malformed wireline results");
+        }
+        uint64_t bits = 0;
+        for (size_t i = 0; i < sizeof(bits); ++i) {
+          bits |= (uint64_t)data[pos++] << (8 * i);
+        }
+        std::memcpy(&rate.rate, &bits, sizeof(bits));
+        value = &rate;
+        value_length = sizeof(rate);
+        break;
+      }
+      case BER_OBJECT_ID:
+        oid_value.clear();
+        while (pos < end) {
+          oid_value.push_back(read_varint(data, end, pos));
+        }
+        value = oid_value.data();
+        value_length = oid_value.size() * sizeof(oid_t);
+        break;
+      default:
+        value = data + pos;
+        value_length = value_size;
+        pos = end;
+        break;
+      }
+    }
+    if (pos != end) {
+      throw std::invalid_argument("malformed wireline results");
+    }
+    decoded.columns->append(root_oid_index, record_index->data(),
+                            record_index->size(), type, value, value_length,
+                            stamp_index);
+  }
+}
+
+auto decode_results(
+    std::vector<std::pair<uint8_t const *, size_t>> const &chunks)
+    -> DecodedResults {
+  if (chunks.empty() || chunks[0].second < HEADER_BYTES) {
+    throw std::invalid_argument("wireline results have no header");
+  }
+
+  // results written before the version byte have it reserved as 0
+  uint8_t version = chunks[0].first[3];
+  if (version == 0) {
+    version = WIRELINE_VERSION_1;
+  }
+  if (version != WIRELINE_VERSION_1 && version != WIRELINE_VERSION_2 &&
+      version != WIRELINE_VERSION_3) {
+    throw std::invalid_argument("unknown wireline version " +
+                                std::to_string(version));
+  }
+
+  DecodedResults decoded;
+  size_t pos = version == WIRELINE_VERSION_1
+                   ? decode_header_v1(chunks[0].first, chunks[0].second,
+                                      decoded)
+                   : decode_header_v2(chunks[0].first, chunks[0].second,
+                                      decoded);
+  decoded.columns =
+      std::make_shared<ColumnarResults>(decoded.root_oids.size());
+
+  // decode the records
+  std::vector<oid_t> index;
+  std::vector<oid_t> oid_value;
+  std::vector<std::vector<oid_t>> previous_indexes(decoded.root_oids.size());
+  for (auto [data, size] : chunks) {
+    if (version == WIRELINE_VERSION_1) {
+      decode_records_v1(data, size, pos, index, decoded);
+    } else {
+      decode_records_v2(
+          data, size, pos, index, oid_value,
+          version == WIRELINE_VERSION_3 ? &previous_indexes : nullptr,
+          decoded);
+    }
+    pos = 0;
+  }
+  return decoded;
+}
+
+auto decode_results(ResultBuffer const &results) -> DecodedResults {
+  std::vector<std::pair<uint8_t const *, size_t>> chunks;
+  chunks.reserve(results.get_segment_count());
+  for (size_t i = 0; i < results.get_segment_count(); ++i) {
+    chunks.push_back(results.get_segment(i));
+  }
+  DB_TRACELOC(0, "WIRELINE_DECODE: %zu bytes in %zu segments\n",
+              results.get_size(), chunks.size());
+  return decode_results(chunks);
+}
+
+} // namespace snmp_stream
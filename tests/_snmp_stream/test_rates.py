@@ -0,0 +1,82 @@
+"""Counter rate test cases."""
+
+from typing import Optional, Tuple
+
+from snmp_stream._snmp_stream import CounterRates, ObjectIdentity
+
+COUNTER32 = 0x41
+TIMETICKS = 0x43
+COUNTER64 = 0x46
+
+SECOND = 10**9
+
+IF_IN_OCTETS = ObjectIdentity([1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 1])
+SYS_UP_TIME = ObjectIdentity([1, 3, 6, 1, 2, 1, 1, 3, 0])
+
+Rate = Optional[Tuple[int, int, float]]
+
+
+def counter32(rates: CounterRates, value: int, seconds: float) -> Rate:
+    """Sample ifInOctets as a Counter32."""
+    return rates.sample(IF_IN_OCTETS, COUNTER32, value, int(seconds * SECOND))
+
+
+def counter64(rates: CounterRates, value: int, seconds: float) -> Rate:
+    """Sample ifInOctets as a Counter64."""
+    return rates.sample(IF_IN_OCTETS, COUNTER64, value, int(seconds * SECOND))
+
+
+def uptime(rates: CounterRates, ticks: int, seconds: float) -> None:
+    """Sample sysUpTime.0."""
+    assert rates.sample(SYS_UP_TIME, TIMETICKS, ticks, int(seconds * SECOND)) is None
+
+
+def test_delta() -> None:
+    """Test the delta and rate between two samples."""
+    rates = CounterRates()
+    assert counter64(rates, 1000, 0) is None
+    assert counter64(rates, 3000, 2) == (3000, 2000, 1000.0)
+    # a second sample from the same response PDU has no rate
+    assert counter64(rates, 3000, 2) is None
+
+
+def test_counter32_wrap() -> None:
+    """Test a Counter32 wrap is unwrapped on the first interval and after a burst."""
+    rates = CounterRates()
+    assert counter32(rates, 2**32 - 0x100, 0) is None
+    assert counter32(rates, 0x40, 1) == (0x40, 0x140, 320.0)
+    assert counter32(rates, 0x50, 2) == (0x50, 0x10, 16.0)
+    # a wrap far above the previous rate is still a wrap, and so is the next
+    assert counter32(rates, 0x10, 3) == (0x10, 2**32 - 0x40, float(2**32 - 0x40))
+    assert counter32(rates, 0x08, 4) == (0x08, 2**32 - 0x08, float(2**32 - 0x08))
+
+
+def test_counter32_reset() -> None:
+    """Test a Counter32 going backwards faster than any interface is a reset."""
+    rates = CounterRates()
+    assert counter32(rates, 0x100, 0) is None
+    assert counter32(rates, 0x80, 0.1) is None
+    # the next sample is measured from the new value
+    assert counter32(rates, 0xa0, 1.1) == (0xa0, 0x20, 32.0)
+
+
+def test_counter64_reset() -> None:
+    """Test a Counter64 going backwards is a reset."""
+    rates = CounterRates()
+    assert counter64(rates, 2**40, 0) is None
+    assert counter64(rates, 10, 1) is None
+    assert counter64(rates, 110, 2) == (110, 100, 100.0)
+
+
+def test_restart() -> None:
+    """Test sysUpTime.0 going backwards drops the samples instead of reading a wrap."""
+    rates = CounterRates()
+    uptime(rates, 100000, 0)
+    assert counter32(rates, 5000, 0) is None
+    uptime(rates, 50, 60)
+    assert counter32(rates, 10, 60) is None
+    assert counter32(rates, 20, 61) == (20, 10, 10.0)
+
+    # sysUpTime.0 advancing with the clock keeps the samples
+    uptime(rates, 150, 61)
+    assert counter32(rates, 30, 62) == (30, 10, 10.0)
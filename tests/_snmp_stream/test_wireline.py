@@ -0,0 +1,294 @@
+"""Wireline decode test cases."""
+
+import struct
+import sys
+from typing import Any, Dict, List, Optional, Sequence, Text, Tuple, Union
+
+import numpy as np
+import pytest
+
+from snmp_stream._snmp_stream import (
+    Community, ObjectIdentity, PduStamp, SnmpRequest, SnmpResponse, decode_results
+)
+
+INTEGER = 0x02
+OCTET_STRING = 0x04
+COUNTER32 = 0x41
+
+WORD_SIZE = struct.calcsize('@N')
+OID_SIZE = struct.calcsize('@L')
+
+# stamp index, root OID index, type, index, value
+Record = Tuple[int, int, int, Sequence[int], Union[int, bytes]]
+
+ROOT_OIDS = [
+    [1, 3, 6, 1, 2, 1, 2, 2, 1, 2],
+    [1, 3, 6, 1, 2, 1, 2, 2, 1, 8],
+    [1, 3, 6, 1, 2, 1, 2, 2, 1, 10]
+]
+
+RECORDS: List[Record] = [
+    (0, 0, OCTET_STRING, [1], b'eth0'),
+    (0, 1, INTEGER, [1], 1),
+    (0, 2, COUNTER32, [1], 1234),
+    (1, 0, OCTET_STRING, [2], b'eth1'),
+    (1, 1, INTEGER, [2], 2),
+    (1, 2, COUNTER32, [2], 2**32 - 1)
+]
+
+
+def varint(value: int) -> bytes:
+    """Encode an unsigned varint."""
+    out = bytearray()
+    while value >= 0x80:
+        out.append((value & 0x7f) | 0x80)
+        value >>= 7
+    out.append(value)
+    return bytes(out)
+
+
+def zigzag(value: int) -> int:
+    """Map a signed 64-bit integer to an unsigned one."""
+    return ((value << 1) ^ (value >> 63)) & 0xffffffffffffffff
+
+
+def word(value: int) -> bytes:
+    """Encode a host word."""
+    return struct.pack('@N', value)
+
+
+def aligned(data: bytes) -> bytes:
+    """Pad a field to a host word."""
+    return data + bytes(-len(data) % WORD_SIZE)
+
+
+def encode_value_v1(type: int, value: Union[int, bytes]) -> bytes:
+    # pylint: disable=redefined-builtin
+    """Encode a value in the host representation."""
+    if type == INTEGER:
+        return struct.pack('@l', value)
+    if type == COUNTER32:
+        return struct.pack('@L', value)
+    assert isinstance(value, bytes)
+    return value
+
+
+def encode_value_v2(type: int, value: Union[int, bytes]) -> bytes:
+    # pylint: disable=redefined-builtin
+    """Encode a value as a varint or raw bytes."""
+    if type == INTEGER:
+        assert isinstance(value, int)
+        return varint(zigzag(value))
+    if type == COUNTER32:
+        assert isinstance(value, int)
+        return varint(value)
+    assert isinstance(value, bytes)
+    return value
+
+
+def encode(
+        version: int,
+        records: Sequence[Record],
+        root_oids: Sequence[Sequence[int]] = ROOT_OIDS,
+        req_id: Optional[Text] = 'req'
+) -> bytes:
+    # pylint: disable=redefined-builtin
+    """Encode wireline results the way a session does."""
+    out = bytearray([
+        0 if sys.byteorder == 'little' else 1, WORD_SIZE, OID_SIZE, version
+    ])
+    out += bytes(16 - len(out))
+    req_id_bytes = req_id.encode() if req_id is not None else b''
+
+    if version == 1:
+        out += word(len(req_id_bytes)) + aligned(req_id_bytes)
+        out += word(len(root_oids))
+        for oid in root_oids:
+            out += word(len(oid)) + struct.pack(f'@{len(oid)}L', *oid)
+        for stamp, root, type, index, value in records:
+            data = encode_value_v1(type, value)
+            record = (
+                word(stamp) + word(root) + aligned(bytes([type])) + word(len(index)) +
+                struct.pack(f'@{len(index)}L', *index) + word(len(data)) + aligned(data)
+            )
+            out += word(len(record)) + record
+        return bytes(out)
+
+    out += varint(len(req_id_bytes)) + req_id_bytes
+    out += varint(len(root_oids))
+    for oid in root_oids:
+        out += varint(len(oid)) + b''.join(varint(x) for x in oid)
+    previous: Dict[int, Sequence[int]] = {}
+    for stamp, root, type, index, value in records:
+        out += varint(stamp) + varint(root) + bytes([type])
+        suffix = index
+        if version == 3:
+            last = previous.get(root, [])
+            prefix = 0
+            while prefix < min(len(last), len(index)) and last[prefix] == index[prefix]:
+                prefix += 1
+            previous[root] = index
+            out += varint(prefix)
+            suffix = index[prefix:]
+        out += varint(len(suffix)) + b''.join(varint(x) for x in suffix)
+        data = encode_value_v2(type, value)
+        out += varint(len(data)) + data
+    return bytes(out)
+
+
+def response(results: bytes, stamps: int = 2, shared_memory: bool = False) -> SnmpResponse:
+    """Build a response around encoded results."""
+    request = SnmpRequest(
+        SnmpRequest.SnmpRequestType.WALK_REQUEST, 'localhost',
+        Community('public', Community.Version.V2C),  # type: ignore
+        [ObjectIdentity(oid) for oid in ROOT_OIDS]
+    )
+    return SnmpResponse(
+        SnmpResponse.SnmpResponseType.SUCCESSFUL, request, list(results),  # type: ignore
+        [], [PduStamp(i + 1, i + 2, 0) for i in range(stamps)], shared_memory=shared_memory
+    )
+
+
+def decode(results: bytes) -> Dict[Text, Any]:
+    """Decode results without a response."""
+    return decode_results(np.frombuffer(results, dtype=np.uint8))
+
+
+@pytest.mark.parametrize('version', [1, 2, 3])
+def test_decode(
+        version: int
+) -> None:
+    """Test decoding each wireline version through a response."""
+    decoded = response(encode(version, RECORDS)).decode()
+    assert decoded['req_id'] == 'req'
+    assert [list(oid) for oid in decoded['root_oids']] == ROOT_OIDS
+    assert len(decoded['tables']) == len(ROOT_OIDS)
+
+    descr, status, in_octets = decoded['tables']
+    for table in decoded['tables']:
+        assert list(table['stamp']) == [0, 1]
+        assert list(table['index_offsets']) == [0, 1, 2]
+        assert list(table['index']) == [1, 2]
+        assert table['index_matrix'].tolist() == [[1], [2]]
+        assert list(table['realtime_ns']) == [1, 2]
+        assert list(table['monotonic_ns']) == [2, 3]
+
+    assert list(descr['type']) == [OCTET_STRING] * 2
+    assert list(descr['octets_offsets']) == [0, 4, 8]
+    assert bytes(descr['octets']) == b'eth0eth1'
+    assert list(status['type']) == [INTEGER] * 2
+    assert list(status['integer']) == [1, 2]
+    assert list(in_octets['type']) == [COUNTER32] * 2
+    assert list(in_octets['uinteger']) == [1234, 2**32 - 1]
+
+
+@pytest.mark.parametrize('version', [1, 2, 3])
+def test_decode_results(
+        version: int
+) -> None:
+    """Test decoding each wireline version without a response."""
+    decoded = decode(encode(version, RECORDS, req_id=None))
+    assert decoded['req_id'] is None
+    assert list(decoded['tables'][1]['integer']) == [1, 2]
+    assert 'realtime_ns' not in decoded['tables'][1]
+
+
+@pytest.mark.parametrize('version', [2, 3])
+def test_zigzag(
+        version: int
+) -> None:
+    """Test negative integers survive the zigzag encoding."""
+    values = [0, -1, 1, -64, 64, -65, -2**31, -2**63, 2**63 - 1]
+    records: List[Record] = [
+        (0, 1, INTEGER, [i], value) for i, value in enumerate(values)
+    ]
+    decoded = decode(encode(version, records))
+    assert list(decoded['tables'][1]['integer']) == values
+
+
+def test_prefix() -> None:
+    """Test version 3 rebuilds interleaved indexes per root OID."""
+    indexes = [
+        (0, [1, 4, 192, 168, 0, 1]), (1, [5, 7, 9]), (0, [1, 4, 192, 168, 0, 2]),
+        (2, [3]), (1, [5, 7, 10]), (0, [2, 4, 192, 168, 1, 1]), (1, [5]), (2, [3, 4]),
+        (1, [5, 7, 9]), (0, [2, 4, 192, 168, 1, 1])
+    ]
+    records: List[Record] = [
+        (0, root, OCTET_STRING, index, b'x') for root, index in indexes
+    ]
+    v2 = encode(2, records)
+    v3 = encode(3, records)
+    assert len(v3) < len(v2)
+
+    expected = decode(v2)
+    decoded = decode(v3)
+    for root in range(len(ROOT_OIDS)):
+        rows = [index for i, index in indexes if i == root]
+        table = decoded['tables'][root]
+        offsets = list(table['index_offsets'])
+        index = list(table['index'])
+        assert [index[a:b] for a, b in zip(offsets, offsets[1:])] == rows
+        assert index == list(expected['tables'][root]['index'])
+    assert decoded['tables'][0]['index_matrix'].tolist() == [
+        index for root, index in indexes if root == 0
+    ]
+    assert 'index_matrix' not in decoded['tables'][1]
+
+
+@pytest.mark.parametrize('version', [2, 3])
+def test_truncated_varint(
+        version: int
+) -> None:
+    """Test a varint cut off by the end of the results."""
+    results = encode(version, RECORDS)
+    with pytest.raises(ValueError, match='malformed'):
+        decode(results + b'\x80')
+    with pytest.raises(ValueError, match='malformed'):
+        decode(results[:-1])
+
+
+@pytest.mark.parametrize('version', [1, 2, 3])
+def test_bad_root_oid_index(
+        version: int
+) -> None:
+    """Test a record of a root OID the header does not have."""
+    records: List[Record] = [(0, len(ROOT_OIDS), INTEGER, [1], 1)]
+    with pytest.raises(ValueError, match='malformed'):
+        decode(encode(version, records))
+
+
+def test_bad_prefix_size() -> None:
+    """Test a version 3 prefix longer than the previous index."""
+    results = bytearray(encode(3, [(0, 0, INTEGER, [1, 2], 1)]))
+    # the prefix size follows the stamp, root OID index and type of the record
+    record = len(encode(3, []))
+    assert results[record + 3] == 0
+    results[record + 3] = 1
+    with pytest.raises(ValueError, match='malformed'):
+        decode(bytes(results))
+
+    # a second record may only reuse the first one's index
+    records: List[Record] = [(0, 0, INTEGER, [1, 2], 1), (0, 0, INTEGER, [1, 3], 1)]
+    results = bytearray(encode(3, records))
+    second = len(encode(3, records[:1]))
+    assert results[second + 3] == 1
+    results[second + 3] = 3
+    with pytest.raises(ValueError, match='malformed'):
+        decode(bytes(results))
+
+
+@pytest.mark.parametrize('version', [4, 0xff])
+def test_unknown_version(
+        version: int
+) -> None:
+    """Test a header of an unknown version."""
+    results = bytearray(encode(2, RECORDS))
+    results[3] = version
+    with pytest.raises(ValueError, match=f'unknown wireline version {version}'):
+        decode(bytes(results))
+
+
+def test_no_header() -> None:
+    """Test results too short for a header."""
+    with pytest.raises(ValueError, match='no header'):
+        decode(b'\x00' * 15)
@@ -6,8 +6,8 @@ from typing import Optional, Sequence, Text, Union
 import hypothesis.strategies as st
 
 from snmp_stream._snmp_stream import (
-    Community, Config, ObjectIdentity, ObjectIdentityRange, SnmpError, SnmpRequest,
-    test_ambiguous_root_oids
+    Community, Config, IoStats, ObjectIdentity, ObjectIdentityRange, PduStamp,
+    SnmpError, SnmpRequest, SnmpResponse, test_ambiguous_root_oids
 )
 from tests.strategies import int64s, optionals, uint64s
 
@@ -97,14 +97,50 @@ def configs(
     retries: st.SearchStrategy[Optional[int]] = optionals(int64s(min_value=0)),
     timeout: st.SearchStrategy[Optional[int]] = optionals(int64s(min_value=0)),
     max_response_var_binds_per_pdu: st.SearchStrategy[Optional[int]] = optionals(uint64s()),
-    max_async_sessions: st.SearchStrategy[Optional[int]] = optionals(uint64s(min_value=1))
+    max_async_sessions: st.SearchStrategy[Optional[int]] = optionals(uint64s(min_value=1)),
+    partial_result_bytes: st.SearchStrategy[Optional[int]] = optionals(uint64s()),
+    partial_result_records: st.SearchStrategy[Optional[int]] = optionals(uint64s()),
+    adaptive_repetitions: st.SearchStrategy[Optional[bool]] = optionals(st.booleans()),
+    pipeline_depth: st.SearchStrategy[Optional[int]] = optionals(uint64s(min_value=1)),
+    auto_partition: st.SearchStrategy[Optional[int]] = optionals(uint64s()),
+    counter_rates: st.SearchStrategy[Optional[bool]] = optionals(st.booleans()),
+    columnar: st.SearchStrategy[Optional[bool]] = optionals(st.booleans()),
+    wireline_version: st.SearchStrategy[Optional[int]] = optionals(st.sampled_from([1, 2, 3])),
+    shared_memory: st.SearchStrategy[Optional[bool]] = optionals(st.booleans())
 ) -> st.SearchStrategy[Config]:
+    # pylint: disable=too-many-arguments
     """Generate a Config."""
     return st.builds(
-        Config, retries, timeout, max_response_var_binds_per_pdu, max_async_sessions
+        Config, retries, timeout, max_response_var_binds_per_pdu, max_async_sessions,
+        partial_result_bytes, partial_result_records, adaptive_repetitions, pipeline_depth,
+        auto_partition, counter_rates, columnar, wireline_version, shared_memory
     )
 
 
+def io_stats(
+    send_calls: st.SearchStrategy[int] = uint64s(),
+    sent_datagrams: st.SearchStrategy[int] = uint64s(),
+    max_send_batch: st.SearchStrategy[int] = uint64s(),
+    recv_calls: st.SearchStrategy[int] = uint64s(),
+    received_datagrams: st.SearchStrategy[int] = uint64s(),
+    max_recv_batch: st.SearchStrategy[int] = uint64s()
+) -> st.SearchStrategy[IoStats]:
+    """Generate an IoStats."""
+    return st.builds(
+        IoStats, send_calls, sent_datagrams, max_send_batch, recv_calls,
+        received_datagrams, max_recv_batch
+    )
+
+
+def pdu_stamps(
+    realtime_ns: st.SearchStrategy[int] = int64s(),
+    monotonic_ns: st.SearchStrategy[int] = int64s(),
+    rtt_ns: st.SearchStrategy[int] = int64s()
+) -> st.SearchStrategy[PduStamp]:
+    """Generate a PduStamp."""
+    return st.builds(PduStamp, realtime_ns, monotonic_ns, rtt_ns)
+
+
 def snmp_request_types() -> st.SearchStrategy[SnmpRequest.SnmpRequestType]:
     """Generate an SnmpRequestType."""
     return st.one_of([  # type: ignore
@@ -144,7 +180,8 @@ def snmp_error_types() -> st.SearchStrategy[SnmpError.SnmpErrorType]:
         st.just(SnmpError.SnmpErrorType.ASYNC_PROBE_ERROR),  # type: ignore
         st.just(SnmpError.SnmpErrorType.TRANSPORT_DISCONNECT_ERROR),  # type: ignore
         st.just(SnmpError.SnmpErrorType.CREATE_RESPONSE_PDU_ERROR),  # type: ignore
-        st.just(SnmpError.SnmpErrorType.VALUE_WARNING)  # type: ignore
+        st.just(SnmpError.SnmpErrorType.VALUE_WARNING),  # type: ignore
+        st.just(SnmpError.SnmpErrorType.SINK_ERROR)  # type: ignore
     ])
 
 
@@ -162,3 +199,27 @@ def snmp_errors(
     return st.builds(
         SnmpError, type, request, sys_errno, snmp_errno, err_stat, err_index, st.none(), message
     )
+
+
+def snmp_response_types() -> st.SearchStrategy[SnmpResponse.SnmpResponseType]:
+    """Generate an SnmpResponseType."""
+    return st.one_of([  # type: ignore
+        st.just(SnmpResponse.SnmpResponseType.SUCCESSFUL),  # type: ignore
+        st.just(SnmpResponse.SnmpResponseType.DONE_WITH_ERRORS),  # type: ignore
+        st.just(SnmpResponse.SnmpResponseType.FAILED),  # type: ignore
+        st.just(SnmpResponse.SnmpResponseType.PARTIAL)  # type: ignore
+    ])
+
+
+def snmp_responses(
+        type: st.SearchStrategy[SnmpResponse.SnmpResponseType] = snmp_response_types(),
+        request: st.SearchStrategy[SnmpRequest] = snmp_requests(),
+        results: st.SearchStrategy[Sequence[int]] = st.lists(
+            st.integers(min_value=0, max_value=255)
+        ),
+        errors: st.SearchStrategy[Sequence[SnmpError]] = st.lists(snmp_errors(), max_size=4),
+        stamps: st.SearchStrategy[Sequence[PduStamp]] = st.lists(pdu_stamps())
+) -> st.SearchStrategy[SnmpResponse]:
+    # pylint: disable=redefined-outer-name, redefined-builtin
+    """Generate an SnmpResponse."""
+    return st.builds(SnmpResponse, type, request, results, errors, stamps)
@@ -0,0 +1,20 @@
+"""IoStats test cases."""
+
+import pickle
+
+import hypothesis
+
+from snmp_stream._snmp_stream import IoStats
+from .strategies import io_stats
+
+
+@hypothesis.given(
+    stats=io_stats()  # type: ignore
+)
+def test_pickle(
+        stats: IoStats
+) -> None:
+    """Test pickling an IoStats."""
+    assert isinstance(stats, IoStats)
+    other: IoStats = pickle.loads(pickle.dumps(stats))
+    assert stats == other
@@ -0,0 +1,20 @@
+"""PduStamp test cases."""
+
+import pickle
+
+import hypothesis
+
+from snmp_stream._snmp_stream import PduStamp
+from .strategies import pdu_stamps
+
+
+@hypothesis.given(
+    stamp=pdu_stamps()  # type: ignore
+)
+def test_pickle(
+        stamp: PduStamp
+) -> None:
+    """Test pickling a PduStamp."""
+    assert isinstance(stamp, PduStamp)
+    other: PduStamp = pickle.loads(pickle.dumps(stamp))
+    assert stamp == other
@@ -0,0 +1,71 @@
+"""SnmpResponse test cases."""
+
+import os
+import pickle
+from typing import Set
+
+import hypothesis
+import pytest
+
+from snmp_stream._snmp_stream import SnmpResponse
+from .strategies import snmp_responses
+from ..test_wireline import RECORDS, encode, response
+
+SHM_DIR = '/dev/shm'
+
+
+def segment_names() -> Set[str]:
+    """List the shared memory result segments of this process."""
+    prefix = f'snmp_stream.{os.getpid()}.'
+    return {name for name in os.listdir(SHM_DIR) if name.startswith(prefix)}
+
+
+@hypothesis.given(
+    snmp_response=snmp_responses()  # type: ignore
+)
+def test_pickle(
+        snmp_response: SnmpResponse
+) -> None:
+    """Test pickling an SnmpResponse."""
+    assert isinstance(snmp_response, SnmpResponse)
+    other: SnmpResponse = pickle.loads(pickle.dumps(snmp_response))
+    assert snmp_response == other
+
+
+@pytest.mark.skipif(not os.path.isdir(SHM_DIR), reason='no POSIX shared memory')
+def test_pickle_shared_memory() -> None:
+    """Test pickling an SnmpResponse with shared memory results."""
+    results = encode(3, RECORDS)
+    expected = response(results)
+
+    before = segment_names()
+    shared = response(results, shared_memory=True)
+    names = segment_names() - before
+    assert len(names) == 1
+    assert shared == expected
+
+    # the first pickle hands off the segment, so it outlives the response
+    data = pickle.dumps(shared)
+    # later pickles copy the results instead of sharing the name again
+    copied = pickle.dumps(shared)
+    del shared
+    assert segment_names() - before == names
+
+    other: SnmpResponse = pickle.loads(data)
+    assert not segment_names() & names
+    assert other == expected
+    assert len(other.segments) == 1
+    assert bytes(other.results) == results
+    assert other.decode()['tables'][1]['integer'].tolist() == [1, 2]
+    assert pickle.loads(copied) == expected
+    assert pickle.loads(copied) == expected
+
+    # the name is gone, so the same bytes cannot be loaded twice
+    with pytest.raises(RuntimeError, match='failed to open shared memory'):
+        pickle.loads(data)
+
+    # the mapped results are copied when pickled again
+    again = pickle.dumps(other)
+    assert pickle.loads(again) == expected
+    assert pickle.loads(again) == expected
+    assert segment_names() == before